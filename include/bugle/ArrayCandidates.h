@@ -0,0 +1,75 @@
+#ifndef BUGLE_ARRAYCANDIDATES_H
+#define BUGLE_ARRAYCANDIDATES_H
+
+#include "bugle/GlobalArray.h"
+#include "llvm/ADT/SmallBitVector.h"
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace bugle {
+
+/// The global arrays, and possibly the null array, to which a pointer or
+/// array identifier may refer. Membership is kept as a bitset over the indices
+/// of the arrays in their module, and the arrays are kept in index order.
+class ArrayCandidates {
+  llvm::SmallBitVector Indices;
+  std::vector<GlobalArray *> Arrays;
+  bool Null;
+
+  static bool indexLess(GlobalArray *L, GlobalArray *R) {
+    return L->getIndex() < R->getIndex();
+  }
+
+public:
+  ArrayCandidates() : Null(false) {}
+
+  void insert(GlobalArray *GA) {
+    if (!GA) {
+      Null = true;
+      return;
+    }
+
+    unsigned I = GA->getIndex();
+    if (I < Indices.size() && Indices.test(I))
+      return;
+    if (I >= Indices.size())
+      Indices.resize(I + 1);
+    Indices.set(I);
+    Arrays.insert(
+        std::upper_bound(Arrays.begin(), Arrays.end(), GA, indexLess), GA);
+  }
+
+  template <typename InputIt> void insert(InputIt First, InputIt Last) {
+    for (; First != Last; ++First)
+      insert(*First);
+  }
+
+  void insert(const ArrayCandidates &Other) {
+    std::vector<GlobalArray *> Merged;
+    Merged.reserve(Arrays.size() + Other.Arrays.size());
+    std::set_union(Arrays.begin(), Arrays.end(), Other.Arrays.begin(),
+                   Other.Arrays.end(), std::back_inserter(Merged), indexLess);
+    Arrays.swap(Merged);
+    Indices |= Other.Indices;
+    Null |= Other.Null;
+  }
+
+  // The number of candidates, counting the null array.
+  unsigned size() const { return Arrays.size() + (Null ? 1 : 0); }
+  bool empty() const { return size() == 0; }
+  bool hasNull() const { return Null; }
+
+  // The only candidate if it is an array other than null, or null otherwise.
+  GlobalArray *getSingleArray() const {
+    return Arrays.size() == 1 && !Null ? Arrays.front() : nullptr;
+  }
+
+  // Iterate over the candidates other than null.
+  typedef std::vector<GlobalArray *>::const_iterator const_iterator;
+  const_iterator begin() const { return Arrays.begin(); }
+  const_iterator end() const { return Arrays.end(); }
+};
+}
+
+#endif
@@ -1,7 +1,9 @@
 #ifndef BUGLE_BPLEXPRWRITER_H
 #define BUGLE_BPLEXPRWRITER_H
 
+#include "bugle/ExprVisitor.h"
 #include <string>
+#include <vector>
 
 namespace llvm {
 
@@ -10,10 +12,85 @@ class raw_ostream;
 
 namespace bugle {
 
+class ArrayCandidates;
 class BPLModuleWriter;
 class Expr;
+class GlobalArray;
+
+class BPLExprWriter
+    : ExprVisitor<BPLExprWriter, void, llvm::raw_ostream &, unsigned> {
+  friend class ExprVisitor<BPLExprWriter, void, llvm::raw_ostream &, unsigned>;
+
+  // Write the expressions of each kind; writeExpr dispatches to these.
+  void visitBVConstExpr(BVConstExpr *CE, llvm::raw_ostream &OS, unsigned Depth);
+  void visitBoolConstExpr(BoolConstExpr *BCE, llvm::raw_ostream &OS,
+                          unsigned Depth);
+  void visitBVExtractExpr(BVExtractExpr *EE, llvm::raw_ostream &OS,
+                          unsigned Depth);
+  void visitBVCtlzExpr(BVCtlzExpr *E, llvm::raw_ostream &OS, unsigned Depth);
+  void visitBVZExtExpr(BVZExtExpr *ZEE, llvm::raw_ostream &OS, unsigned Depth);
+  void visitBVSExtExpr(BVSExtExpr *SEE, llvm::raw_ostream &OS, unsigned Depth);
+  void visitPointerExpr(PointerExpr *PtrE, llvm::raw_ostream &OS,
+                        unsigned Depth);
+  void visitNullFunctionPointerExpr(NullFunctionPointerExpr *E,
+                                    llvm::raw_ostream &OS, unsigned Depth);
+  void visitFunctionPointerExpr(FunctionPointerExpr *FuncPtrE,
+                                llvm::raw_ostream &OS, unsigned Depth);
+  void visitVarRefExpr(VarRefExpr *VarE, llvm::raw_ostream &OS, unsigned Depth);
+  void visitSpecialVarRefExpr(SpecialVarRefExpr *SVarE, llvm::raw_ostream &OS,
+                              unsigned Depth);
+  void visitGlobalArrayRefExpr(GlobalArrayRefExpr *ArrE, llvm::raw_ostream &OS,
+                               unsigned Depth);
+  void visitNullArrayRefExpr(NullArrayRefExpr *E, llvm::raw_ostream &OS,
+                             unsigned Depth);
+  void visitBVConcatExpr(BVConcatExpr *ConcatE, llvm::raw_ostream &OS,
+                         unsigned Depth);
+  void visitEqExpr(EqExpr *EE, llvm::raw_ostream &OS, unsigned Depth);
+  void visitNeExpr(NeExpr *NE, llvm::raw_ostream &OS, unsigned Depth);
+  void visitAndExpr(AndExpr *AE, llvm::raw_ostream &OS, unsigned Depth);
+  void visitOrExpr(OrExpr *OE, llvm::raw_ostream &OS, unsigned Depth);
+  void visitIfThenElseExpr(IfThenElseExpr *ITEE, llvm::raw_ostream &OS,
+                           unsigned Depth);
+  void visitHavocExpr(HavocExpr *E, llvm::raw_ostream &OS, unsigned Depth);
+  void visitBoolToBVExpr(BoolToBVExpr *B2BVE, llvm::raw_ostream &OS,
+                         unsigned Depth);
+  void visitBVToBoolExpr(BVToBoolExpr *BV2BE, llvm::raw_ostream &OS,
+                         unsigned Depth);
+  void visitArrayIdExpr(ArrayIdExpr *AIE, llvm::raw_ostream &OS,
+                        unsigned Depth);
+  void visitArrayOffsetExpr(ArrayOffsetExpr *AOE, llvm::raw_ostream &OS,
+                            unsigned Depth);
+  void visitNotExpr(NotExpr *NotE, llvm::raw_ostream &OS, unsigned Depth);
+  void visitCallExpr(CallExpr *CE, llvm::raw_ostream &OS, unsigned Depth);
+  void visitCallMemberOfExpr(CallMemberOfExpr *E, llvm::raw_ostream &OS,
+                             unsigned Depth);
+  void visitAddNoovflExpr(AddNoovflExpr *ANOVE, llvm::raw_ostream &OS,
+                          unsigned Depth);
+  void visitAddNoovflPredicateExpr(AddNoovflPredicateExpr *ANOVPE,
+                                   llvm::raw_ostream &OS, unsigned Depth);
+  void visitUninterpretedFunctionExpr(UninterpretedFunctionExpr *UFE,
+                                      llvm::raw_ostream &OS, unsigned Depth);
+  void visitAtomicHasTakenValueExpr(AtomicHasTakenValueExpr *AHTVE,
+                                    llvm::raw_ostream &OS, unsigned Depth);
+  void visitAsyncWorkGroupCopyExpr(AsyncWorkGroupCopyExpr *E,
+                                   llvm::raw_ostream &OS, unsigned Depth);
+  void visitImpliesExpr(ImpliesExpr *IE, llvm::raw_ostream &OS, unsigned Depth);
+  void visitAccessHasOccurredExpr(AccessHasOccurredExpr *AHOE,
+                                  llvm::raw_ostream &OS, unsigned Depth);
+  void visitAccessOffsetExpr(AccessOffsetExpr *AOE, llvm::raw_ostream &OS,
+                             unsigned Depth);
+  void visitUnaryExpr(UnaryExpr *UnE, llvm::raw_ostream &OS, unsigned Depth);
+  void visitBinaryExpr(BinaryExpr *BinE, llvm::raw_ostream &OS, unsigned Depth);
+  void visitLoadExpr(LoadExpr *LE, llvm::raw_ostream &OS, unsigned Depth);
+  void visitAtomicExpr(AtomicExpr *E, llvm::raw_ostream &OS, unsigned Depth);
+  void visitArraySnapshotExpr(ArraySnapshotExpr *E, llvm::raw_ostream &OS,
+                              unsigned Depth);
+  void visitUnderlyingArrayExpr(UnderlyingArrayExpr *UAE, llvm::raw_ostream &OS,
+                                unsigned Depth);
+  void visitArrayMemberOfExpr(ArrayMemberOfExpr *MOE, llvm::raw_ostream &OS,
+                              unsigned Depth);
+  void visitExpr(Expr *E, llvm::raw_ostream &OS, unsigned Depth);
 
-class BPLExprWriter {
   void writeAccessHasOccurredVar(llvm::raw_ostream &OS, bugle::Expr *PtrArr,
                                  std::string accessKind);
 
@@ -23,6 +100,16 @@ class BPLExprWriter {
 protected:
   BPLModuleWriter *MW;
 
+  // Returns the candidates of the array identifier PtrArr. If these are not
+  // known, all arrays are candidates, and so is null if MayBeNull holds.
+  const ArrayCandidates &getArrayCandidates(Expr *PtrArr,
+                                            bool MayBeNull = true);
+
+  // Returns the arrays in Globals other than null ordered by name, such that
+  // the output does not depend on the order in which the arrays were added.
+  static std::vector<GlobalArray *>
+  sortGlobals(const ArrayCandidates &Globals);
+
 public:
   BPLExprWriter(BPLModuleWriter *MW) : MW(MW) {}
   virtual ~BPLExprWriter();
@@ -3,6 +3,7 @@
 
 #include "bugle/BPLExprWriter.h"
 #include "bugle/SourceLoc.h"
+#include "bugle/StmtVisitor.h"
 #include <functional>
 #include <map>
 #include <set>
@@ -24,7 +25,11 @@ class GlobalArray;
 class Stmt;
 class Var;
 
-class BPLFunctionWriter : BPLExprWriter {
+class BPLFunctionWriter
+    : BPLExprWriter,
+      StmtVisitor<BPLFunctionWriter, void, llvm::raw_ostream &> {
+  friend class StmtVisitor<BPLFunctionWriter, void, llvm::raw_ostream &>;
+
   llvm::raw_ostream &OS;
   bugle::Function *F;
   std::map<Expr *, unsigned> SSAVarIds;
@@ -37,6 +42,18 @@ class BPLFunctionWriter : BPLExprWriter {
   void writeExpr(llvm::raw_ostream &OS, Expr *E, unsigned Depth = 0) override;
   void writeCallStmt(llvm::raw_ostream &OS, CallStmt *CS);
   void writeStmt(llvm::raw_ostream &OS, Stmt *S);
+  // Write the statements of each kind; writeStmt dispatches to these.
+  void visitEvalStmt(EvalStmt *ES, llvm::raw_ostream &OS);
+  void visitCallStmt(CallStmt *CS, llvm::raw_ostream &OS);
+  void visitCallMemberOfStmt(CallMemberOfStmt *CMOS, llvm::raw_ostream &OS);
+  void visitStoreStmt(StoreStmt *SS, llvm::raw_ostream &OS);
+  void visitVarAssignStmt(VarAssignStmt *VAS, llvm::raw_ostream &OS);
+  void visitGotoStmt(GotoStmt *GS, llvm::raw_ostream &OS);
+  void visitAssumeStmt(AssumeStmt *AS, llvm::raw_ostream &OS);
+  void visitAssertStmt(AssertStmt *AtS, llvm::raw_ostream &OS);
+  void visitReturnStmt(ReturnStmt *S, llvm::raw_ostream &OS);
+  void visitWaitGroupEventStmt(WaitGroupEventStmt *WGES, llvm::raw_ostream &OS);
+  void visitStmt(Stmt *S, llvm::raw_ostream &OS);
   void writeBasicBlock(llvm::raw_ostream &OS, BasicBlock *BB);
   void writeSourceLocs(llvm::raw_ostream &OS, const SourceLocsRef &sourcelocs);
   void writeSourceLocsMarker(llvm::raw_ostream &OS,
@@ -1,6 +1,7 @@
 #ifndef BUGLE_BPLMODULEWRITER_H
 #define BUGLE_BPLMODULEWRITER_H
 
+#include "bugle/ArrayCandidates.h"
 #include "bugle/BPLExprWriter.h"
 #include "bugle/RaceInstrumenter.h"
 #include <functional>
@@ -29,6 +30,8 @@ class BPLModuleWriter : BPLExprWriter {
   bool UsesPointers, UsesFunctionPointers;
   std::string GlobalInitRequires;
   unsigned candidateNumber;
+  // The candidates of array identifiers whose candidates are not known.
+  ArrayCandidates AllArrays, AllArraysOrNull;
 
   const std::string &getGlobalInitRequires();
   void writeType(llvm::raw_ostream &OS, const bugle::Type &t);
@@ -22,7 +22,7 @@ public:
     if (e->hasEvalStmt || e->preventEvalStmt)
       return;
 
-    auto ES = EvalStmt::create(e, sourcelocs);
+    auto ES = EvalStmt::create(std::move(e), sourcelocs);
     addStmt(ES);
   }
 
@@ -1,9 +1,12 @@
+#include "bugle/ArrayCandidates.h"
 #include "bugle/Ref.h"
 #include "bugle/Type.h"
 #include "bugle/Var.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/APInt.h"
+#include <atomic>
 #include <set>
+#include <utility>
 #include <vector>
 
 #ifndef BUGLE_EXPR_H
@@ -20,135 +23,62 @@ class Function;
 class GlobalArray;
 class Var;
 
+// The reference count of an expression. Expressions, such as translated
+// constants, may be shared by functions that are translated on different
+// threads; the count is updated with atomic read-modify-write operations only
+// while such threads may be running.
+class RefCount {
+  std::atomic<unsigned> count;
+  static bool Threaded;
+
+public:
+  RefCount() : count(0) {}
+  operator unsigned() const { return count.load(std::memory_order_relaxed); }
+
+  RefCount &operator++() {
+    if (Threaded)
+      count.fetch_add(1, std::memory_order_relaxed);
+    else
+      count.store(count.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+    return *this;
+  }
+
+  unsigned operator--() {
+    if (Threaded)
+      return count.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    unsigned New = count.load(std::memory_order_relaxed) - 1;
+    count.store(New, std::memory_order_relaxed);
+    return New;
+  }
+
+  // Makes the counts atomic while an instance exists. Instances must be
+  // created and destroyed on the main thread, before the threads that share
+  // expressions are started and after they are joined.
+  class ThreadedScope {
+  public:
+    ThreadedScope() { Threaded = true; }
+    ~ThreadedScope() { Threaded = false; }
+  };
+};
+
 class Expr {
 public:
   enum Kind {
-    BVConst,
-    BoolConst,
-    GlobalArrayRef,
-    NullArrayRef,
-    ConstantArrayRef,
-    Pointer,
-    NullFunctionPointer,
-    FunctionPointer,
-    Load,
-    Atomic,
-    VarRef,
-    SpecialVarRef,
-    Call,
-    CallMemberOf,
-    BVExtract,
-    BVCtlz,
-    IfThenElse,
-    Havoc,
-    AccessHasOccurred,
-    AccessOffset,
-    ArraySnapshot,
-    UnderlyingArray,
-    AddNoovfl,
-    AddNoovflPredicate,
-    UninterpretedFunction,
-    ArrayMemberOf,
-    AtomicHasTakenValue,
-    AsyncWorkGroupCopy,
-
-    // Unary
-    Not,
-    ArrayId,
-    ArrayOffset,
-    BVToPtr,
-    PtrToBV,
-    SafeBVToPtr,
-    SafePtrToBV,
-    BVToFuncPtr,
-    FuncPtrToBV,
-    PtrToFuncPtr,
-    FuncPtrToPtr,
-    BVToBool,
-    BoolToBV,
-    BVCtpop,
-    BVZExt,
-    BVSExt,
-    FPConv,
-    FPToSI,
-    FPToUI,
-    SIToFP,
-    UIToFP,
-    FAbs,
-    FCeil,
-    FCos,
-    FExp,
-    FExp2,
-    FFloor,
-    FLog,
-    FLog10,
-    FLog2,
-    FrexpExp,
-    FrexpFrac,
-    FRsqrt,
-    FRint,
-    FSin,
-    FSqrt,
-    FTrunc,
-    OtherInt,
-    OtherBool,
-    OtherPtrBase,
-    Old,
-    GetImageWidth,
-    GetImageHeight,
+#define HANDLE_EXPR(Kind) Kind,
+#include "bugle/ExprKinds.def"
 
     UnaryFirst = Not,
     UnaryLast = GetImageHeight,
-
-    // Binary
-    Eq,
-    Ne,
-    And,
-    Or,
-    BVAdd,
-    BVSub,
-    BVMul,
-    BVSDiv,
-    BVUDiv,
-    BVSRem,
-    BVURem,
-    BVShl,
-    BVAShr,
-    BVLShr,
-    BVAnd,
-    BVOr,
-    BVXor,
-    BVConcat,
-    BVUgt,
-    BVUge,
-    BVUlt,
-    BVUle,
-    BVSgt,
-    BVSge,
-    BVSlt,
-    BVSle,
-    FAdd,
-    FSub,
-    FMul,
-    FDiv,
-    FRem,
-    FPow,
-    FMax,
-    FMin,
-    FPowi,
-    FLt,
-    FEq,
-    FUno,
-    PtrLt,
-    FuncPtrLt,
-    Implies,
-
     BinaryFirst = Eq,
     BinaryLast = Implies
   };
 
-  unsigned refCount;
-  bool preventEvalStmt : 1, hasEvalStmt : 1;
+  RefCount refCount;
+  // Kept apart rather than as bitfields, as nodes shared by functions that
+  // are translated on different threads may have either flag set by any of
+  // them.
+  std::atomic<bool> preventEvalStmt, hasEvalStmt;
 
   static ref<Expr> createPtrLt(ref<Expr> lhs, ref<Expr> rhs);
   static ref<Expr> createPtrLe(ref<Expr> lhs, ref<Expr> rhs);
@@ -159,33 +89,81 @@ public:
   static ref<Expr> createExactBVSDiv(ref<Expr> lhs, uint64_t rhs,
                                      Var *base = nullptr);
 
-  static Type getArrayCandidateType(const std::set<GlobalArray *> &Globals);
+  static Type getArrayCandidateType(const ArrayCandidates &Globals);
   static Type getPointerRange(ref<Expr> pointer, Type defaultRange);
-  bool computeArrayCandidates(std::set<GlobalArray *> &GlobalSet) const;
+
+  // The arrays to which this pointer or array identifier may refer, or null
+  // if these are not known. The candidates of array references and of
+  // conditionals are computed once per expression and shared by every caller.
+  const ArrayCandidates *getArrayCandidates() const;
+
+  // Allocation goes through here so that allocations can be accounted per
+  // kind; see EXPR_KIND.
+  static void *allocate(size_t size, const char *kindName);
+  static void operator delete(void *p);
+
+  // While a scope is active on a thread and -hash-cons-exprs is given, the
+  // factories return the same node for structurally equal expressions that
+  // are created on that thread and have no side effects or time dependence.
+  // Nested scopes share the table of the outermost one; a scope created with
+  // Enable false suspends the sharing within it. A scope must not span basic
+  // blocks, as a node evaluated in one block would otherwise be referred to
+  // by its variable in another.
+  class HashConsScope {
+    bool OwnsTable, WasSuspended;
+
+  public:
+    HashConsScope(bool Enable = true);
+    ~HashConsScope();
+  };
+
+  // Stop returning this node, or the nodes that have it as an operand
+  // directly or through other nodes, for structurally equal expressions, as
+  // it is evaluated at a particular point of the program.
+  void removeFromUniqueTable();
 
 private:
+  const Kind kind;
   Type type;
 
 protected:
-  Expr(Type type)
-      : refCount(0), preventEvalStmt(false), hasEvalStmt(false), type(type) {}
+  // Returns the simplification of E by the rewriter of this thread if one
+  // applies, or else an existing node that is structurally equal to E if
+  // hash-consing is active, deleting E in either case; otherwise returns E.
+  static ref<Expr> intern(Expr *E);
+
+  Expr(Kind kind, Type type)
+      : preventEvalStmt(false), hasEvalStmt(false), kind(kind), type(type) {}
 
 public:
-  virtual ~Expr() {}
-  virtual Kind getKind() const = 0;
+  virtual ~Expr();
+  // The kind is stored rather than given by a virtual function, such that
+  // visitors and casts can dispatch on it cheaply; see ExprVisitor.
+  Kind getKind() const { return kind; }
   const Type &getType() const { return type; }
 
   static bool classof(const Expr *) { return true; }
 };
 
+// The array candidates of an expression, computed on first use. Only the
+// expressions from which the candidates of others derive hold one.
+class ArrayCandidatesCache {
+  mutable std::atomic<const ArrayCandidates *> candidates;
+
+public:
+  ArrayCandidatesCache() : candidates(nullptr) {}
+  ~ArrayCandidatesCache();
+  const ArrayCandidates *get(const Expr *E) const;
+};
+
 #define EXPR_KIND(kind)                                                        \
-  Kind getKind() const override { return kind; }                               \
+  static void *operator new(size_t size) { return allocate(size, #kind); }     \
   static bool classof(const Expr *E) { return E->getKind() == kind; }          \
   static bool classof(const kind##Expr *) { return true; }
 
 class BVConstExpr : public Expr {
   BVConstExpr(const llvm::APInt &bv)
-      : Expr(Type(Type::BV, bv.getBitWidth())), bv(bv) {}
+      : Expr(BVConst, Type(Type::BV, bv.getBitWidth())), bv(bv) {}
   llvm::APInt bv;
 
 public:
@@ -198,7 +176,7 @@ public:
 };
 
 class BoolConstExpr : public Expr {
-  BoolConstExpr(bool val) : Expr(Type(Type::Bool)), val(val) {}
+  BoolConstExpr(bool val) : Expr(BoolConst, Type(Type::Bool)), val(val) {}
   bool val;
 
 public:
@@ -209,8 +187,11 @@ public:
 };
 
 class GlobalArrayRefExpr : public Expr {
-  GlobalArrayRefExpr(Type t, GlobalArray *array) : Expr(t), array(array) {}
+  GlobalArrayRefExpr(Type t, GlobalArray *array)
+      : Expr(GlobalArrayRef, t), array(array) {}
   GlobalArray *array;
+  ArrayCandidatesCache candidates;
+  friend class Expr;
 
 public:
   static ref<Expr> create(GlobalArray *array);
@@ -220,7 +201,9 @@ public:
 };
 
 class NullArrayRefExpr : public Expr {
-  NullArrayRefExpr() : Expr(Type(Type::ArrayOf, Type::Any)) {}
+  NullArrayRefExpr() : Expr(NullArrayRef, Type(Type::ArrayOf, Type::Any)) {}
+  ArrayCandidatesCache candidates;
+  friend class Expr;
 
 public:
   static ref<Expr> create();
@@ -230,7 +213,7 @@ public:
 
 class ConstantArrayRefExpr : public Expr {
   ConstantArrayRefExpr(llvm::ArrayRef<ref<Expr>> array)
-      : Expr(Type(Type::ArrayOf, array[0]->getType())),
+      : Expr(ConstantArrayRef, Type(Type::ArrayOf, array[0]->getType())),
         array(array.begin(), array.end()) {}
   std::vector<ref<Expr>> array;
 
@@ -243,8 +226,8 @@ public:
 
 class PointerExpr : public Expr {
   PointerExpr(ref<Expr> array, ref<Expr> offset)
-      : Expr(Type(Type::Pointer, offset->getType().width)), array(array),
-        offset(offset) {}
+      : Expr(Pointer, Type(Type::Pointer, offset->getType().width)),
+        array(std::move(array)), offset(std::move(offset)) {}
   ref<Expr> array, offset;
 
 public:
@@ -257,7 +240,7 @@ public:
 
 class NullFunctionPointerExpr : public Expr {
   NullFunctionPointerExpr(unsigned ptrWidth)
-      : Expr(Type(Type::FunctionPointer, ptrWidth)) {}
+      : Expr(NullFunctionPointer, Type(Type::FunctionPointer, ptrWidth)) {}
 
 public:
   static ref<Expr> create(unsigned ptrWidth);
@@ -267,7 +250,8 @@ public:
 
 class FunctionPointerExpr : public Expr {
   FunctionPointerExpr(std::string funcName, unsigned ptrWidth)
-      : Expr(Type(Type::FunctionPointer, ptrWidth)), funcName(funcName) {}
+      : Expr(FunctionPointer, Type(Type::FunctionPointer, ptrWidth)),
+        funcName(std::move(funcName)) {}
   std::string funcName;
 
 public:
@@ -279,7 +263,8 @@ public:
 
 class LoadExpr : public Expr {
   LoadExpr(Type t, ref<Expr> array, ref<Expr> offset, bool isTemporal)
-      : Expr(t), array(array), offset(offset), isTemporal(isTemporal) {}
+      : Expr(Load, t), array(std::move(array)), offset(std::move(offset)),
+        isTemporal(isTemporal) {}
   ref<Expr> array, offset;
   bool isTemporal;
 
@@ -297,7 +282,8 @@ class AtomicExpr : public Expr {
   AtomicExpr(Type t, ref<Expr> array, ref<Expr> offset,
              std::vector<ref<Expr>> args, std::string function,
              unsigned int parts, unsigned int part)
-      : Expr(t), array(array), offset(offset), args(args), function(function),
+      : Expr(Atomic, t), array(std::move(array)), offset(std::move(offset)),
+        args(std::move(args)), function(std::move(function)),
         parts(parts), part(part) {}
   ref<Expr> array, offset;
   std::vector<ref<Expr>> args;
@@ -322,7 +308,7 @@ public:
 // variables.
 class VarRefExpr : public Expr {
   Var *var;
-  VarRefExpr(Var *var) : Expr(var->getType()), var(var) {
+  VarRefExpr(Var *var) : Expr(VarRef, var->getType()), var(var) {
     preventEvalStmt = true;
   }
 
@@ -335,7 +321,8 @@ public:
 // A reference to the special variable marked with the given attribute.
 class SpecialVarRefExpr : public Expr {
   std::string attr;
-  SpecialVarRefExpr(Type t, const std::string &attr) : Expr(t), attr(attr) {}
+  SpecialVarRefExpr(Type t, const std::string &attr)
+      : Expr(SpecialVarRef, t), attr(attr) {}
 
 public:
   static ref<Expr> create(Type t, const std::string &attr);
@@ -345,7 +332,8 @@ public:
 
 class BVExtractExpr : public Expr {
   BVExtractExpr(ref<Expr> expr, unsigned offset, unsigned width)
-      : Expr(Type(Type::BV, width)), expr(expr), offset(offset) {}
+      : Expr(BVExtract, Type(Type::BV, width)), expr(std::move(expr)),
+        offset(offset) {}
   ref<Expr> expr;
   unsigned offset;
 
@@ -359,7 +347,8 @@ public:
 
 class BVCtlzExpr : public Expr {
   BVCtlzExpr(Type type, ref<Expr> val, ref<Expr> isZeroUndef)
-      : Expr(type), val(val), isZeroUndef(isZeroUndef) {}
+      : Expr(BVCtlz, type), val(std::move(val)),
+        isZeroUndef(std::move(isZeroUndef)) {}
   ref<Expr> val, isZeroUndef;
 
 public:
@@ -372,9 +361,11 @@ public:
 
 class IfThenElseExpr : public Expr {
   IfThenElseExpr(ref<Expr> cond, ref<Expr> trueExpr, ref<Expr> falseExpr)
-      : Expr(trueExpr->getType()), cond(cond), trueExpr(trueExpr),
-        falseExpr(falseExpr) {}
+      : Expr(IfThenElse, trueExpr->getType()), cond(std::move(cond)),
+        trueExpr(std::move(trueExpr)), falseExpr(std::move(falseExpr)) {}
   ref<Expr> cond, trueExpr, falseExpr;
+  ArrayCandidatesCache candidates;
+  friend class Expr;
 
 public:
   static ref<Expr> create(ref<Expr> cond, ref<Expr> trueExpr,
@@ -386,7 +377,7 @@ public:
 };
 
 class HavocExpr : public Expr {
-  HavocExpr(Type type) : Expr(type) {}
+  HavocExpr(Type type) : Expr(Havoc, type) {}
 
 public:
   static ref<Expr> create(Type type);
@@ -397,25 +388,25 @@ public:
 /// of the elems set.  This is an unusual expression in that it only shows
 /// up in the output indirectly via case splits.
 class ArrayMemberOfExpr : public Expr {
-  ArrayMemberOfExpr(Type t, ref<Expr> expr,
-                    const std::set<GlobalArray *> &elems)
-      : Expr(t), expr(expr), elems(elems) {}
+  ArrayMemberOfExpr(Type t, ref<Expr> expr, const ArrayCandidates &elems)
+      : Expr(ArrayMemberOf, t), expr(std::move(expr)), elems(elems) {}
   ref<Expr> expr;
-  std::set<GlobalArray *> elems;
+  ArrayCandidates elems;
 
 public:
-  static ref<Expr> create(ref<Expr> expr, const std::set<GlobalArray *> &elems);
+  static ref<Expr> create(ref<Expr> expr, const ArrayCandidates &elems);
 
   EXPR_KIND(ArrayMemberOf)
   ref<Expr> getSubExpr() const { return expr; }
-  const std::set<GlobalArray *> &getElems() const { return elems; }
+  const ArrayCandidates &getElems() const { return elems; }
 };
 
 class UnaryExpr : public Expr {
   ref<Expr> expr;
 
 protected:
-  UnaryExpr(Type type, ref<Expr> expr) : Expr(type), expr(expr) {}
+  UnaryExpr(Kind kind, Type type, ref<Expr> expr)
+      : Expr(kind, type), expr(std::move(expr)) {}
 
 public:
   ref<Expr> getSubExpr() const { return expr; }
@@ -428,7 +419,8 @@ public:
 
 #define UNARY_EXPR(kind)                                                       \
   class kind##Expr : public UnaryExpr {                                        \
-    kind##Expr(Type type, ref<Expr> expr) : UnaryExpr(type, expr) {}           \
+    kind##Expr(Type type, ref<Expr> expr)                                      \
+        : UnaryExpr(kind, type, std::move(expr)) {}                            \
                                                                                \
   public:                                                                      \
     static ref<Expr> create(ref<Expr> var);                                    \
@@ -438,7 +430,8 @@ public:
 UNARY_EXPR(Not)
 
 class ArrayIdExpr : public UnaryExpr {
-  ArrayIdExpr(Type type, ref<Expr> expr) : UnaryExpr(type, expr) {}
+  ArrayIdExpr(Type type, ref<Expr> expr)
+      : UnaryExpr(ArrayId, type, std::move(expr)) {}
 
 public:
   static ref<Expr> create(ref<Expr> var, Type defaultRange);
@@ -475,7 +468,8 @@ UNARY_EXPR(GetImageHeight)
 
 #define UNARY_CONV_EXPR(kind)                                                  \
   class kind##Expr : public UnaryExpr {                                        \
-    kind##Expr(Type type, ref<Expr> expr) : UnaryExpr(type, expr) {}           \
+    kind##Expr(Type type, ref<Expr> expr)                                      \
+        : UnaryExpr(kind, type, std::move(expr)) {}                            \
                                                                                \
   public:                                                                      \
     static ref<Expr> create(unsigned width, ref<Expr> var);                    \
@@ -504,8 +498,8 @@ class BinaryExpr : public Expr {
   ref<Expr> lhs, rhs;
 
 protected:
-  BinaryExpr(Type type, ref<Expr> lhs, ref<Expr> rhs)
-      : Expr(type), lhs(lhs), rhs(rhs) {}
+  BinaryExpr(Kind kind, Type type, ref<Expr> lhs, ref<Expr> rhs)
+      : Expr(kind, type), lhs(std::move(lhs)), rhs(std::move(rhs)) {}
 
 public:
   ref<Expr> getLHS() const { return lhs; }
@@ -520,7 +514,7 @@ public:
 #define BINARY_EXPR(kind)                                                      \
   class kind##Expr : public BinaryExpr {                                       \
     kind##Expr(Type type, ref<Expr> lhs, ref<Expr> rhs)                        \
-        : BinaryExpr(type, lhs, rhs) {}                                        \
+        : BinaryExpr(kind, type, std::move(lhs), std::move(rhs)) {}            \
                                                                                \
   public:                                                                      \
     static ref<Expr> create(ref<Expr> lhs, ref<Expr> rhs);                     \
@@ -575,7 +569,7 @@ class CallExpr : public Expr {
   Function *callee;
   std::vector<ref<Expr>> args;
   CallExpr(Type t, Function *callee, const std::vector<ref<Expr>> &args)
-      : Expr(t), callee(callee), args(args) {}
+      : Expr(Call, t), callee(callee), args(args) {}
 
 public:
   static ref<Expr> create(Function *callee, const std::vector<ref<Expr>> &args);
@@ -589,7 +583,8 @@ class CallMemberOfExpr : public Expr {
   ref<Expr> func;
   std::vector<ref<Expr>> callExprs;
   CallMemberOfExpr(Type t, ref<Expr> func, std::vector<ref<Expr>> callExprs)
-      : Expr(t), func(func), callExprs(callExprs) {}
+      : Expr(CallMemberOf, t), func(std::move(func)),
+        callExprs(std::move(callExprs)) {}
 
 public:
   static ref<Expr> create(ref<Expr> func, std::vector<ref<Expr>> &callExprs);
@@ -601,7 +596,8 @@ public:
 
 class AccessHasOccurredExpr : public Expr {
   AccessHasOccurredExpr(ref<Expr> array, bool isWrite)
-      : Expr(Type::Bool), array(array), isWrite(isWrite) {}
+      : Expr(AccessHasOccurred, Type::Bool), array(std::move(array)),
+        isWrite(isWrite) {}
   ref<Expr> array;
   bool isWrite;
 
@@ -615,7 +611,8 @@ public:
 
 class AccessOffsetExpr : public Expr {
   AccessOffsetExpr(ref<Expr> array, unsigned pointerSize, bool isWrite)
-      : Expr(Type(Type::BV, pointerSize)), array(array), isWrite(isWrite) {}
+      : Expr(AccessOffset, Type(Type::BV, pointerSize)),
+        array(std::move(array)), isWrite(isWrite) {}
   ref<Expr> array;
   bool isWrite;
 
@@ -629,7 +626,8 @@ public:
 
 class ArraySnapshotExpr : public Expr {
   ArraySnapshotExpr(ref<Expr> dst, ref<Expr> src)
-      : Expr(Type::BV), dst(dst), src(src) {}
+      : Expr(ArraySnapshot, Type::BV), dst(std::move(dst)),
+        src(std::move(src)) {}
   ref<Expr> dst;
   ref<Expr> src;
 
@@ -642,7 +640,8 @@ public:
 };
 
 class UnderlyingArrayExpr : public Expr {
-  UnderlyingArrayExpr(ref<Expr> array) : Expr(array->getType()), array(array) {}
+  UnderlyingArrayExpr(ref<Expr> array)
+      : Expr(UnderlyingArray, array->getType()), array(std::move(array)) {}
   ref<Expr> array;
 
 public:
@@ -654,8 +653,9 @@ public:
 
 class AddNoovflExpr : public Expr {
   AddNoovflExpr(ref<Expr> first, ref<Expr> second, bool isSigned)
-      : Expr(Type(Type::BV, first->getType().width)), first(first),
-        second(second), isSigned(isSigned) {}
+      : Expr(AddNoovfl, Type(Type::BV, first->getType().width)),
+        first(std::move(first)), second(std::move(second)),
+        isSigned(isSigned) {}
   ref<Expr> first;
   ref<Expr> second;
   bool isSigned;
@@ -672,7 +672,7 @@ public:
 class AddNoovflPredicateExpr : public Expr {
   std::vector<ref<Expr>> exprs;
   AddNoovflPredicateExpr(const std::vector<ref<Expr>> &exprs)
-      : Expr(Type(Type::BV, 1)), exprs(exprs) {}
+      : Expr(AddNoovflPredicate, Type(Type::BV, 1)), exprs(exprs) {}
 
 public:
   static ref<Expr> create(const std::vector<ref<Expr>> &exprs);
@@ -683,8 +683,9 @@ public:
 
 class UninterpretedFunctionExpr : public Expr {
   UninterpretedFunctionExpr(const std::string &name, Type returnType,
-                            const std::vector<ref<Expr>> &args)
-      : Expr(returnType), name(name), args(args) {}
+                            std::vector<ref<Expr>> args)
+      : Expr(UninterpretedFunction, returnType), name(name),
+        args(std::move(args)) {}
   const std::string name;
   const std::vector<ref<Expr>> args;
 
@@ -701,8 +702,9 @@ public:
 class AtomicHasTakenValueExpr : public Expr {
   AtomicHasTakenValueExpr(ref<Expr> atomicArray, ref<Expr> offset,
                           ref<Expr> value)
-      : Expr(Type::Bool), atomicArray(atomicArray), offset(offset),
-        value(value) {}
+      : Expr(AtomicHasTakenValue, Type::Bool),
+        atomicArray(std::move(atomicArray)), offset(std::move(offset)),
+        value(std::move(value)) {}
   ref<Expr> atomicArray;
   ref<Expr> offset;
   ref<Expr> value;
@@ -720,8 +722,10 @@ public:
 class AsyncWorkGroupCopyExpr : public Expr {
   AsyncWorkGroupCopyExpr(ref<Expr> dst, ref<Expr> dstOffset, ref<Expr> src,
                          ref<Expr> srcOffset, ref<Expr> size, ref<Expr> handle)
-      : Expr(handle->getType()), dst(dst), dstOffset(dstOffset), src(src),
-        srcOffset(srcOffset), size(size), handle(handle) {}
+      : Expr(AsyncWorkGroupCopy, handle->getType()), dst(std::move(dst)),
+        dstOffset(std::move(dstOffset)), src(std::move(src)),
+        srcOffset(std::move(srcOffset)), size(std::move(size)),
+        handle(std::move(handle)) {}
   ref<Expr> dst;
   ref<Expr> dstOffset;
   ref<Expr> src;
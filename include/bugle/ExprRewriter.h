@@ -0,0 +1,72 @@
+#ifndef BUGLE_EXPRREWRITER_H
+#define BUGLE_EXPRREWRITER_H
+
+#include "bugle/Expr.h"
+#include "llvm/ADT/ArrayRef.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bugle {
+
+/// A rule that rewrites expressions of one kind into equivalent expressions
+/// that are smaller or in a canonical form. Apply returns null if the rule
+/// does not match the expression.
+///
+/// Rules are tried on each node before a factory returns it, and so see
+/// nodes whose operands have been rewritten already. The node passed to
+/// Apply is deleted if the rule matches; Apply must therefore not keep a
+/// reference to the node itself, only to its operands.
+struct RewriteRule {
+  const char *Name;
+  Expr::Kind Kind;
+  ref<Expr> (*Apply)(Expr *E);
+};
+
+/// A set of enabled rules. A rewriter does not change once it is created,
+/// such that the functions of a module may be translated with it on several
+/// threads. The factories of Expr apply the rewriter that is installed on
+/// their thread by an ExprRewriter::Scope, if any.
+class ExprRewriter {
+  // The enabled rules of each kind, in the order in which they are tried.
+  std::vector<std::vector<const RewriteRule *>> KindRules;
+  // The names of the disabled rules, sorted.
+  std::vector<std::string> Disabled;
+
+  static thread_local const ExprRewriter *Current;
+
+public:
+  /// Enables all rules except those named in DisabledRules.
+  explicit ExprRewriter(llvm::ArrayRef<std::string> DisabledRules);
+
+  /// All rules, in the order in which they are tried on each kind.
+  static llvm::ArrayRef<RewriteRule> getRules();
+
+  /// Returns the rewriter given by the options, or null if -rewrite-exprs is
+  /// not given. Reports an error if -disable-expr-rewrite names an unknown
+  /// rule.
+  static std::unique_ptr<ExprRewriter> createFromOptions();
+
+  /// The names of the disabled rules, sorted.
+  llvm::ArrayRef<std::string> getDisabledRules() const { return Disabled; }
+
+  /// Returns the result of the first rule for the kind of E that is enabled
+  /// and matches, or null if there is none.
+  ref<Expr> rewrite(Expr *E) const;
+
+  /// The rewriter installed on this thread, or null if there is none.
+  static const ExprRewriter *getCurrent() { return Current; }
+
+  /// Installs a rewriter, which may be null, on this thread while the scope
+  /// is active.
+  class Scope {
+    const ExprRewriter *Prev;
+
+  public:
+    explicit Scope(const ExprRewriter *R) : Prev(Current) { Current = R; }
+    ~Scope() { Current = Prev; }
+  };
+};
+}
+
+#endif
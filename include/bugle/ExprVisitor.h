@@ -0,0 +1,55 @@
+#ifndef BUGLE_EXPRVISITOR_H
+#define BUGLE_EXPRVISITOR_H
+
+#include "bugle/Expr.h"
+#include "llvm/Support/ErrorHandling.h"
+
+namespace bugle {
+
+/// Base class for visitors of expressions, in the manner of llvm::InstVisitor.
+/// visit() switches on the kind stored in the expression and calls the
+/// visitKindExpr method of SubClass for that kind. Unless overridden, these
+/// methods forward to visitUnaryExpr or visitBinaryExpr where the expression
+/// has such a class, and to visitExpr otherwise. Any further arguments of
+/// visit() are passed on to the visit methods.
+template <typename SubClass, typename RetTy = void, typename... ArgTys>
+class ExprVisitor {
+public:
+  RetTy visit(Expr *E, ArgTys... Args) {
+    switch (E->getKind()) {
+#define HANDLE_EXPR(Kind)                                                      \
+  case Expr::Kind:                                                             \
+    return static_cast<SubClass *>(this)->visit##Kind##Expr(                   \
+        static_cast<Kind##Expr *>(E), Args...);
+#include "bugle/ExprKinds.def"
+    }
+    llvm_unreachable("Unknown expression kind");
+  }
+
+#define HANDLE_EXPR(Kind)                                                      \
+  RetTy visit##Kind##Expr(Kind##Expr *E, ArgTys... Args) {                     \
+    return static_cast<SubClass *>(this)->visitExpr(E, Args...);               \
+  }
+#define HANDLE_UNARY_EXPR(Kind)                                                \
+  RetTy visit##Kind##Expr(Kind##Expr *E, ArgTys... Args) {                     \
+    return static_cast<SubClass *>(this)->visitUnaryExpr(E, Args...);          \
+  }
+#define HANDLE_BINARY_EXPR(Kind)                                               \
+  RetTy visit##Kind##Expr(Kind##Expr *E, ArgTys... Args) {                     \
+    return static_cast<SubClass *>(this)->visitBinaryExpr(E, Args...);        \
+  }
+#include "bugle/ExprKinds.def"
+
+  RetTy visitUnaryExpr(UnaryExpr *E, ArgTys... Args) {
+    return static_cast<SubClass *>(this)->visitExpr(E, Args...);
+  }
+  RetTy visitBinaryExpr(BinaryExpr *E, ArgTys... Args) {
+    return static_cast<SubClass *>(this)->visitExpr(E, Args...);
+  }
+  RetTy visitExpr(Expr *, ArgTys...) {
+    llvm_unreachable("Unhandled expression kind");
+  }
+};
+}
+
+#endif
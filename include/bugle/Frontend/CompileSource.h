@@ -0,0 +1,38 @@
+#ifndef BUGLE_FRONTEND_COMPILESOURCE_H
+#define BUGLE_FRONTEND_COMPILESOURCE_H
+
+#include "bugle/Translator/TranslateModule.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+class LLVMContext;
+class Module;
+}
+
+namespace bugle {
+
+struct FrontendOptions {
+  // The directory holding the Bugle headers (include-blang).
+  std::string IncludeDir;
+  // The target triple to compile for.
+  std::string Triple;
+  // Additional arguments for the Clang frontend (-cc1), such as -D and -I
+  // options.
+  std::vector<std::string> ExtraArgs;
+};
+
+// Compiles the OpenCL, CUDA or C source in Buffer, named after its buffer
+// identifier, with the Clang frontend running in-process. Functions declared
+// inline without always_inline are rejected, as by bugleInlineCheckPlugin.
+// Compilation errors are reported through ErrorReporter.
+std::unique_ptr<llvm::Module> compileSource(llvm::MemoryBufferRef Buffer,
+                                            TranslateModule::SourceLanguage SL,
+                                            const FrontendOptions &Opts,
+                                            llvm::LLVMContext &Context);
+}
+
+#endif
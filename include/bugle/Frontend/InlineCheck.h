@@ -0,0 +1,20 @@
+#ifndef BUGLE_FRONTEND_INLINECHECK_H
+#define BUGLE_FRONTEND_INLINECHECK_H
+
+#include <memory>
+
+namespace clang {
+
+class ASTConsumer;
+class CompilerInstance;
+}
+
+namespace bugle {
+
+// Creates a consumer reporting an error for each function that is declared
+// inline without the always_inline attribute.
+std::unique_ptr<clang::ASTConsumer>
+createInlineCheckConsumer(clang::CompilerInstance &CI);
+}
+
+#endif
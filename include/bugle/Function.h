@@ -49,6 +49,27 @@ public:
     return V;
   }
   void addAttribute(const std::string &attrib) { attributes.insert(attrib); }
+
+  // Remove the body, specification and variables of this function, but keep
+  // its name, such that existing calls to the function remain valid.
+  void clear() {
+    varNames = UniqueNameSet();
+    bbNames = UniqueNameSet();
+    locals.clear();
+    returns.clear();
+    args.clear();
+    blocks.clear();
+    procedureWideCandidateInvariant.clear();
+    procedureWideInvariant.clear();
+    modifies.clear();
+    globalEnsures.clear();
+    ensures.clear();
+    globalRequires.clear();
+    requires.clear();
+    attributes.clear();
+    entryPoint = specification = false;
+  }
+
   void addRequires(ref<Expr> r, const SourceLocsRef &ss) {
     requires.push_back(new SpecificationInfo(r.get(), ss));
   }
@@ -72,6 +93,7 @@ public:
   }
 
   const std::string &getName() { return name; }
+  void setName(const std::string &n) { name = n; }
   const std::string &getSourceName() { return sourceName; }
   bool isEntryPoint() const { return entryPoint; }
   void setEntryPoint(bool ep) { entryPoint = ep; }
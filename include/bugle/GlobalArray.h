@@ -3,8 +3,10 @@
 
 #include "bugle/Type.h"
 
+#include <algorithm>
 #include <set>
 #include <string>
+#include <vector>
 
 namespace bugle {
 
@@ -16,21 +18,29 @@ class GlobalArray {
   std::vector<uint64_t> sourceDim;
   bool zeroDimensionValid;
   std::set<std::string> attributes;
+  unsigned index;
 
 public:
   GlobalArray(const std::string &name, Type rangeType,
               const std::string &sourceName, Type sourceRangeType,
-              std::vector<uint64_t> sourceDim, bool isParameter)
+              std::vector<uint64_t> sourceDim, bool isParameter,
+              unsigned index)
       : name(name), rangeType(rangeType), sourceName(sourceName),
         sourceRangeType(sourceRangeType), sourceDim(sourceDim),
-        zeroDimensionValid(!isParameter) {}
+        zeroDimensionValid(!isParameter), index(index) {}
   const std::string &getName() const { return name; }
+  void setName(const std::string &n) { name = n; }
   Type getRangeType() const { return rangeType; }
+  void setRangeType(Type t) { rangeType = t; }
   const std::string &getSourceName() const { return sourceName; }
   Type getSourceRangeType() const { return sourceRangeType; }
   const std::vector<uint64_t> &getSourceDimensions() const { return sourceDim; }
   void addAttribute(const std::string &attrib) { attributes.insert(attrib); }
 
+  // The dense index of the array in its module, which is the number of arrays
+  // added before it. Sorting the arrays of the module does not change it.
+  unsigned getIndex() const { return index; }
+
   void updateZeroDimension(uint64_t size) {
     sourceDim[0] = size;
     zeroDimensionValid = true;
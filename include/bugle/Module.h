@@ -7,6 +7,7 @@
 #include "bugle/OwningPtrVector.h"
 #include "bugle/util/UniqueNameSet.h"
 #include "bugle/Ref.h"
+#include <map>
 
 namespace bugle {
 
@@ -37,17 +38,44 @@ public:
     return F;
   }
 
+  // Add a function created outside of the module, such as one created while
+  // translating functions concurrently, making its name unique.
+  void adoptFunction(Function *F) {
+    F->setName(functionNames.makeName(makeBoogieIdent(F->getName())));
+    functions.push_back(F);
+  }
+
   GlobalArray *addGlobal(const std::string &name, Type rangeType,
                          const std::string &sourceName, Type sourceRangeType,
                          const std::vector<uint64_t> &sourceDim,
                          const bool isParameter) {
     GlobalArray *GA =
         new GlobalArray(globalNames.makeName(makeBoogieIdent(name)), rangeType,
-                        sourceName, sourceRangeType, sourceDim, isParameter);
+                        sourceName, sourceRangeType, sourceDim, isParameter,
+                        globals.size());
     globals.push_back(GA);
     return GA;
   }
 
+  // Order the global arrays and their initializers by Less and make the names
+  // of the arrays unique in that order, where NameOf gives the name each array
+  // was added with. The names then do not depend on the order in which the
+  // arrays were added.
+  template <typename CompareFn, typename NameFn>
+  void sortGlobals(CompareFn Less, NameFn NameOf) {
+    std::stable_sort(globals.begin(), globals.end(), Less);
+    std::map<GlobalArray *, unsigned> Index;
+    globalNames = UniqueNameSet();
+    for (auto i = globals.begin(), e = globals.end(); i != e; ++i) {
+      Index[*i] = i - globals.begin();
+      (*i)->setName(globalNames.makeName(makeBoogieIdent(NameOf(*i))));
+    }
+    std::stable_sort(globalInits.begin(), globalInits.end(),
+                     [&](const GlobalInit &L, const GlobalInit &R) {
+                       return Index[L.array] < Index[R.array];
+                     });
+  }
+
   OwningPtrVector<Function>::const_iterator function_begin() const {
     return functions.begin();
   }
@@ -89,6 +117,13 @@ public:
   void addGlobalInit(GlobalArray *array, uint64_t offset, ref<Expr> init) {
     globalInits.push_back(GlobalInit(array, offset, init));
   }
+  void removeGlobalInits(GlobalArray *array) {
+    globalInits.erase(std::remove_if(globalInits.begin(), globalInits.end(),
+                                     [&](const GlobalInit &GI) {
+                                       return GI.array == array;
+                                     }),
+                      globalInits.end());
+  }
 };
 }
 
@@ -15,6 +15,7 @@ private:
   llvm::Module *M;
   TranslateModule::SourceLanguage SL;
   std::set<std::string> GPUEntryPoints;
+  TranslateModule::GPUEntryPointSet EntryPoints;
 
   bool doInline(llvm::Instruction *I, llvm::Function *OF);
   void doInline(llvm::BasicBlock *B, llvm::Function *OF);
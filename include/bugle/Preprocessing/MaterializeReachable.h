@@ -0,0 +1,28 @@
+#ifndef BUGLE_PREPROCESSING_MATERIALIZEREACHABLE_H
+#define BUGLE_PREPROCESSING_MATERIALIZEREACHABLE_H
+
+#include "bugle/Translator/TranslateModule.h"
+#include <set>
+#include <string>
+
+namespace llvm {
+
+class Module;
+}
+
+namespace bugle {
+
+// Materializes the bodies of the functions of the lazily loaded module M that
+// can be reached from the functions that survive preprocessing regardless of
+// their uses: entry points, annotation functions, the functions named in
+// ExternalRoots, which are referred to from outside of M, and, unless all
+// normal functions will be internalized, functions that are not discardable.
+// The bodies of all other functions are never read, and the functions are
+// removed.
+void materializeReachable(llvm::Module *M, TranslateModule::SourceLanguage SL,
+                          std::set<std::string> &GPUEntryPoints,
+                          const std::set<std::string> &ExternalRoots,
+                          bool Internalize, bool OnlyExplicitEntryPoints);
+}
+
+#endif
@@ -3,19 +3,25 @@
 
 #include "bugle/Translator/TranslateModule.h"
 #include "llvm/Pass.h"
-#include "llvm/IR/DebugInfo.h"
+
+namespace llvm {
+
+class DISubprogram;
+}
 
 namespace bugle {
 
+class DebugInfoIndex;
+
 class RestrictDetectPass : public llvm::FunctionPass {
 private:
   llvm::Module *M;
-  llvm::DebugInfoFinder DIF;
+  const DebugInfoIndex &DebugInfo;
   TranslateModule::SourceLanguage SL;
   std::set<std::string> GPUEntryPoints;
+  TranslateModule::GPUEntryPointSet EntryPoints;
   TranslateModule::AddressSpaceMap AddressSpaces;
 
-  const llvm::DISubprogram *getDebugInfo(llvm::Function *F);
   std::string getFunctionLocation(llvm::Function *F);
   bool ignoreArgument(unsigned i, const llvm::DISubprogram *DIS);
   void doRestrictCheck(llvm::Function &F);
@@ -25,8 +31,10 @@ public:
 
   RestrictDetectPass(TranslateModule::SourceLanguage SL,
                      std::set<std::string> &EP,
-                     TranslateModule::AddressSpaceMap &AS)
-      : FunctionPass(ID), M(0), SL(SL), GPUEntryPoints(EP), AddressSpaces(AS) {}
+                     TranslateModule::AddressSpaceMap &AS,
+                     const DebugInfoIndex &DI)
+      : FunctionPass(ID), M(0), DebugInfo(DI), SL(SL), GPUEntryPoints(EP),
+        AddressSpaces(AS) {}
 
   llvm::StringRef getPassName() const override {
     return "Detect restrict usage on global pointers";
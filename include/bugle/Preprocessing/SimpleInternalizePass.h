@@ -11,14 +11,18 @@ private:
   llvm::Module *M;
   TranslateModule::SourceLanguage SL;
   std::set<std::string> GPUEntryPoints;
+  TranslateModule::GPUEntryPointSet EntryPoints;
   bool OnlyExplicitEntryPoints;
 
-  bool isEntryPoint(llvm::Function *F);
   bool doInternalize(llvm::Function *F);
 
 public:
   static char ID;
 
+  static bool isEntryPoint(TranslateModule::SourceLanguage SL,
+                           const TranslateModule::GPUEntryPointSet &EPS,
+                           bool OnlyExplicitEntryPoints, llvm::Function *F);
+
   SimpleInternalizePass(TranslateModule::SourceLanguage SL,
                         std::set<std::string> &EP, bool EEP)
       : ModulePass(ID), M(nullptr), SL(SL), GPUEntryPoints(EP),
@@ -5,17 +5,17 @@
 
 namespace llvm {
 
-class ToolOutputFile;
+class raw_ostream;
 }
 
 namespace bugle {
 
 class SourceLocWriter {
-  llvm::ToolOutputFile *L;
+  llvm::raw_ostream *L;
   unsigned SourceLocCounter;
 
 public:
-  SourceLocWriter(llvm::ToolOutputFile *L) : L(L), SourceLocCounter(0) {}
+  SourceLocWriter(llvm::raw_ostream *L) : L(L), SourceLocCounter(0) {}
   unsigned writeSourceLocs(const SourceLocsRef &sourcelocs);
 };
 }
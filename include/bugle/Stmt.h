@@ -29,25 +29,26 @@ public:
   };
 
   virtual ~Stmt() {}
-  virtual Kind getKind() const = 0;
+  Kind getKind() const { return kind; }
   virtual SourceLocsRef &getSourceLocs() { return sourcelocs; }
 
 protected:
-  Stmt() {}
-  Stmt(const SourceLocsRef &sourcelocs) : sourcelocs(sourcelocs) {}
+  Stmt(Kind kind) : kind(kind) {}
+  Stmt(Kind kind, const SourceLocsRef &sourcelocs)
+      : kind(kind), sourcelocs(sourcelocs) {}
 
 private:
+  const Kind kind;
   SourceLocsRef sourcelocs;
 };
 
 #define STMT_KIND(kind)                                                        \
-  Kind getKind() const override { return kind; }                               \
   static bool classof(const Stmt *S) { return S->getKind() == kind; }          \
   static bool classof(const kind##Stmt *) { return true; }
 
 class EvalStmt : public Stmt {
   EvalStmt(ref<Expr> expr, const SourceLocsRef &sourcelocs)
-      : Stmt(sourcelocs), expr(expr) {}
+      : Stmt(Eval, sourcelocs), expr(std::move(expr)) {}
   ref<Expr> expr;
 
 public:
@@ -61,7 +62,8 @@ public:
 class StoreStmt : public Stmt {
   StoreStmt(ref<Expr> array, ref<Expr> offset, ref<Expr> value,
             const SourceLocsRef &sourcelocs)
-      : Stmt(sourcelocs), array(array), offset(offset), value(value) {}
+      : Stmt(Store, sourcelocs), array(std::move(array)),
+        offset(std::move(offset)), value(std::move(value)) {}
   ref<Expr> array;
   ref<Expr> offset;
   ref<Expr> value;
@@ -77,16 +79,15 @@ public:
 };
 
 class VarAssignStmt : public Stmt {
-  VarAssignStmt(const std::vector<Var *> &vars,
-                const std::vector<ref<Expr>> &values)
-      : vars(vars), values(values) {}
+  VarAssignStmt(std::vector<Var *> vars, std::vector<ref<Expr>> values)
+      : Stmt(VarAssign), vars(std::move(vars)), values(std::move(values)) {}
   std::vector<Var *> vars;
   std::vector<ref<Expr>> values;
 
 public:
   static VarAssignStmt *create(Var *var, ref<Expr> value);
-  static VarAssignStmt *create(const std::vector<Var *> &vars,
-                               const std::vector<ref<Expr>> &values);
+  static VarAssignStmt *create(std::vector<Var *> vars,
+                               std::vector<ref<Expr>> values);
 
   SourceLocsRef &getSourceLocs() override {
     llvm_unreachable("No source location");
@@ -98,7 +99,8 @@ public:
 };
 
 class GotoStmt : public Stmt {
-  GotoStmt(const std::vector<BasicBlock *> &blocks) : blocks(blocks) {}
+  GotoStmt(const std::vector<BasicBlock *> &blocks)
+      : Stmt(Goto), blocks(blocks) {}
   std::vector<BasicBlock *> blocks;
 
 public:
@@ -114,7 +116,7 @@ public:
 };
 
 class ReturnStmt : public Stmt {
-  ReturnStmt() {}
+  ReturnStmt() : Stmt(Return) {}
 
 public:
   static ReturnStmt *create();
@@ -124,7 +126,7 @@ public:
 
 class AssumeStmt : public Stmt {
   AssumeStmt(ref<Expr> pred, bool partition)
-      : pred(pred), partition(partition) {}
+      : Stmt(Assume), pred(std::move(pred)), partition(partition) {}
   ref<Expr> pred;
   bool partition;
 
@@ -143,8 +145,9 @@ public:
 
 class AssertStmt : public Stmt {
   AssertStmt(ref<Expr> pred, const SourceLocsRef &sourcelocs)
-      : Stmt(sourcelocs), pred(pred), global(false), candidate(false),
-        invariant(false), badAccess(false), blockSourceLoc(false) {}
+      : Stmt(Assert, sourcelocs), pred(std::move(pred)), global(false),
+        candidate(false), invariant(false), badAccess(false),
+        blockSourceLoc(false) {}
   ref<Expr> pred;
   bool global;
   bool candidate;
@@ -171,14 +174,14 @@ public:
 };
 
 class CallStmt : public Stmt {
-  CallStmt(Function *callee, const std::vector<ref<Expr>> &args,
+  CallStmt(Function *callee, std::vector<ref<Expr>> args,
            const SourceLocsRef &sourcelocs)
-      : Stmt(sourcelocs), callee(callee), args(args) {}
+      : Stmt(Call, sourcelocs), callee(callee), args(std::move(args)) {}
   Function *callee;
   std::vector<ref<Expr>> args;
 
 public:
-  static CallStmt *create(Function *callee, const std::vector<ref<Expr>> &args,
+  static CallStmt *create(Function *callee, std::vector<ref<Expr>> args,
                           const SourceLocsRef &sourcelocs);
 
   STMT_KIND(Call)
@@ -189,7 +192,8 @@ public:
 class CallMemberOfStmt : public Stmt {
   CallMemberOfStmt(ref<Expr> func, std::vector<Stmt *> &callStmts,
                    const SourceLocsRef &sourcelocs)
-      : Stmt(sourcelocs), func(func), callStmts(callStmts) {}
+      : Stmt(CallMemberOf, sourcelocs), func(std::move(func)),
+        callStmts(callStmts) {}
   ref<Expr> func;
   std::vector<Stmt *> callStmts;
 
@@ -205,7 +209,7 @@ public:
 
 class WaitGroupEventStmt : public Stmt {
   WaitGroupEventStmt(ref<Expr> handle, const SourceLocsRef &sourcelocs)
-    : Stmt(sourcelocs), handle(handle) {}
+    : Stmt(WaitGroupEvent, sourcelocs), handle(std::move(handle)) {}
   ref<Expr> handle;
 
 public:
@@ -0,0 +1,59 @@
+#ifndef BUGLE_STMTVISITOR_H
+#define BUGLE_STMTVISITOR_H
+
+#include "bugle/Stmt.h"
+#include "llvm/Support/ErrorHandling.h"
+
+namespace bugle {
+
+/// Base class for visitors of statements, in the manner of ExprVisitor.
+/// visit() switches on the kind stored in the statement and calls the
+/// visitKindStmt method of SubClass for that kind, which forwards to visitStmt
+/// unless overridden.
+template <typename SubClass, typename RetTy = void, typename... ArgTys>
+class StmtVisitor {
+public:
+  RetTy visit(Stmt *S, ArgTys... Args) {
+    switch (S->getKind()) {
+#define HANDLE_STMT(Kind)                                                      \
+  case Stmt::Kind:                                                             \
+    return static_cast<SubClass *>(this)->visit##Kind##Stmt(                   \
+        static_cast<Kind##Stmt *>(S), Args...);
+      HANDLE_STMT(Eval)
+      HANDLE_STMT(Store)
+      HANDLE_STMT(VarAssign)
+      HANDLE_STMT(Goto)
+      HANDLE_STMT(Return)
+      HANDLE_STMT(Assume)
+      HANDLE_STMT(Assert)
+      HANDLE_STMT(Call)
+      HANDLE_STMT(CallMemberOf)
+      HANDLE_STMT(WaitGroupEvent)
+#undef HANDLE_STMT
+    }
+    llvm_unreachable("Unknown statement kind");
+  }
+
+#define HANDLE_STMT(Kind)                                                      \
+  RetTy visit##Kind##Stmt(Kind##Stmt *S, ArgTys... Args) {                     \
+    return static_cast<SubClass *>(this)->visitStmt(S, Args...);               \
+  }
+  HANDLE_STMT(Eval)
+  HANDLE_STMT(Store)
+  HANDLE_STMT(VarAssign)
+  HANDLE_STMT(Goto)
+  HANDLE_STMT(Return)
+  HANDLE_STMT(Assume)
+  HANDLE_STMT(Assert)
+  HANDLE_STMT(Call)
+  HANDLE_STMT(CallMemberOf)
+  HANDLE_STMT(WaitGroupEvent)
+#undef HANDLE_STMT
+
+  RetTy visitStmt(Stmt *, ArgTys...) {
+    llvm_unreachable("Unhandled statement kind");
+  }
+};
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef BUGLE_TRANSLATOR_DEBUGINFOINDEX_H
+#define BUGLE_TRANSLATOR_DEBUGINFOINDEX_H
+
+#include <map>
+#include <string>
+#include <utility>
+
+namespace llvm {
+
+class DILocalVariable;
+class DISubprogram;
+class Function;
+class Module;
+class Value;
+}
+
+namespace bugle {
+
+/// Indexes the debug information of a module, so that the source names of its
+/// functions and values can be looked up without scanning the module. The
+/// index is built once the preprocessing passes that change the IR have run,
+/// and is shared by the remaining passes and the translator.
+class DebugInfoIndex {
+  std::map<const llvm::Function *, const llvm::DISubprogram *> Subprograms;
+  // The variable described by the first debug intrinsic referring to a value
+  // in a function.
+  std::map<std::pair<const llvm::Function *, const llvm::Value *>,
+           const llvm::DILocalVariable *> LocalVars;
+
+public:
+  DebugInfoIndex(llvm::Module *M);
+
+  const llvm::DISubprogram *getSubprogram(const llvm::Function *F) const;
+  const llvm::DILocalVariable *getLocalVariable(const llvm::Value *V,
+                                                const llvm::Function *F) const;
+  std::string getSourceFunctionName(const llvm::Function *F) const;
+  std::string getSourceName(const llvm::Value *V,
+                            const llvm::Function *F) const;
+};
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef BUGLE_TRANSLATOR_POINTERMODELFILE_H
+#define BUGLE_TRANSLATOR_POINTERMODELFILE_H
+
+#include "llvm/ADT/StringRef.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+class Value;
+}
+
+namespace bugle {
+
+class TranslateModule;
+
+/// Saves the pointer models that the fixed point computation in
+/// TranslateModule::translate converged to, such that a later translation of
+/// the same module can start from them and finish in a single round. The
+/// values are identified by their position in the module, and the models are
+/// only loaded if the module and the options that affect them are unchanged:
+/// the fixed point computation never revisits a global offset model, so the
+/// models of an edited module could be wrong.
+class PointerModelFile {
+  TranslateModule *TM;
+  std::string Path;
+  std::string Key;      // identifies the module and options
+  std::string Contents; // the contents of the file when it was loaded
+  std::vector<llvm::Value *> Values;
+  std::map<llvm::Value *, unsigned> Numbers;
+
+  void numberValues();
+  bool parse(llvm::StringRef Contents);
+  bool print(std::string &Contents);
+
+public:
+  PointerModelFile(TranslateModule *TM, const std::string &Path)
+      : TM(TM), Path(Path) {}
+  bool load();
+  void save();
+};
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef BUGLE_TRANSLATOR_POINTERMODELINFERENCE_H
+#define BUGLE_TRANSLATOR_POINTERMODELINFERENCE_H
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace llvm {
+
+class Function;
+class PHINode;
+class Type;
+class Value;
+}
+
+namespace bugle {
+
+class TranslateModule;
+struct Type;
+
+/// Infers the byte array and global offset models of TranslateModule from the
+/// LLVM IR before any function is translated, such that the fixed point
+/// computation in TranslateModule::translate usually converges in a single
+/// round. Models are only inferred where the translation is known to arrive
+/// at the same model; everything else is left to the fixed point computation.
+class PointerModelInference {
+  // An abstraction of the translation of a pointer value.
+  struct PointerInfo {
+    enum Kind {
+      Known,  // the translation refers to one of the arrays in Arrays
+      Opaque, // the translation refers to an unknown array
+      Unsure  // the translation is not modelled by the inference
+    };
+
+    Kind K;
+    std::set<llvm::Value *> Arrays; // nullptr stands for the null pointer
+    // The translated offset is ConstOffset plus terms which are all
+    // multiples of Stride; Stride is 0 if there are no such terms.
+    uint64_t ConstOffset, Stride;
+
+    PointerInfo(Kind K) : K(K), ConstOffset(0), Stride(K == Known ? 0 : 1) {}
+    bool isDivisibleBy(uint64_t Div) const;
+  };
+
+  TranslateModule *TM;
+  std::map<llvm::Value *, PointerInfo> InfoMap;
+  std::map<llvm::Value *, std::set<llvm::Value *>> Models, NextModels;
+  std::set<llvm::Value *> MayBeNull;
+  bool Changed, CaseSplit;
+
+  bool isTranslated(llvm::Function *F);
+  uint64_t getRangeBytes(llvm::Value *V);
+  Type getCandidateType(const std::set<llvm::Value *> &Arrays);
+  PointerInfo getModelledInfo(llvm::Value *V);
+  const PointerInfo &getInfo(llvm::Value *V);
+  PointerInfo computeInfo(llvm::Value *V);
+  PointerInfo computeGEPInfo(llvm::Value *V);
+  void modelAsByteArray(const PointerInfo &PI);
+  void checkAccess(llvm::Value *Ptr, llvm::Type *AccessTy);
+  void computeValueModel(llvm::Value *V, const std::vector<PointerInfo> &Infos);
+  void collectPhiInfos(llvm::PHINode *PN, std::set<llvm::PHINode *> &Found,
+                       std::vector<PointerInfo> &Infos);
+  void analyzeFunction(llvm::Function *F);
+  void analyzeCallSites(llvm::Function *F);
+
+public:
+  PointerModelInference(TranslateModule *TM) : TM(TM) {}
+  void infer();
+};
+}
+
+#endif
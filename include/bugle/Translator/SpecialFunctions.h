@@ -0,0 +1,124 @@
+#ifndef BUGLE_TRANSLATOR_SPECIALFUNCTIONS_H
+#define BUGLE_TRANSLATOR_SPECIALFUNCTIONS_H
+
+#include "bugle/Translator/TranslateModule.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace bugle {
+
+/// The functions and intrinsics that the translator treats specially. The
+/// kinds after SF_Barrier are translated by a handler of TranslateFunction;
+/// several names may share a kind.
+enum SpecialFunctionKind {
+  SF_None,
+  SF_Axiom,
+  SF_Specification,
+  SF_Barrier,
+
+  SF_UninterpretedFunction,
+  SF_Noop,
+  SF_AssertFail,
+  SF_Assume,
+  SF_Assert,
+  SF_GlobalAssert,
+  SF_CandidateAssert,
+  SF_CandidateGlobalAssert,
+  SF_Invariant,
+  SF_GlobalInvariant,
+  SF_CandidateInvariant,
+  SF_CandidateGlobalInvariant,
+  SF_NonTemporalLoadsBegin,
+  SF_NonTemporalLoadsEnd,
+  SF_Requires,
+  SF_Ensures,
+  SF_GlobalRequires,
+  SF_GlobalEnsures,
+  SF_RequiresFreshArray,
+  SF_FunctionWideInvariant,
+  SF_FunctionWideCandidateInvariant,
+  SF_ReadsFrom,
+  SF_WritesTo,
+  SF_Enabled,
+  SF_DominatorEnabled,
+  SF_OtherInt,
+  SF_OtherBool,
+  SF_OtherPtrBase,
+  SF_Old,
+  SF_ReturnVal,
+  SF_Implies,
+  SF_ReadHasOccurred,
+  SF_WriteHasOccurred,
+  SF_ReadOffset,
+  SF_WriteOffset,
+  SF_PtrOffset,
+  SF_PtrBase,
+  SF_ArraySnapshot,
+  SF_BarrierInvariant,
+  SF_BarrierInvariantBinary,
+  SF_AddNoovflUnsigned,
+  SF_AddNoovflSigned,
+  SF_AddNoovflPredicate,
+  SF_Add,
+  SF_Ite,
+  SF_AtomicHasTakenValue,
+  SF_Atomic,
+  SF_Memset,
+  SF_Memcpy,
+  SF_Trap,
+
+  SF_GetLocalId,
+  SF_GetGroupId,
+  SF_GetLocalSize,
+  SF_GetNumGroups,
+  SF_GetGlobalOffset,
+  SF_GetWorkDim,
+  SF_GetImageWidth,
+  SF_GetImageHeight,
+  SF_SamplerInitializer,
+  SF_AsyncWorkGroupCopy,
+  SF_WaitGroupEvents,
+
+  SF_Ceil,
+  SF_Ctpop,
+  SF_Cos,
+  SF_Ctlz,
+  SF_Exp,
+  SF_Exp2,
+  SF_Fabs,
+  SF_Fmax,
+  SF_Fmin,
+  SF_Floor,
+  SF_FrexpExp,
+  SF_FrexpFrac,
+  SF_Fma,
+  SF_Log,
+  SF_Log10,
+  SF_Log2,
+  SF_Pow,
+  SF_Powi,
+  SF_Rint,
+  SF_Rsqrt,
+  SF_SaddOvl,
+  SF_Sin,
+  SF_Sqrt,
+  SF_SsubOvl,
+  SF_Trunc,
+  SF_UaddOvl,
+  SF_UsubOvl
+};
+
+/// Classify the function with the given name in the given source language,
+/// returning SF_None if the function is not special in that language.
+SpecialFunctionKind lookupSpecialFunction(TranslateModule::SourceLanguage SL,
+                                          llvm::StringRef Name);
+
+/// Classify the function with the given name in any source language. Only
+/// meant for kinds that are special in every language.
+SpecialFunctionKind lookupSpecialFunction(llvm::StringRef Name);
+
+/// Classify the intrinsic with the given ID, returning SF_None if the
+/// translator does not support it.
+SpecialFunctionKind lookupSpecialIntrinsic(unsigned ID);
+}
+
+#endif
@@ -3,8 +3,8 @@
 
 #include "bugle/Ref.h"
 #include "bugle/Stmt.h"
+#include "bugle/Translator/SpecialFunctions.h"
 #include "bugle/Translator/TranslateModule.h"
-#include "llvm/ADT/StringMap.h"
 #include <functional>
 #include <map>
 #include <vector>
@@ -31,10 +31,6 @@ class Var;
 class TranslateFunction {
   typedef ref<Expr> SpecialFnHandler(BasicBlock *, llvm::CallInst *,
                                      const std::vector<klee::ref<Expr>> &);
-  struct SpecialFnMapTy {
-    llvm::StringMap<SpecialFnHandler TranslateFunction::*> Functions;
-    std::map<unsigned, SpecialFnHandler TranslateFunction::*> Intrinsics;
-  };
 
   typedef std::pair<llvm::Value *, ref<Expr>> PhiPair;
 
@@ -53,9 +49,6 @@ class TranslateFunction {
   std::map<unsigned, bugle::Function *> BinaryBarrierInvariants;
   SourceLocsRef currentSourceLocs;
 
-  SpecialFnMapTy &SpecialFunctionMap;
-  static SpecialFnMapTy SpecialFunctionMaps[TranslateModule::SL_Count];
-
   SpecialFnHandler handleNoop, handleAssertFail, handleAssume, handleAssert,
       handleGlobalAssert, handleCandidateAssert, handleCandidateGlobalAssert,
       handleInvariant, handleGlobalInvariant, handleCandidateInvariant,
@@ -87,17 +80,15 @@ class TranslateFunction {
 
   SpecialFnHandler handleAtomic;
 
-  static SpecialFnMapTy &
-  initSpecialFunctionMap(TranslateModule::SourceLanguage SL);
-
-  ref<Expr>
-  maybeTranslateSIMDInst(bugle::BasicBlock *BBB, llvm::Type *Ty,
-                         llvm::Type *OpTy, ref<Expr> Op,
-                         std::function<ref<Expr>(llvm::Type *, ref<Expr>)> F);
-  ref<Expr>
-  maybeTranslateSIMDInst(bugle::BasicBlock *BBB, llvm::Type *Ty,
-                         llvm::Type *OpTy, ref<Expr> LHS, ref<Expr> RHS,
-                         std::function<ref<Expr>(ref<Expr>, ref<Expr>)> F);
+  static SpecialFnHandler TranslateFunction::*
+  getSpecialFunctionHandler(SpecialFunctionKind K);
+
+  ref<Expr> maybeTranslateSIMDInst(
+      bugle::BasicBlock *BBB, llvm::Type *Ty, llvm::Type *OpTy, ref<Expr> Op,
+      const std::function<ref<Expr>(llvm::Type *, ref<Expr>)> &F);
+  ref<Expr> maybeTranslateSIMDInst(
+      bugle::BasicBlock *BBB, llvm::Type *Ty, llvm::Type *OpTy, ref<Expr> LHS,
+      ref<Expr> RHS, const std::function<ref<Expr>(ref<Expr>, ref<Expr>)> &F);
   ref<Expr> translateValue(llvm::Value *V, bugle::BasicBlock *BBB);
   void translateBasicBlock(BasicBlock *BBB, llvm::BasicBlock *BB);
   void translateInstruction(BasicBlock *BBB, llvm::Instruction *I);
@@ -110,7 +101,6 @@ class TranslateFunction {
   SourceLocsRef extractSourceLocsForBlock(llvm::BasicBlock *BB);
   SourceLocsRef extractSourceLocs(llvm::Instruction *I);
   void specifyZeroDimensions(unsigned PtrArgs);
-  void extractStructArrays(llvm::Value *V);
   void createStructArrays();
   void checkFunctionWideInvariant(llvm::CallInst *CI);
   bool isLegalFunctionWideInvariantValue(llvm::Value *V);
@@ -119,13 +109,10 @@ public:
   TranslateFunction(TranslateModule *TM, bugle::Function *BF, llvm::Function *F,
                     bool isGPUEntryPoint)
       : TM(TM), BF(BF), F(F), isGPUEntryPoint(isGPUEntryPoint), ReturnVar(0),
-        LoadsAreTemporal(true), currentSourceLocs(new SourceLocs),
-        SpecialFunctionMap(initSpecialFunctionMap(TM->SL)) {}
+        LoadsAreTemporal(true), currentSourceLocs(new SourceLocs) {}
 
   static bool isSpecialFunction(TranslateModule::SourceLanguage SL,
                                 const std::string &fnName);
-  static void addUninterpretedFunction(TranslateModule::SourceLanguage SL,
-                                       const std::string &fnName);
   static bool isAxiomFunction(llvm::StringRef fnName);
   static bool isUninterpretedFunction(llvm::StringRef fnName);
   static bool isSpecificationFunction(llvm::StringRef fnName);
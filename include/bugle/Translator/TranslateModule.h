@@ -5,12 +5,15 @@
 #include "bugle/Ref.h"
 #include "bugle/SourceLoc.h"
 #include "bugle/Type.h"
+#include "bugle/util/Statistics.h"
 #include "klee/util/GetElementPtrTypeIterator.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/IR/DataLayout.h"
-#include "llvm/IR/DebugInfo.h"
 #include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <vector>
 
@@ -18,15 +21,16 @@ namespace llvm {
 
 class CallInst;
 class Constant;
-class DILocalVariable;
 class DIType;
 class GlobalVariable;
 class Module;
 class PointerType;
+class raw_ostream;
 }
 
 namespace bugle {
 
+class DebugInfoIndex;
 class Expr;
 class Function;
 class GlobalArray;
@@ -54,18 +58,41 @@ public:
     AddressSpaceMap(unsigned Global, unsigned GroupShared, unsigned Constant);
   };
 
+  // The GPU entry points of a module: the kernels listed in its metadata and
+  // the functions named by the user. The metadata is only scanned on
+  // construction, so a set must be recomputed after functions are replaced.
+  class GPUEntryPointSet {
+    llvm::DenseSet<const llvm::Function *> Kernels;
+    std::set<std::string> Names;
+
+  public:
+    GPUEntryPointSet() {}
+    GPUEntryPointSet(llvm::Module *M, SourceLanguage SL,
+                     const std::set<std::string> &EPS);
+    bool contains(const llvm::Function *F) const {
+      return Kernels.count(F) || isExplicit(F);
+    }
+    // Whether F is named by the user as an entry point.
+    bool isExplicit(const llvm::Function *F) const;
+  };
+
 private:
   bugle::Module *BM;
   llvm::Module *M;
-  llvm::DebugInfoFinder DIF;
+  const DebugInfoIndex &DebugInfo;
   llvm::DataLayout TD;
   SourceLanguage SL;
   std::set<std::string> GPUEntryPoints;
+  GPUEntryPointSet EntryPoints;
   RaceInstrumenter RaceInst;
   AddressSpaceMap AddressSpaces;
   std::map<std::string, ArraySpec> GPUArraySizes;
+  std::string ModelsFile, ModelsStamp;
 
   std::map<llvm::Function *, bugle::Function *> FunctionMap;
+  // The functions that an indirect call through a pointer of the given type
+  // may call, in module order.
+  std::map<llvm::Type *, std::vector<llvm::Function *>> IndirectCallTargets;
   std::map<llvm::Function *, std::vector<llvm::Instruction *> *> StructMap;
   std::map<llvm::Constant *, ref<Expr>> ConstantMap;
 
@@ -76,13 +103,54 @@ private:
   std::set<llvm::Value *> ModelAsByteArray;
   bool ModelAllAsByteArray, NextModelAllAsByteArray;
 
-  std::map<llvm::Function *, std::vector<const std::vector<ref<Expr>> *>>
-      CallSites;
+  typedef std::map<llvm::Function *,
+                   std::vector<const std::vector<ref<Expr>> *>> CallSiteMap;
+  std::map<llvm::Function *, CallSiteMap> CallSites;
   bool NeedAdditionalGlobalOffsetModels;
   std::map<llvm::Value *, std::set<llvm::Value *>> ModelPtrAsGlobalOffset,
       NextModelPtrAsGlobalOffset;
   std::set<llvm::Value *> PtrMayBeNull, NextPtrMayBeNull;
 
+  // The values whose models were consulted while translating each function
+  // and each constant, such that a later round of the fixed point computation
+  // only needs to retranslate the functions whose models changed.
+  std::map<llvm::Function *, std::set<llvm::Value *>> FunctionModelUses;
+  std::map<llvm::Constant *, std::set<llvm::Value *>> ConstantModelUses;
+  // The auxiliary functions are only added to the module once the fixed point
+  // is reached, such that their names do not depend on which functions were
+  // retranslated.
+  std::map<llvm::Function *, std::vector<bugle::Function *>>
+      AuxiliaryFunctions;
+  std::map<llvm::Function *, ref<Expr>> Axioms;
+  std::set<llvm::Function *> RequestedByteArrayModels, RequestedCaseSplit;
+
+  // What the translation of a single function records. The functions of a
+  // round may be translated concurrently, so this is merged into the state of
+  // the module in module order once all of them have been translated.
+  struct FunctionTranslation {
+    llvm::Function *F;
+    bool IsGPUEntryPoint;
+    std::set<llvm::Value *> *ModelUses;
+    std::map<llvm::Constant *, ref<Expr>> Constants;
+    bool TranslatingConstant;
+    bool NeedAdditionalByteArrayModels, NextModelAllAsByteArray;
+    std::set<llvm::Value *> ByteArrayModels;
+    CallSiteMap CallSites;
+    std::vector<bugle::Function *> AuxiliaryFunctions;
+    ref<Expr> Axiom;
+    std::shared_ptr<StatisticsData> Stats;
+
+    FunctionTranslation(llvm::Function *F)
+        : F(F), IsGPUEntryPoint(false), ModelUses(nullptr),
+          TranslatingConstant(false), NeedAdditionalByteArrayModels(false),
+          NextModelAllAsByteArray(false) {}
+  };
+  static thread_local FunctionTranslation *CurrentTranslation;
+  // Guards the state shared by the translations of the functions of a round:
+  // the global arrays, the translated constants, the module and the models
+  // computed for the next round.
+  std::recursive_mutex StateMutex;
+
   ref<Expr> translate1dCUDABuiltinGlobal(std::string Prefix,
                                          llvm::GlobalVariable *GV);
   ref<Expr> translate3dCUDABuiltinGlobal(std::string Prefix,
@@ -93,6 +161,7 @@ private:
   bool hasInitializer(llvm::GlobalVariable *GV);
   ref<Expr> translateGlobalVariable(llvm::GlobalVariable *GV);
   void addGlobalArrayAttribs(GlobalArray *GA, llvm::PointerType *PT);
+  Type getGlobalArrayRangeType(llvm::Value *V);
   bugle::GlobalArray *getGlobalArray(llvm::Value *V, bool IsParameter = false);
 
   ref<Expr> translateConstant(llvm::Constant *C);
@@ -121,13 +190,12 @@ private:
   ref<Expr> translateICmp(llvm::CmpInst::Predicate P, ref<Expr> LHS,
                           ref<Expr> RHS);
 
-  ref<Expr>
-  maybeTranslateSIMDInst(llvm::Type *Ty, llvm::Type *OpTy, ref<Expr> Op,
-                         std::function<ref<Expr>(llvm::Type *, ref<Expr>)> F);
-  ref<Expr>
-  maybeTranslateSIMDInst(llvm::Type *Ty, llvm::Type *OpTy, ref<Expr> LHS,
-                         ref<Expr> RHS,
-                         std::function<ref<Expr>(ref<Expr>, ref<Expr>)> F);
+  ref<Expr> maybeTranslateSIMDInst(
+      llvm::Type *Ty, llvm::Type *OpTy, ref<Expr> Op,
+      const std::function<ref<Expr>(llvm::Type *, ref<Expr>)> &F);
+  ref<Expr> maybeTranslateSIMDInst(
+      llvm::Type *Ty, llvm::Type *OpTy, ref<Expr> LHS, ref<Expr> RHS,
+      const std::function<ref<Expr>(ref<Expr>, ref<Expr>)> &F);
 
   ref<Expr> modelValue(llvm::Value *V, ref<Expr> E);
   Type getModelledType(llvm::Value *V);
@@ -135,31 +203,54 @@ private:
   void computeValueModel(llvm::Value *Val, Var *Var,
                          llvm::ArrayRef<ref<Expr>> Assigns);
 
+  std::vector<llvm::Function *> getCallTargets(llvm::Type *T,
+                                               llvm::Function *F);
   Stmt *modelCallStmt(llvm::Type *T, llvm::Function *F, ref<Expr> Val,
                       std::vector<ref<Expr>> &args, SourceLocsRef &sourcelocs);
   ref<Expr> modelCallExpr(llvm::Type *T, llvm::Function *F, ref<Expr> Val,
                           std::vector<ref<Expr>> &args);
 
+  void recordModelUse(llvm::Value *V) {
+    if (CurrentTranslation && CurrentTranslation->ModelUses)
+      CurrentTranslation->ModelUses->insert(V);
+  }
+  void requestByteArrayModel(llvm::Value *V);
+  void requestByteArrayModels(llvm::ArrayRef<ref<Expr>> PtrArrs);
+  void requestAllByteArrayModels();
+  bugle::Function *addAuxiliaryFunction(const std::string &Name,
+                                        const std::string &SourceName);
+  static void extractStructArrays(llvm::Value *V,
+                                  std::vector<llvm::Instruction *> *SV);
+  std::vector<llvm::Instruction *> *getStructArrays(llvm::Function *F);
+
+  void resetModule();
+  std::set<llvm::Function *>
+  invalidateModels(const std::set<llvm::Value *> &Changed);
+  void prepareFunction(FunctionTranslation &FT);
+  void translateFunction(FunctionTranslation &FT);
+  void finishFunction(FunctionTranslation &FT);
+  void translateFunctions(const std::vector<llvm::Function *> &Fs);
+  void finishModule();
+  void writeModelKey(llvm::raw_ostream &OS);
+
+  static bool useMixedWidthArrays();
   Type defaultRange() {
     return ModelAllAsByteArray ? Type(Type::BV, 8) : Type(Type::Unknown);
   }
 
   static std::string getCompositeName(llvm::ArrayRef<unsigned> Idxs,
                                       llvm::DIType *Type);
-  static const llvm::DILocalVariable *getSourceDbgVar(llvm::Value *V,
-                                                      llvm::Function *F);
 
 public:
   TranslateModule(llvm::Module *M, SourceLanguage SL, std::set<std::string> &EP,
                   RaceInstrumenter RI, AddressSpaceMap &AS,
-                  std::map<std::string, ArraySpec> &GAS)
-      : BM(nullptr), M(M), TD(M), SL(SL), GPUEntryPoints(EP), RaceInst(RI),
-        AddressSpaces(AS), GPUArraySizes(GAS),
-        NeedAdditionalByteArrayModels(false), ModelAllAsByteArray(false),
-        NextModelAllAsByteArray(false),
-        NeedAdditionalGlobalOffsetModels(false) {
-    DIF.processModule(*M);
-  }
+                  std::map<std::string, ArraySpec> &GAS,
+                  const DebugInfoIndex &DI)
+      : BM(nullptr), M(M), DebugInfo(DI), TD(M), SL(SL), GPUEntryPoints(EP),
+        EntryPoints(M, SL, EP), RaceInst(RI), AddressSpaces(AS),
+        GPUArraySizes(GAS), NeedAdditionalByteArrayModels(false),
+        ModelAllAsByteArray(false), NextModelAllAsByteArray(false),
+        NeedAdditionalGlobalOffsetModels(false) {}
 
   ~TranslateModule() {
     for (auto i = StructMap.begin(), e = StructMap.end(); i != e; ++i) {
@@ -169,14 +260,19 @@ public:
     }
   }
 
-  static bool isGPUEntryPoint(llvm::Function *F, llvm::Module *M,
-                              SourceLanguage SL, std::set<std::string> &EPS);
-  std::string getSourceFunctionName(llvm::Function *F);
-  static std::string getSourceGlobalArrayName(llvm::Value *V);
-  static std::string getSourceName(llvm::Value *V, llvm::Function *F);
+  std::string getSourceGlobalArrayName(llvm::Value *V);
+  // Start the translation from the pointer models saved in Path, if they were
+  // saved for the same module by the translator identified by Stamp, and save
+  // the converged models there.
+  void setModelsFile(const std::string &Path, const std::string &Stamp) {
+    ModelsFile = Path;
+    ModelsStamp = Stamp;
+  }
   void translate();
   bugle::Module *takeModule() { return BM; }
 
+  friend class PointerModelFile;
+  friend class PointerModelInference;
   friend class TranslateFunction;
 };
 }
@@ -15,11 +15,16 @@ class ErrorReporter {
 private:
   ErrorReporter();
 
-  static std::string FileName;
+  static thread_local std::string FileName;
   static void printErrorMsg(const std::string &msg);
 
 public:
   static void setFileName(const std::string &FN);
+  static const std::string &getFileName() { return FileName; }
+  // Ends the process after an error. On a thread other than the main one,
+  // such as a worker translating part of a module, the process ends without
+  // running destructors that other threads may still depend on.
+  NO_RETURN static void terminate();
   static void emitWarning(const std::string &msg);
   NO_RETURN static void reportParameterError(const std::string &msg);
   NO_RETURN static void reportFatalError(const std::string &msg);
@@ -0,0 +1,17 @@
+#ifndef BUGLE_UTIL_JSON_H
+#define BUGLE_UTIL_JSON_H
+
+#include "llvm/ADT/StringRef.h"
+
+namespace llvm {
+
+class raw_ostream;
+}
+
+namespace bugle {
+
+// Writes S to OS as a quoted and escaped JSON string.
+void writeJSONString(llvm::raw_ostream &OS, llvm::StringRef S);
+}
+
+#endif
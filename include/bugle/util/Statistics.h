@@ -0,0 +1,56 @@
+#ifndef BUGLE_UTIL_STATISTICS_H
+#define BUGLE_UTIL_STATISTICS_H
+
+#include "llvm/ADT/StringRef.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace llvm {
+
+class raw_ostream;
+}
+
+namespace bugle {
+
+struct StatisticsData;
+
+// Collects the statistics of a translation. Statistics are kept per thread,
+// so that translations running concurrently are accounted separately. All
+// functions other than enable and isEnabled must only be called if collection
+// is enabled.
+class Statistics {
+private:
+  Statistics();
+
+  static bool Enabled;
+
+public:
+  static void enable() { Enabled = true; }
+  static bool isEnabled() { return Enabled; }
+
+  // Discards the statistics collected so far by this thread.
+  static void reset();
+
+  // Adds Amount to the counter Name.
+  static void add(llvm::StringRef Name, uint64_t Amount = 1);
+  // Adds Amount to the entry Key of the group of counters Name.
+  static void add(llvm::StringRef Name, llvm::StringRef Key,
+                  uint64_t Amount = 1);
+  // Adds Delta to the gauge Name, recording its peak value.
+  static void adjust(llvm::StringRef Name, int64_t Delta);
+  // Appends Value to the list Name.
+  static void append(llvm::StringRef Name, llvm::StringRef Value);
+
+  // Removes the statistics collected by this thread and returns them, such
+  // that work done on behalf of another thread can be accounted to it.
+  static std::shared_ptr<StatisticsData> take();
+  // Adds statistics taken from another thread to those of this thread.
+  static void merge(const StatisticsData &Other);
+
+  // Writes the statistics collected by this thread as a JSON object.
+  static void write(llvm::raw_ostream &OS);
+};
+}
+
+#endif
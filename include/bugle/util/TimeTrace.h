@@ -0,0 +1,78 @@
+#ifndef BUGLE_UTIL_TIMETRACE_H
+#define BUGLE_UTIL_TIMETRACE_H
+
+#include "llvm/ADT/StringRef.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace llvm {
+
+class raw_ostream;
+}
+
+namespace bugle {
+
+// Collects wall-clock spans of the phases of a translation, which can be
+// written in the Chrome trace event format (as read by chrome://tracing and
+// Perfetto). Spans may be recorded from multiple threads. Where available,
+// each span also records how much the peak resident set size of the process
+// grew during the span, and the trace records the peak resident set size of
+// the process and its children.
+class TimeTrace {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+private:
+  TimeTrace();
+
+  static bool Enabled;
+
+public:
+  static void enable();
+  static bool isEnabled() { return Enabled; }
+  // Returns the peak resident set size of this process so far in kilobytes,
+  // or 0 if it is not known.
+  static uint64_t getPeakRSS();
+  // Records a span, where StartPeakRSS is the peak resident set size at its
+  // start.
+  static void addSpan(llvm::StringRef Name, llvm::StringRef Detail,
+                      Clock::time_point Start, Clock::time_point End,
+                      uint64_t StartPeakRSS);
+  // Discards the spans recorded so far, such as those a child process
+  // inherits from its parent.
+  static void reset();
+  // Writes the spans recorded by this process as trace events, separated by
+  // commas, such that another process can add them to its trace.
+  static void writeEvents(llvm::raw_ostream &OS);
+  // Adds events written by writeEvents in another process.
+  static void addEvents(llvm::StringRef Events);
+  static void write(llvm::raw_ostream &OS);
+};
+
+// Records a span covering the lifetime of the scope, if tracing is enabled.
+class TimeTraceScope {
+  bool Active;
+  std::string Name, Detail;
+  TimeTrace::Clock::time_point Start;
+  uint64_t StartPeakRSS;
+
+public:
+  TimeTraceScope(llvm::StringRef Name, llvm::StringRef Detail = "")
+      : Active(TimeTrace::isEnabled()) {
+    if (Active) {
+      this->Name = Name.str();
+      this->Detail = Detail.str();
+      Start = TimeTrace::Clock::now();
+      StartPeakRSS = TimeTrace::getPeakRSS();
+    }
+  }
+  ~TimeTraceScope() {
+    if (Active)
+      TimeTrace::addSpan(Name, Detail, Start, TimeTrace::Clock::now(),
+                         StartPeakRSS);
+  }
+};
+}
+
+#endif
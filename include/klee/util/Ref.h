@@ -19,6 +19,7 @@ using llvm::dyn_cast_or_null;
 
 #include <assert.h>
 #include <iosfwd> // FIXME: Remove this!!!
+#include <utility>
 
 namespace klee {
 
@@ -61,6 +62,16 @@ public:
     inc();
   }
 
+  // move constructors, which take over the reference of r
+  ref(ref<T> &&r) : ptr(r.ptr) {
+    r.ptr = 0;
+  }
+
+  template<class U>
+  ref (ref<U> &&r) : ptr(r.ptr) {
+    r.ptr = 0;
+  }
+
   // pointer operations
   T *get () const {
     return ptr;
@@ -84,6 +95,26 @@ public:
     return *this;
   }
 
+  /* r is cleared before the old referent is released, as r may be owned
+   * by it. This also makes self-assignment safe. */
+  ref<T> &operator= (ref<T> &&r) {
+    T *p = r.ptr;
+    r.ptr = 0;
+    dec();
+    ptr = p;
+
+    return *this;
+  }
+
+  template<class U> ref<T> &operator= (ref<U> &&r) {
+    U *p = r.ptr;
+    r.ptr = 0;
+    dec();
+    ptr = p;
+
+    return *this;
+  }
+
   T& operator*() const {
     return *ptr;
   }
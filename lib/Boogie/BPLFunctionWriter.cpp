@@ -1,4 +1,5 @@
 #include "bugle/BPLFunctionWriter.h"
+#include "bugle/ArrayCandidates.h"
 #include "bugle/BPLModuleWriter.h"
 #include "bugle/BasicBlock.h"
 #include "bugle/Casting.h"
@@ -11,6 +12,8 @@
 #include "bugle/SourceLocWriter.h"
 #include "bugle/Stmt.h"
 #include "bugle/util/ErrorReporter.h"
+#include "bugle/util/Statistics.h"
+#include "bugle/util/TimeTrace.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
@@ -26,23 +29,23 @@ void BPLFunctionWriter::maybeWriteCaseSplit(
     writeSourceLocs(OS, SLocs);
     OS << "false;\n";
   } else {
-    std::set<GlobalArray *> Globals;
-    if (!PtrArr->computeArrayCandidates(Globals)) {
-      // If we could not compute any candidates, then we take all arrays
-      // and the null pointer as candidates.
-      Globals.insert(MW->M->global_begin(), MW->M->global_end());
-      Globals.insert(nullptr);
-    }
+    // If we could not compute any candidates, then we take all arrays and the
+    // null pointer as candidates.
+    auto &Globals = getArrayCandidates(PtrArr);
 
-    if (Globals.size() == 1 && *Globals.begin() != nullptr) {
-      F(*Globals.begin(), 2);
+    if (auto GA = Globals.getSingleArray()) {
+      F(GA, 2);
       OS << "\n";
     } else {
+      if (Statistics::isEnabled()) {
+        Statistics::add("case-splits");
+        Statistics::add("case-split-fanout", std::to_string(Globals.size()));
+      }
       MW->UsesPointers = true;
       OS << "  ";
-      for (auto i = Globals.begin(), e = Globals.end(); i != e; ++i) {
-        if (*i == nullptr)
-          continue; // Null pointer; dealt with as last case
+      // The null pointer is dealt with as the last case.
+      auto Sorted = sortGlobals(Globals);
+      for (auto i = Sorted.begin(), e = Sorted.end(); i != e; ++i) {
         OS << "if (";
         writeExpr(OS, PtrArr);
         OS << " == $arrayId$$" << (*i)->getName() << ") {\n";
@@ -79,280 +82,294 @@ void BPLFunctionWriter::writeCallStmt(llvm::raw_ostream &OS, CallStmt *CS) {
 }
 
 void BPLFunctionWriter::writeStmt(llvm::raw_ostream &OS, Stmt *S) {
-  if (auto ES = dyn_cast<EvalStmt>(S)) {
-    assert(!ES->getExpr()->preventEvalStmt);
-    assert(SSAVarIds.find(ES->getExpr().get()) == SSAVarIds.end());
-    unsigned id = SSAVarIds.size();
-    if (auto ASE = dyn_cast<ArraySnapshotExpr>(ES->getExpr())) {
-      auto DstArray = ASE->getDst().get();
-      auto SrcArray = ASE->getSrc().get();
-
-      assert(!(isa<NullArrayRefExpr>(DstArray) ||
-               isa<NullArrayRefExpr>(SrcArray) ||
-               MW->M->global_begin() == MW->M->global_end()));
-
-      std::set<GlobalArray *> GlobalsDst;
-      if (!DstArray->computeArrayCandidates(GlobalsDst)) {
-        GlobalsDst.insert(MW->M->global_begin(), MW->M->global_end());
-      }
-
-      std::set<GlobalArray *> GlobalsSrc;
-      if (!SrcArray->computeArrayCandidates(GlobalsSrc)) {
-        GlobalsSrc.insert(MW->M->global_begin(), MW->M->global_end());
-      }
-
-      if (GlobalsDst.size() == 1 && GlobalsSrc.size() == 1) {
-        OS << "  $$" << (*GlobalsDst.begin())->getName() << " := "
-           << "$$" << (*GlobalsSrc.begin())->getName() << ";\n";
-      } else {
-        ErrorReporter::reportImplementationLimitation(
-            "Array snapshots on pointers not supported");
-      }
-      return;
-    }
-    if (isa<CallExpr>(ES->getExpr())) {
-      OS << "  call ";
-      writeSourceLocs(OS, ES->getSourceLocs());
-    }
-    if (isa<AddNoovflExpr>(ES->getExpr())) {
-      OS << "  call ";
-    }
-    if (isa<HavocExpr>(ES->getExpr())) {
-      OS << "  havoc v" << id << ";\n";
-    } else if (auto CMOE = dyn_cast<CallMemberOfExpr>(ES->getExpr())) {
-      auto CES = CMOE->getCallExprs();
-      auto SL = ES->getSourceLocs();
-      auto F = CMOE->getFunc();
-      OS << "  ";
-      for (auto i = CES.begin(), e = CES.end(); i != e; ++i) {
-        auto CE = cast<CallExpr>(i->get());
-        OS << "if (";
-        writeExpr(OS, F.get());
-        OS << " == $functionId$$" << CE->getCallee()->getName() << ") {\n";
-        OS << "    call ";
-        writeSourceLocs(OS, SL);
-        OS << "v" << id << " := ";
-        writeExpr(OS, CE);
-        OS << ";\n  } else ";
-      }
-      OS << "{\n    assert {:bad_pointer_access} ";
-      writeSourceLocs(OS, SL);
-      OS << "false;\n  }\n";
-    } else if (auto LE = dyn_cast<LoadExpr>(ES->getExpr())) {
-      maybeWriteCaseSplit(OS, LE->getArray().get(), ES->getSourceLocs(),
-                          [&](GlobalArray *GA, unsigned int indent) {
-        writeSourceLocsMarker(OS, ES->getSourceLocs(), indent);
-        assert(LE->getType() == GA->getRangeType());
-        OS << std::string(indent, ' ');
-        OS << "v" << id << " := $$" << GA->getName() << "[";
-        writeExpr(OS, LE->getOffset().get());
-        OS << "];";
-      });
-    } else if (auto AE = dyn_cast<AtomicExpr>(ES->getExpr())) {
-      maybeWriteCaseSplit(OS, AE->getArray().get(), ES->getSourceLocs(),
-                          [&](GlobalArray *GA, unsigned int indent) {
-        writeSourceLocsMarker(OS, ES->getSourceLocs(), indent);
-        assert(AE->getType() == GA->getRangeType());
-        OS << std::string(indent, ' ');
-        OS << "call {:atomic} ";
-        OS << "{:atomic_function \"" << AE->getFunction() << "\"} ";
-        for (unsigned int i = 0; i < AE->getArgs().size(); i++) {
-          OS << "{:arg" << (i + 1) << " ";
-          writeExpr(OS, AE->getArgs()[i].get());
-          OS << "} ";
-        }
-        OS << "{:parts " << AE->getParts() << "} ";
-        OS << "{:part " << AE->getPart() << "} ";
-        OS << "v" << id << ", $$" << GA->getName();
-        OS << " := _ATOMIC_OP" << GA->getRangeType().width;
-        OS << "($$" << GA->getName() << ", ";
-        writeExpr(OS, AE->getOffset().get());
-        OS << ");";
-      });
-    } else if (auto AWGCE = dyn_cast<AsyncWorkGroupCopyExpr>(ES->getExpr())) {
-      auto DstArray = AWGCE->getDst().get();
-      auto DstOffset = AWGCE->getDstOffset().get();
-      auto SrcArray = AWGCE->getSrc().get();
-      auto SrcOffset = AWGCE->getSrcOffset().get();
-
-      std::set<GlobalArray *> GlobalsDst;
-      if (!DstArray->computeArrayCandidates(GlobalsDst)) {
-        GlobalsDst.insert(MW->M->global_begin(), MW->M->global_end());
-      }
-
-      std::set<GlobalArray *> GlobalsSrc;
-      if (!SrcArray->computeArrayCandidates(GlobalsSrc)) {
-        GlobalsSrc.insert(MW->M->global_begin(), MW->M->global_end());
-      }
-
-      if (GlobalsDst.size() != 1 || GlobalsSrc.size() != 1) {
-        ErrorReporter::reportImplementationLimitation(
-            "Async work group copies on pointers not supported");
-      }
+  StmtVisitor::visit(S, OS);
+}
 
-      auto dst = *GlobalsDst.begin();
-      auto src = *GlobalsSrc.begin();
-      assert(dst->getRangeType() == src->getRangeType());
-
-      MW->writeIntrinsic([&](llvm::raw_ostream &OS) {
-        OS << "procedure {:async_work_group_copy} _ASYNC_WORK_GROUP_COPY_"
-           << dst->getRangeType().width
-           << "(dstOffset : " << MW->IntRep->getType(DstOffset->getType().width)
-           << ", src : [" << MW->IntRep->getType(MW->M->getPointerWidth())
-           << "]" << MW->IntRep->getType(src->getRangeType().width)
-           << ", srcOffset : "
-           << MW->IntRep->getType(SrcOffset->getType().width)
-           << ", size : " << MW->IntRep->getType(MW->M->getPointerWidth())
-           << ", handle : " << MW->IntRep->getType(MW->M->getPointerWidth())
-           << ") returns (handle' : "
-           << MW->IntRep->getType(MW->M->getPointerWidth()) << ", dst : ["
-           << MW->IntRep->getType(MW->M->getPointerWidth()) << "]"
-           << MW->IntRep->getType(dst->getRangeType().width) << ")";
-      });
-      writeSourceLocsMarker(OS, ES->getSourceLocs(), 2);
-      OS << "  ";
-      OS << "call {:async_work_group_copy} v" << id << ", $$" << dst->getName()
-         << " := _ASYNC_WORK_GROUP_COPY_" << dst->getRangeType().width << "(";
-      writeExpr(OS, DstOffset);
-      OS << ", "
-         << "$$" << src->getName() << ", ";
-      writeExpr(OS, SrcOffset);
-      OS << ", ";
-      writeExpr(OS, AWGCE->getSize().get());
-      OS << ", ";
-      writeExpr(OS, AWGCE->getHandle().get());
-      OS << ");\n";
-    } else if (auto CE = dyn_cast<BVCtlzExpr>(ES->getExpr())) {
-      unsigned Width = CE->getVal()->getType().width;
-
-      MW->writeIntrinsic([&](llvm::raw_ostream &OS) {
-                           OS << MW->IntRep->getArithmeticBinary(
-                               "LSHR", Expr::BVLShr, Width);
-                         },
-                         false);
-
-      MW->writeIntrinsic([&](llvm::raw_ostream &OS) {
-                           OS << MW->IntRep->getCtlz(Width);
-                         },
-                         false);
-
-      OS << "  call v" << id << " := BV" << Width << "_CTLZ(";
-      writeExpr(OS, CE->getVal().get());
-      OS << ", ";
-      writeExpr(OS, CE->getIsZeroUndef().get());
-      OS << ");\n";
+void BPLFunctionWriter::visitEvalStmt(EvalStmt *ES, llvm::raw_ostream &OS) {
+  assert(!ES->getExpr()->preventEvalStmt);
+  assert(SSAVarIds.find(ES->getExpr().get()) == SSAVarIds.end());
+  unsigned id = SSAVarIds.size();
+  if (auto ASE = dyn_cast<ArraySnapshotExpr>(ES->getExpr())) {
+    auto DstArray = ASE->getDst().get();
+    auto SrcArray = ASE->getSrc().get();
+
+    assert(!(isa<NullArrayRefExpr>(DstArray) ||
+             isa<NullArrayRefExpr>(SrcArray) ||
+             MW->M->global_begin() == MW->M->global_end()));
+
+    auto GlobalDst =
+        getArrayCandidates(DstArray, /*MayBeNull=*/false).getSingleArray();
+    auto GlobalSrc =
+        getArrayCandidates(SrcArray, /*MayBeNull=*/false).getSingleArray();
+
+    if (GlobalDst && GlobalSrc) {
+      OS << "  $$" << GlobalDst->getName() << " := "
+         << "$$" << GlobalSrc->getName() << ";\n";
     } else {
-      OS << "  v" << id << " := ";
-      writeExpr(OS, ES->getExpr().get());
-      OS << ";\n";
+      ErrorReporter::reportImplementationLimitation(
+          "Array snapshots on pointers not supported");
     }
-    SSAVarIds[ES->getExpr().get()] = id;
-  } else if (auto CS = dyn_cast<CallStmt>(S)) {
+    return;
+  }
+  if (isa<CallExpr>(ES->getExpr())) {
     OS << "  call ";
-    writeSourceLocs(OS, CS->getSourceLocs());
-    writeCallStmt(OS, CS);
-    OS << ";\n";
-  } else if (auto CMOS = dyn_cast<CallMemberOfStmt>(S)) {
-    auto CSS = CMOS->getCallStmts();
-    auto SL = S->getSourceLocs();
-    auto F = CMOS->getFunc();
+    writeSourceLocs(OS, ES->getSourceLocs());
+  }
+  if (isa<AddNoovflExpr>(ES->getExpr())) {
+    OS << "  call ";
+  }
+  if (isa<HavocExpr>(ES->getExpr())) {
+    OS << "  havoc v" << id << ";\n";
+  } else if (auto CMOE = dyn_cast<CallMemberOfExpr>(ES->getExpr())) {
+    auto CES = CMOE->getCallExprs();
+    auto SL = ES->getSourceLocs();
+    auto F = CMOE->getFunc();
     OS << "  ";
-    for (auto i = CSS.begin(), e = CSS.end(); i != e; ++i) {
-      CS = cast<CallStmt>(*i);
+    for (auto i = CES.begin(), e = CES.end(); i != e; ++i) {
+      auto CE = cast<CallExpr>(i->get());
       OS << "if (";
       writeExpr(OS, F.get());
-      OS << " == $functionId$$" << CS->getCallee()->getName() << ") {\n";
+      OS << " == $functionId$$" << CE->getCallee()->getName() << ") {\n";
       OS << "    call ";
       writeSourceLocs(OS, SL);
-      writeCallStmt(OS, CS);
+      OS << "v" << id << " := ";
+      writeExpr(OS, CE);
       OS << ";\n  } else ";
     }
     OS << "{\n    assert {:bad_pointer_access} ";
     writeSourceLocs(OS, SL);
     OS << "false;\n  }\n";
-  } else if (auto SS = dyn_cast<StoreStmt>(S)) {
-    maybeWriteCaseSplit(OS, SS->getArray().get(), SS->getSourceLocs(),
+  } else if (auto LE = dyn_cast<LoadExpr>(ES->getExpr())) {
+    maybeWriteCaseSplit(OS, LE->getArray().get(), ES->getSourceLocs(),
                         [&](GlobalArray *GA, unsigned int indent) {
-      writeSourceLocsMarker(OS, SS->getSourceLocs(), indent);
-      assert(SS->getValue()->getType() == GA->getRangeType());
+      writeSourceLocsMarker(OS, ES->getSourceLocs(), indent);
+      assert(LE->getType() == GA->getRangeType());
       OS << std::string(indent, ' ');
-      OS << "$$" << GA->getName() << "[";
-      writeExpr(OS, SS->getOffset().get());
-      OS << "] := ";
-      writeExpr(OS, SS->getValue().get());
-      OS << ";";
+      OS << "v" << id << " := $$" << GA->getName() << "[";
+      writeExpr(OS, LE->getOffset().get());
+      OS << "];";
     });
-  } else if (auto VAS = dyn_cast<VarAssignStmt>(S)) {
-    OS << "  ";
-    for (auto b = VAS->getVars().begin(), i = b, e = VAS->getVars().end();
-         i != e; ++i) {
-      if (i != b)
-        OS << ", ";
-      OS << "$" << (*i)->getName();
-    }
-    OS << " := ";
-    for (auto b = VAS->getValues().begin(), i = b, e = VAS->getValues().end();
-         i != e; ++i) {
-      if (i != b)
-        OS << ", ";
-      writeExpr(OS, i->get());
-    }
-    OS << ";\n";
-  } else if (auto GS = dyn_cast<GotoStmt>(S)) {
-    OS << "  goto ";
-    for (auto b = GS->getBlocks().begin(), i = b, e = GS->getBlocks().end();
-         i != e; ++i) {
-      if (i != b)
-        OS << ", ";
-      OS << "$" << (*i)->getName();
-    }
-    OS << ";\n";
-  } else if (auto AS = dyn_cast<AssumeStmt>(S)) {
-    OS << "  assume ";
-    if (AS->isPartition())
-      OS << "{:partition} ";
-    writeExpr(OS, AS->getPredicate().get());
-    OS << ";\n";
-  } else if (auto AtS = dyn_cast<AssertStmt>(S)) {
-    OS << "  assert ";
-    if (AtS->isGlobal())
-      OS << "{:do_not_predicate} ";
-    if (AtS->isCandidate())
-      OS << "{:tag \"user\"} ";
-    if (AtS->isInvariant())
-      OS << "{:originated_from_invariant} ";
-    if (AtS->isBadAccess())
-      OS << "{:bad_pointer_access} ";
-    if (AtS->isBlockSourceLoc())
-      OS << "{:block_sourceloc} ";
-    writeSourceLocs(OS, AtS->getSourceLocs());
-    if (AtS->isCandidate()) {
-      unsigned candidateNumber = MW->nextCandidateNumber();
-      OS << "_c" << candidateNumber << " ==> ";
-      MW->writeIntrinsic([&](llvm::raw_ostream &OS) {
-                           OS << "const {:existential true} _c"
-                              << candidateNumber << " : bool";
-                         },
-                         true);
+  } else if (auto AE = dyn_cast<AtomicExpr>(ES->getExpr())) {
+    maybeWriteCaseSplit(OS, AE->getArray().get(), ES->getSourceLocs(),
+                        [&](GlobalArray *GA, unsigned int indent) {
+      writeSourceLocsMarker(OS, ES->getSourceLocs(), indent);
+      assert(AE->getType() == GA->getRangeType());
+      OS << std::string(indent, ' ');
+      OS << "call {:atomic} ";
+      OS << "{:atomic_function \"" << AE->getFunction() << "\"} ";
+      for (unsigned int i = 0; i < AE->getArgs().size(); i++) {
+        OS << "{:arg" << (i + 1) << " ";
+        writeExpr(OS, AE->getArgs()[i].get());
+        OS << "} ";
+      }
+      OS << "{:parts " << AE->getParts() << "} ";
+      OS << "{:part " << AE->getPart() << "} ";
+      OS << "v" << id << ", $$" << GA->getName();
+      OS << " := _ATOMIC_OP" << GA->getRangeType().width;
+      OS << "($$" << GA->getName() << ", ";
+      writeExpr(OS, AE->getOffset().get());
+      OS << ");";
+    });
+  } else if (auto AWGCE = dyn_cast<AsyncWorkGroupCopyExpr>(ES->getExpr())) {
+    auto DstArray = AWGCE->getDst().get();
+    auto DstOffset = AWGCE->getDstOffset().get();
+    auto SrcArray = AWGCE->getSrc().get();
+    auto SrcOffset = AWGCE->getSrcOffset().get();
+
+    auto dst =
+        getArrayCandidates(DstArray, /*MayBeNull=*/false).getSingleArray();
+    auto src =
+        getArrayCandidates(SrcArray, /*MayBeNull=*/false).getSingleArray();
+
+    if (!dst || !src) {
+      ErrorReporter::reportImplementationLimitation(
+          "Async work group copies on pointers not supported");
     }
-    writeExpr(OS, AtS->getPredicate().get());
-    OS << ";\n";
-  } else if (isa<ReturnStmt>(S)) {
-    OS << "  return;\n";
-  } else if (auto WGES = dyn_cast<WaitGroupEventStmt>(S)) {
+
+    assert(dst->getRangeType() == src->getRangeType());
+
     MW->writeIntrinsic([&](llvm::raw_ostream &OS) {
-      OS << "procedure {:wait_group_events} _WAIT_GROUP_EVENTS(handle : "
-         << MW->IntRep->getType(MW->M->getPointerWidth()) << ")";
+      OS << "procedure {:async_work_group_copy} _ASYNC_WORK_GROUP_COPY_"
+         << dst->getRangeType().width
+         << "(dstOffset : " << MW->IntRep->getType(DstOffset->getType().width)
+         << ", src : [" << MW->IntRep->getType(MW->M->getPointerWidth())
+         << "]" << MW->IntRep->getType(src->getRangeType().width)
+         << ", srcOffset : "
+         << MW->IntRep->getType(SrcOffset->getType().width)
+         << ", size : " << MW->IntRep->getType(MW->M->getPointerWidth())
+         << ", handle : " << MW->IntRep->getType(MW->M->getPointerWidth())
+         << ") returns (handle' : "
+         << MW->IntRep->getType(MW->M->getPointerWidth()) << ", dst : ["
+         << MW->IntRep->getType(MW->M->getPointerWidth()) << "]"
+         << MW->IntRep->getType(dst->getRangeType().width) << ")";
     });
+    writeSourceLocsMarker(OS, ES->getSourceLocs(), 2);
     OS << "  ";
-    OS << "call {:wait_group_events} ";
-    writeSourceLocs(OS, S->getSourceLocs());
-    OS << "_WAIT_GROUP_EVENTS(";
-    writeExpr(OS, WGES->getHandle().get());
+    OS << "call {:async_work_group_copy} v" << id << ", $$" << dst->getName()
+       << " := _ASYNC_WORK_GROUP_COPY_" << dst->getRangeType().width << "(";
+    writeExpr(OS, DstOffset);
+    OS << ", "
+       << "$$" << src->getName() << ", ";
+    writeExpr(OS, SrcOffset);
+    OS << ", ";
+    writeExpr(OS, AWGCE->getSize().get());
+    OS << ", ";
+    writeExpr(OS, AWGCE->getHandle().get());
+    OS << ");\n";
+  } else if (auto CE = dyn_cast<BVCtlzExpr>(ES->getExpr())) {
+    unsigned Width = CE->getVal()->getType().width;
+
+    MW->writeIntrinsic([&](llvm::raw_ostream &OS) {
+                         OS << MW->IntRep->getArithmeticBinary(
+                             "LSHR", Expr::BVLShr, Width);
+                       },
+                       false);
+
+    MW->writeIntrinsic([&](llvm::raw_ostream &OS) {
+                         OS << MW->IntRep->getCtlz(Width);
+                       },
+                       false);
+
+    OS << "  call v" << id << " := BV" << Width << "_CTLZ(";
+    writeExpr(OS, CE->getVal().get());
+    OS << ", ";
+    writeExpr(OS, CE->getIsZeroUndef().get());
     OS << ");\n";
   } else {
-    llvm_unreachable("Unsupported statement");
+    OS << "  v" << id << " := ";
+    writeExpr(OS, ES->getExpr().get());
+    OS << ";\n";
+  }
+  SSAVarIds[ES->getExpr().get()] = id;
+}
+
+void BPLFunctionWriter::visitCallStmt(CallStmt *CS, llvm::raw_ostream &OS) {
+  OS << "  call ";
+  writeSourceLocs(OS, CS->getSourceLocs());
+  writeCallStmt(OS, CS);
+  OS << ";\n";
+}
+
+void BPLFunctionWriter::visitCallMemberOfStmt(CallMemberOfStmt *CMOS,
+                                              llvm::raw_ostream &OS) {
+  auto CSS = CMOS->getCallStmts();
+  auto SL = CMOS->getSourceLocs();
+  auto F = CMOS->getFunc();
+  OS << "  ";
+  for (auto i = CSS.begin(), e = CSS.end(); i != e; ++i) {
+    auto CS = cast<CallStmt>(*i);
+    OS << "if (";
+    writeExpr(OS, F.get());
+    OS << " == $functionId$$" << CS->getCallee()->getName() << ") {\n";
+    OS << "    call ";
+    writeSourceLocs(OS, SL);
+    writeCallStmt(OS, CS);
+    OS << ";\n  } else ";
+  }
+  OS << "{\n    assert {:bad_pointer_access} ";
+  writeSourceLocs(OS, SL);
+  OS << "false;\n  }\n";
+}
+
+void BPLFunctionWriter::visitStoreStmt(StoreStmt *SS, llvm::raw_ostream &OS) {
+  maybeWriteCaseSplit(OS, SS->getArray().get(), SS->getSourceLocs(),
+                      [&](GlobalArray *GA, unsigned int indent) {
+    writeSourceLocsMarker(OS, SS->getSourceLocs(), indent);
+    assert(SS->getValue()->getType() == GA->getRangeType());
+    OS << std::string(indent, ' ');
+    OS << "$$" << GA->getName() << "[";
+    writeExpr(OS, SS->getOffset().get());
+    OS << "] := ";
+    writeExpr(OS, SS->getValue().get());
+    OS << ";";
+  });
+}
+
+void BPLFunctionWriter::visitVarAssignStmt(VarAssignStmt *VAS,
+                                           llvm::raw_ostream &OS) {
+  OS << "  ";
+  for (auto b = VAS->getVars().begin(), i = b, e = VAS->getVars().end();
+       i != e; ++i) {
+    if (i != b)
+      OS << ", ";
+    OS << "$" << (*i)->getName();
+  }
+  OS << " := ";
+  for (auto b = VAS->getValues().begin(), i = b, e = VAS->getValues().end();
+       i != e; ++i) {
+    if (i != b)
+      OS << ", ";
+    writeExpr(OS, i->get());
   }
+  OS << ";\n";
+}
+
+void BPLFunctionWriter::visitGotoStmt(GotoStmt *GS, llvm::raw_ostream &OS) {
+  OS << "  goto ";
+  for (auto b = GS->getBlocks().begin(), i = b, e = GS->getBlocks().end();
+       i != e; ++i) {
+    if (i != b)
+      OS << ", ";
+    OS << "$" << (*i)->getName();
+  }
+  OS << ";\n";
+}
+
+void BPLFunctionWriter::visitAssumeStmt(AssumeStmt *AS, llvm::raw_ostream &OS) {
+  OS << "  assume ";
+  if (AS->isPartition())
+    OS << "{:partition} ";
+  writeExpr(OS, AS->getPredicate().get());
+  OS << ";\n";
+}
+
+void BPLFunctionWriter::visitAssertStmt(AssertStmt *AtS,
+                                        llvm::raw_ostream &OS) {
+  OS << "  assert ";
+  if (AtS->isGlobal())
+    OS << "{:do_not_predicate} ";
+  if (AtS->isCandidate())
+    OS << "{:tag \"user\"} ";
+  if (AtS->isInvariant())
+    OS << "{:originated_from_invariant} ";
+  if (AtS->isBadAccess())
+    OS << "{:bad_pointer_access} ";
+  if (AtS->isBlockSourceLoc())
+    OS << "{:block_sourceloc} ";
+  writeSourceLocs(OS, AtS->getSourceLocs());
+  if (AtS->isCandidate()) {
+    unsigned candidateNumber = MW->nextCandidateNumber();
+    OS << "_c" << candidateNumber << " ==> ";
+    MW->writeIntrinsic([&](llvm::raw_ostream &OS) {
+                         OS << "const {:existential true} _c"
+                            << candidateNumber << " : bool";
+                       },
+                       true);
+  }
+  writeExpr(OS, AtS->getPredicate().get());
+  OS << ";\n";
+}
+
+void BPLFunctionWriter::visitReturnStmt(ReturnStmt *, llvm::raw_ostream &OS) {
+  OS << "  return;\n";
+}
+
+void BPLFunctionWriter::visitWaitGroupEventStmt(WaitGroupEventStmt *WGES,
+                                                llvm::raw_ostream &OS) {
+  MW->writeIntrinsic([&](llvm::raw_ostream &OS) {
+    OS << "procedure {:wait_group_events} _WAIT_GROUP_EVENTS(handle : "
+       << MW->IntRep->getType(MW->M->getPointerWidth()) << ")";
+  });
+  OS << "  ";
+  OS << "call {:wait_group_events} ";
+  writeSourceLocs(OS, WGES->getSourceLocs());
+  OS << "_WAIT_GROUP_EVENTS(";
+  writeExpr(OS, WGES->getHandle().get());
+  OS << ");\n";
+}
+
+void BPLFunctionWriter::visitStmt(Stmt *, llvm::raw_ostream &) {
+  llvm_unreachable("Unsupported statement");
 }
 
 void BPLFunctionWriter::writeBasicBlock(llvm::raw_ostream &OS, BasicBlock *BB) {
@@ -386,6 +403,8 @@ void BPLFunctionWriter::writeVar(llvm::raw_ostream &OS, Var *V) {
 }
 
 void BPLFunctionWriter::write() {
+  TimeTraceScope Scope("Write function", F->getName());
+
   OS << "procedure ";
   OS << "{:source_name \"" << F->getSourceName() << "\"} ";
   for (auto i = F->attrib_begin(), e = F->attrib_end(); i != e; ++i) {
@@ -4,6 +4,7 @@
 #include "bugle/Module.h"
 #include "bugle/RaceInstrumenter.h"
 #include "bugle/Type.h"
+#include "bugle/util/Statistics.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cmath>
@@ -69,9 +70,16 @@ void BPLModuleWriter::write() {
   std::string S;
   llvm::raw_string_ostream SS(S);
 
+  AllArrays.insert(M->global_begin(), M->global_end());
+  AllArraysOrNull = AllArrays;
+  AllArraysOrNull.insert(nullptr);
+
   for (auto i = M->function_begin(), e = M->function_end(); i != e; ++i) {
+    uint64_t Start = SS.tell();
     BPLFunctionWriter FW(this, SS, *i);
     FW.write();
+    if (Statistics::isEnabled())
+      Statistics::add("procedure-bytes", (*i)->getName(), SS.tell() - Start);
   }
 
   for (auto i = M->axiom_begin(), e = M->axiom_end(); i != e; ++i) {
@@ -257,6 +265,9 @@ void BPLModuleWriter::write() {
   }
 
   OS << SS.str();
+
+  if (Statistics::isEnabled())
+    Statistics::add("intrinsics", IntrinsicSet.size());
 }
 
 unsigned BPLModuleWriter::nextCandidateNumber() {
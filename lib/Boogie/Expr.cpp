@@ -1,36 +1,307 @@
 #include "bugle/Expr.h"
 #include "bugle/BPLExprWriter.h"
+#include "bugle/ExprRewriter.h"
+#include "bugle/ExprVisitor.h"
 #include "bugle/Function.h"
 #include "bugle/GlobalArray.h"
 #include "bugle/util/Functional.h"
+#include "bugle/util/Statistics.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <map>
 
 using namespace bugle;
 
-bool Expr::computeArrayCandidates(std::set<GlobalArray *> &GlobalSet) const {
-  if (auto GARE = dyn_cast<GlobalArrayRefExpr>(this)) {
-    GlobalSet.insert(GARE->getArray());
-    return true;
-  } else if (auto MOE = dyn_cast<ArrayMemberOfExpr>(this)) {
-    GlobalSet.insert(MOE->getElems().begin(), MOE->getElems().end());
-    return true;
-  } else if (isa<NullArrayRefExpr>(this)) {
-    GlobalSet.insert(nullptr);
-    return true;
-  } else if (auto ITE = dyn_cast<IfThenElseExpr>(this)) {
-    return ITE->getTrueExpr()->computeArrayCandidates(GlobalSet) &&
-           ITE->getFalseExpr()->computeArrayCandidates(GlobalSet);
-  } else if (auto AIE = dyn_cast<ArrayIdExpr>(this)) {
-    return AIE->getSubExpr()->computeArrayCandidates(GlobalSet);
-  } else if (auto PE = dyn_cast<PointerExpr>(this)) {
-    return PE->getArray()->computeArrayCandidates(GlobalSet);
-  } else {
+bool RefCount::Threaded = false;
+
+static llvm::cl::opt<bool> HashConsExprs(
+    "hash-cons-exprs",
+    llvm::cl::desc("Share the nodes of structurally equal expressions within "
+                   "the translation of a basic block"),
+    llvm::cl::init(false));
+
+namespace {
+
+typedef llvm::SmallVector<uint64_t, 8> StructureKey;
+
+// The nodes of a hash-consing scope by structure, and the entry of each node
+// such that it can be removed when the node is deleted or evaluated. Users
+// maps each operand to the nodes in the table that have it as an operand.
+struct UniqueTable {
+  typedef std::map<StructureKey, Expr *> NodeMap;
+  struct Entry {
+    NodeMap::iterator Node;
+    llvm::SmallVector<const Expr *, 3> Ops;
+  };
+  NodeMap Nodes;
+  llvm::DenseMap<const Expr *, Entry> Entries;
+  llvm::DenseMap<const Expr *, llvm::SmallVector<const Expr *, 2>> Users;
+
+  void insert(NodeMap::iterator Node, llvm::ArrayRef<const Expr *> Ops) {
+    Entry &E = Entries[Node->second];
+    E.Node = Node;
+    E.Ops.assign(Ops.begin(), Ops.end());
+    for (auto Op : Ops)
+      Users[Op].push_back(Node->second);
+  }
+
+  void remove(const Expr *E) {
+    auto EI = Entries.find(E);
+    if (EI == Entries.end())
+      return;
+    Nodes.erase(EI->second.Node);
+    for (auto Op : EI->second.Ops) {
+      auto UI = Users.find(Op);
+      if (UI == Users.end())
+        continue;
+      auto &OpUsers = UI->second;
+      OpUsers.erase(std::find(OpUsers.begin(), OpUsers.end(), E));
+      if (OpUsers.empty())
+        Users.erase(UI);
+    }
+    Entries.erase(EI);
+  }
+
+  // Removes E and the nodes that have it as an operand, directly or through
+  // other nodes.
+  void removeWithUsers(const Expr *E) {
+    llvm::SmallVector<const Expr *, 8> Worklist;
+    Worklist.push_back(E);
+    while (!Worklist.empty()) {
+      const Expr *Next = Worklist.pop_back_val();
+      remove(Next);
+      auto UI = Users.find(Next);
+      if (UI != Users.end()) {
+        Worklist.append(UI->second.begin(), UI->second.end());
+        Users.erase(UI);
+      }
+    }
+  }
+};
+}
+
+// Each thread has its own table, such that the nodes shared by a function do
+// not depend on which functions are translated concurrently.
+static thread_local UniqueTable *CurrentTable = nullptr;
+static thread_local bool SharingSuspended = false;
+
+void *Expr::allocate(size_t size, const char *kindName) {
+  if (Statistics::isEnabled()) {
+    Statistics::add("expr-allocations", kindName);
+    Statistics::adjust("expr-live", 1);
+  }
+  return ::operator new(size);
+}
+
+void Expr::operator delete(void *p) {
+  if (Statistics::isEnabled())
+    Statistics::adjust("expr-live", -1);
+  ::operator delete(p);
+}
+
+// Compute the key that identifies E by its kind, type, operands and payload,
+// and collect its operands. Returns false if E must stay distinct from
+// structurally equal expressions, as it has side effects or its value depends
+// on where it is evaluated.
+static bool getStructure(const Expr *E, StructureKey &Key,
+                         llvm::SmallVectorImpl<const Expr *> &Ops) {
+  const Type &T = E->getType();
+  Key.push_back(E->getKind());
+  Key.push_back((uint64_t)T.array << 32 | (uint64_t)T.kind);
+  Key.push_back(T.width);
+
+  auto AddExpr = [&](const ref<Expr> &Op) {
+    Key.push_back((uintptr_t)Op.get());
+    Ops.push_back(Op.get());
+  };
+  auto AddString = [&](const std::string &S) {
+    Key.push_back(S.size());
+    Key.append(S.begin(), S.end());
+  };
+
+  if (auto UE = dyn_cast<UnaryExpr>(E)) {
+    AddExpr(UE->getSubExpr());
+  } else if (auto BE = dyn_cast<BinaryExpr>(E)) {
+    AddExpr(BE->getLHS());
+    AddExpr(BE->getRHS());
+  } else if (auto CE = dyn_cast<BVConstExpr>(E)) {
+    const llvm::APInt &Val = CE->getValue();
+    Key.append(Val.getRawData(), Val.getRawData() + Val.getNumWords());
+  } else if (auto BCE = dyn_cast<BoolConstExpr>(E)) {
+    Key.push_back(BCE->getValue());
+  } else if (auto GARE = dyn_cast<GlobalArrayRefExpr>(E)) {
+    Key.push_back((uintptr_t)GARE->getArray());
+  } else if (auto PE = dyn_cast<PointerExpr>(E)) {
+    AddExpr(PE->getArray());
+    AddExpr(PE->getOffset());
+  } else if (auto FPE = dyn_cast<FunctionPointerExpr>(E)) {
+    AddString(FPE->getFuncName());
+  } else if (auto VRE = dyn_cast<VarRefExpr>(E)) {
+    Key.push_back((uintptr_t)VRE->getVar());
+  } else if (auto SVRE = dyn_cast<SpecialVarRefExpr>(E)) {
+    AddString(SVRE->getAttr());
+  } else if (auto BVEE = dyn_cast<BVExtractExpr>(E)) {
+    AddExpr(BVEE->getSubExpr());
+    Key.push_back(BVEE->getOffset());
+  } else if (auto ITE = dyn_cast<IfThenElseExpr>(E)) {
+    AddExpr(ITE->getCond());
+    AddExpr(ITE->getTrueExpr());
+    AddExpr(ITE->getFalseExpr());
+  } else if (auto LE = dyn_cast<LoadExpr>(E)) {
+    if (LE->getIsTemporal())
+      return false;
+    AddExpr(LE->getArray());
+    AddExpr(LE->getOffset());
+  } else if (!isa<NullArrayRefExpr>(E) && !isa<NullFunctionPointerExpr>(E)) {
     return false;
   }
+  return true;
+}
+
+ref<Expr> Expr::intern(Expr *E) {
+  if (auto Rewriter = ExprRewriter::getCurrent()) {
+    ref<Expr> Rewritten = Rewriter->rewrite(E);
+    if (!Rewritten.isNull()) {
+      delete E;
+      return Rewritten;
+    }
+  }
+
+  UniqueTable *Table = CurrentTable;
+  StructureKey Key;
+  llvm::SmallVector<const Expr *, 3> Ops;
+  if (!Table || SharingSuspended || !getStructure(E, Key, Ops))
+    return E;
+
+  auto Inserted = Table->Nodes.insert(std::make_pair(Key, E));
+  if (Inserted.second) {
+    Table->insert(Inserted.first, Ops);
+    return E;
+  }
+
+  ref<Expr> Existing = Inserted.first->second;
+  delete E;
+  if (Statistics::isEnabled())
+    Statistics::add("exprs-shared");
+  return Existing;
+}
+
+void Expr::removeFromUniqueTable() {
+  // The nodes using this one as an operand would carry its evaluation to
+  // where they are shared.
+  if (UniqueTable *Table = CurrentTable)
+    Table->removeWithUsers(this);
+}
+
+Expr::HashConsScope::HashConsScope(bool Enable)
+    : OwnsTable(false), WasSuspended(SharingSuspended) {
+  if (!Enable) {
+    SharingSuspended = true;
+  } else if (HashConsExprs && !CurrentTable) {
+    CurrentTable = new UniqueTable;
+    OwnsTable = true;
+  }
+}
+
+Expr::HashConsScope::~HashConsScope() {
+  SharingSuspended = WasSuspended;
+  if (OwnsTable) {
+    delete CurrentTable;
+    CurrentTable = nullptr;
+  }
+}
+
+Expr::~Expr() {
+  // The nodes using this one as an operand are gone already, as they hold
+  // references to it.
+  if (UniqueTable *Table = CurrentTable)
+    Table->remove(this);
+}
+
+const ArrayCandidates *Expr::getArrayCandidates() const {
+  // Member-of expressions carry their candidates, and array identifiers and
+  // pointers share those of their arrays.
+  if (auto MOE = dyn_cast<ArrayMemberOfExpr>(this))
+    return &MOE->getElems();
+  else if (auto AIE = dyn_cast<ArrayIdExpr>(this))
+    return AIE->getSubExpr()->getArrayCandidates();
+  else if (auto PE = dyn_cast<PointerExpr>(this))
+    return PE->getArray()->getArrayCandidates();
+  else if (auto GARE = dyn_cast<GlobalArrayRefExpr>(this))
+    return GARE->candidates.get(this);
+  else if (auto NARE = dyn_cast<NullArrayRefExpr>(this))
+    return NARE->candidates.get(this);
+  else if (auto ITE = dyn_cast<IfThenElseExpr>(this))
+    return ITE->candidates.get(this);
+  else
+    return nullptr;
+}
+
+// Marks the expressions whose array candidates are not known.
+static const ArrayCandidates UnknownCandidates;
+
+namespace {
+
+// Computes the candidates of the array references from which the candidates
+// of other expressions derive; the result is owned by the caller unless it is
+// UnknownCandidates.
+class ArrayCandidatesVisitor
+    : public ExprVisitor<ArrayCandidatesVisitor, const ArrayCandidates *> {
+public:
+  const ArrayCandidates *visitGlobalArrayRefExpr(GlobalArrayRefExpr *GARE) {
+    auto AC = new ArrayCandidates;
+    AC->insert(GARE->getArray());
+    return AC;
+  }
+
+  const ArrayCandidates *visitNullArrayRefExpr(NullArrayRefExpr *) {
+    auto AC = new ArrayCandidates;
+    AC->insert(nullptr);
+    return AC;
+  }
+
+  const ArrayCandidates *visitIfThenElseExpr(IfThenElseExpr *ITE) {
+    auto TrueAC = ITE->getTrueExpr()->getArrayCandidates();
+    auto FalseAC = ITE->getFalseExpr()->getArrayCandidates();
+    if (!TrueAC || !FalseAC)
+      return &UnknownCandidates;
+    auto AC = new ArrayCandidates;
+    AC->insert(*TrueAC);
+    AC->insert(*FalseAC);
+    return AC;
+  }
+
+  const ArrayCandidates *visitExpr(Expr *) {
+    llvm_unreachable("Expression has no array candidates of its own");
+  }
+};
+}
+
+ArrayCandidatesCache::~ArrayCandidatesCache() {
+  auto AC = candidates.load(std::memory_order_relaxed);
+  if (AC != &UnknownCandidates)
+    delete AC;
+}
+
+const ArrayCandidates *ArrayCandidatesCache::get(const Expr *E) const {
+  // The expression may be shared by functions translated on different
+  // threads; the first candidates to be published are kept.
+  auto AC = candidates.load(std::memory_order_acquire);
+  if (!AC) {
+    auto New = ArrayCandidatesVisitor().visit(const_cast<Expr *>(E));
+    if (candidates.compare_exchange_strong(AC, New, std::memory_order_acq_rel))
+      AC = New;
+    else if (New != &UnknownCandidates)
+      delete New;
+  }
+  return AC != &UnknownCandidates ? AC : nullptr;
 }
 
 ref<Expr> BVConstExpr::create(const llvm::APInt &bv) {
-  return new BVConstExpr(bv);
+  return intern(new BVConstExpr(bv));
 }
 
 ref<Expr> BVConstExpr::createZero(unsigned width) {
@@ -41,14 +312,16 @@ ref<Expr> BVConstExpr::create(unsigned width, uint64_t val, bool isSigned) {
   return create(llvm::APInt(width, val, isSigned));
 }
 
-ref<Expr> BoolConstExpr::create(bool val) { return new BoolConstExpr(val); }
+ref<Expr> BoolConstExpr::create(bool val) {
+  return intern(new BoolConstExpr(val));
+}
 
 ref<Expr> GlobalArrayRefExpr::create(GlobalArray *global) {
-  return new GlobalArrayRefExpr(Type(Type::ArrayOf, global->getRangeType()),
-                                global);
+  return intern(new GlobalArrayRefExpr(
+      Type(Type::ArrayOf, global->getRangeType()), global));
 }
 
-ref<Expr> NullArrayRefExpr::create() { return new NullArrayRefExpr(); }
+ref<Expr> NullArrayRefExpr::create() { return intern(new NullArrayRefExpr()); }
 
 ref<Expr> ConstantArrayRefExpr::create(llvm::ArrayRef<ref<Expr>> array) {
 #ifndef NDEBUG
@@ -69,15 +342,15 @@ ref<Expr> PointerExpr::create(ref<Expr> array, ref<Expr> offset) {
   assert(array->getType().array);
   assert(offset->getType().isKind(Type::BV));
 
-  return new PointerExpr(array, offset);
+  return intern(new PointerExpr(std::move(array), std::move(offset)));
 }
 
 ref<Expr> NullFunctionPointerExpr::create(unsigned ptrWidth) {
-  return new NullFunctionPointerExpr(ptrWidth);
+  return intern(new NullFunctionPointerExpr(ptrWidth));
 }
 
 ref<Expr> FunctionPointerExpr::create(std::string funcName, unsigned ptrWidth) {
-  return new FunctionPointerExpr(funcName, ptrWidth);
+  return intern(new FunctionPointerExpr(std::move(funcName), ptrWidth));
 }
 
 ref<Expr> LoadExpr::create(ref<Expr> array, ref<Expr> offset, Type type,
@@ -93,7 +366,8 @@ ref<Expr> LoadExpr::create(ref<Expr> array, ref<Expr> offset, Type type,
     return CA->getArray()[Ofs];
   }
 
-  return new LoadExpr(type, array, offset, isTemporal);
+  return intern(new LoadExpr(type, std::move(array), std::move(offset),
+                             isTemporal));
 }
 
 ref<Expr> AtomicExpr::create(ref<Expr> array, ref<Expr> offset,
@@ -104,13 +378,14 @@ ref<Expr> AtomicExpr::create(ref<Expr> array, ref<Expr> offset,
   assert(offset->getType().isKind(Type::BV));
   assert(at.range().isKind(Type::BV));
 
-  return new AtomicExpr(at.range(), array, offset, args, function, parts, part);
+  return new AtomicExpr(at.range(), std::move(array), std::move(offset),
+                        std::move(args), std::move(function), parts, part);
 }
 
-ref<Expr> VarRefExpr::create(Var *var) { return new VarRefExpr(var); }
+ref<Expr> VarRefExpr::create(Var *var) { return intern(new VarRefExpr(var)); }
 
 ref<Expr> SpecialVarRefExpr::create(Type t, const std::string &attr) {
-  return new SpecialVarRefExpr(t, attr);
+  return intern(new SpecialVarRefExpr(t, attr));
 }
 
 ref<Expr> BVExtractExpr::create(ref<Expr> expr, unsigned offset,
@@ -145,7 +420,7 @@ ref<Expr> BVExtractExpr::create(ref<Expr> expr, unsigned offset,
       return BVExtractExpr::create(UE->getSubExpr(), offset, width);
   }
 
-  return new BVExtractExpr(expr, offset, width);
+  return intern(new BVExtractExpr(std::move(expr), offset, width));
 }
 
 ref<Expr> BVCtlzExpr::create(ref<Expr> val, ref<Expr> isZeroUndef) {
@@ -160,18 +435,16 @@ ref<Expr> NotExpr::create(ref<Expr> op) {
   if (auto e = dyn_cast<BoolConstExpr>(op))
     return BoolConstExpr::create(!e->getValue());
 
-  return new NotExpr(Type(Type::Bool), op);
+  return intern(new NotExpr(Type(Type::Bool), std::move(op)));
 }
 
-Type Expr::getArrayCandidateType(const std::set<GlobalArray *> &Globals) {
+Type Expr::getArrayCandidateType(const ArrayCandidates &Globals) {
   Type t(Type::Any);
   for (auto gi = Globals.begin(), ge = Globals.end(); gi != ge; ++gi) {
-    if (*gi) {
-      if (t.kind == Type::Any)
-        t = (*gi)->getRangeType();
-      else if (t != (*gi)->getRangeType())
-        return Type(Type::Unknown);
-    }
+    if (t.kind == Type::Any)
+      t = (*gi)->getRangeType();
+    else if (t != (*gi)->getRangeType())
+      return Type(Type::Unknown);
   }
   return t;
 }
@@ -179,9 +452,8 @@ Type Expr::getArrayCandidateType(const std::set<GlobalArray *> &Globals) {
 Type Expr::getPointerRange(ref<Expr> pointer, Type defaultRange) {
   assert(pointer->getType().isKind(Type::Pointer));
   Type range = defaultRange;
-  std::set<GlobalArray *> Globals;
-  if (pointer->computeArrayCandidates(Globals))
-    range = getArrayCandidateType(Globals);
+  if (auto Globals = pointer->getArrayCandidates())
+    range = getArrayCandidateType(*Globals);
   return range;
 }
 
@@ -193,7 +465,8 @@ ref<Expr> ArrayIdExpr::create(ref<Expr> pointer, Type defaultRange) {
 
   Type range = getPointerRange(pointer, defaultRange);
 
-  return new ArrayIdExpr(Type(Type::ArrayOf, range), pointer);
+  return intern(new ArrayIdExpr(Type(Type::ArrayOf, range),
+                                std::move(pointer)));
 }
 
 ref<Expr> ArrayOffsetExpr::create(ref<Expr> pointer) {
@@ -202,7 +475,8 @@ ref<Expr> ArrayOffsetExpr::create(ref<Expr> pointer) {
   if (auto e = dyn_cast<PointerExpr>(pointer))
     return e->getOffset();
 
-  return new ArrayOffsetExpr(Type(Type::BV, pointer->getType().width), pointer);
+  return intern(new ArrayOffsetExpr(
+      Type(Type::BV, pointer->getType().width), pointer));
 }
 
 ref<Expr> BVZExtExpr::create(unsigned width, ref<Expr> bv) {
@@ -217,7 +491,7 @@ ref<Expr> BVZExtExpr::create(unsigned width, ref<Expr> bv) {
   if (auto e = dyn_cast<BVConstExpr>(bv))
     return BVConstExpr::create(e->getValue().zext(width));
 
-  return new BVZExtExpr(Type(Type::BV, width), bv);
+  return intern(new BVZExtExpr(Type(Type::BV, width), std::move(bv)));
 }
 
 ref<Expr> BVSExtExpr::create(unsigned width, ref<Expr> bv) {
@@ -232,7 +506,7 @@ ref<Expr> BVSExtExpr::create(unsigned width, ref<Expr> bv) {
   if (auto e = dyn_cast<BVConstExpr>(bv))
     return BVConstExpr::create(e->getValue().sext(width));
 
-  return new BVSExtExpr(Type(Type::BV, width), bv);
+  return intern(new BVSExtExpr(Type(Type::BV, width), std::move(bv)));
 }
 
 ref<Expr> FPConvExpr::create(unsigned width, ref<Expr> expr) {
@@ -242,112 +516,112 @@ ref<Expr> FPConvExpr::create(unsigned width, ref<Expr> expr) {
   if (width == ty.width)
     return expr;
 
-  return new FPConvExpr(Type(Type::BV, width), expr);
+  return intern(new FPConvExpr(Type(Type::BV, width), std::move(expr)));
 }
 
 ref<Expr> FPToSIExpr::create(unsigned width, ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FPToSIExpr(Type(Type::BV, width), expr);
+  return intern(new FPToSIExpr(Type(Type::BV, width), std::move(expr)));
 }
 
 ref<Expr> FPToUIExpr::create(unsigned width, ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FPToUIExpr(Type(Type::BV, width), expr);
+  return intern(new FPToUIExpr(Type(Type::BV, width), std::move(expr)));
 }
 
 ref<Expr> SIToFPExpr::create(unsigned width, ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new SIToFPExpr(Type(Type::BV, width), expr);
+  return intern(new SIToFPExpr(Type(Type::BV, width), std::move(expr)));
 }
 
 ref<Expr> UIToFPExpr::create(unsigned width, ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new UIToFPExpr(Type(Type::BV, width), expr);
+  return intern(new UIToFPExpr(Type(Type::BV, width), std::move(expr)));
 }
 
 ref<Expr> BVCtpopExpr::create(ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new BVCtpopExpr(expr->getType(), expr);
+  return intern(new BVCtpopExpr(expr->getType(), expr));
 }
 
 ref<Expr> FAbsExpr::create(ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FAbsExpr(expr->getType(), expr);
+  return intern(new FAbsExpr(expr->getType(), expr));
 }
 
 ref<Expr> FCeilExpr::create(ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FCeilExpr(expr->getType(), expr);
+  return intern(new FCeilExpr(expr->getType(), expr));
 }
 
 ref<Expr> FCosExpr::create(ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FCosExpr(expr->getType(), expr);
+  return intern(new FCosExpr(expr->getType(), expr));
 }
 
 ref<Expr> FExpExpr::create(ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FExpExpr(expr->getType(), expr);
+  return intern(new FExpExpr(expr->getType(), expr));
 }
 
 ref<Expr> FExp2Expr::create(ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FExp2Expr(expr->getType(), expr);
+  return intern(new FExp2Expr(expr->getType(), expr));
 }
 
 ref<Expr> FLogExpr::create(ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FLogExpr(expr->getType(), expr);
+  return intern(new FLogExpr(expr->getType(), expr));
 }
 
 ref<Expr> FLog10Expr::create(ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FLog10Expr(expr->getType(), expr);
+  return intern(new FLog10Expr(expr->getType(), expr));
 }
 
 ref<Expr> FLog2Expr::create(ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FLog2Expr(expr->getType(), expr);
+  return intern(new FLog2Expr(expr->getType(), expr));
 }
 
 ref<Expr> FrexpExpExpr::create(unsigned width, ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FrexpExpExpr(Type(Type::BV, width), expr);
+  return intern(new FrexpExpExpr(Type(Type::BV, width), std::move(expr)));
 }
 
 ref<Expr> FrexpFracExpr::create(ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FrexpFracExpr(expr->getType(), expr);
+  return intern(new FrexpFracExpr(expr->getType(), expr));
 }
 
 ref<Expr> FFloorExpr::create(ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FFloorExpr(expr->getType(), expr);
+  return intern(new FFloorExpr(expr->getType(), expr));
 }
 
 ref<Expr> FRintExpr::create(ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FRintExpr(expr->getType(), expr);
+  return intern(new FRintExpr(expr->getType(), expr));
 }
 
 ref<Expr> FSinExpr::create(ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FSinExpr(expr->getType(), expr);
+  return intern(new FSinExpr(expr->getType(), expr));
 }
 
 ref<Expr> FRsqrtExpr::create(ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FRsqrtExpr(expr->getType(), expr);
+  return intern(new FRsqrtExpr(expr->getType(), expr));
 }
 
 ref<Expr> FSqrtExpr::create(ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FSqrtExpr(expr->getType(), expr);
+  return intern(new FSqrtExpr(expr->getType(), expr));
 }
 
 ref<Expr> FTruncExpr::create(ref<Expr> expr) {
   assert(expr->getType().isKind(Type::BV));
-  return new FTruncExpr(expr->getType(), expr);
+  return intern(new FTruncExpr(expr->getType(), expr));
 }
 
 ref<Expr> IfThenElseExpr::create(ref<Expr> cond, ref<Expr> trueExpr,
@@ -358,24 +632,25 @@ ref<Expr> IfThenElseExpr::create(ref<Expr> cond, ref<Expr> trueExpr,
   if (auto e = dyn_cast<BoolConstExpr>(cond))
     return e->getValue() ? trueExpr : falseExpr;
 
-  return new IfThenElseExpr(cond, trueExpr, falseExpr);
+  return intern(new IfThenElseExpr(std::move(cond), std::move(trueExpr),
+                                   std::move(falseExpr)));
 }
 
 ref<Expr> HavocExpr::create(Type type) { return new HavocExpr(type); }
 
 ref<Expr> ArrayMemberOfExpr::create(ref<Expr> expr,
-                                    const std::set<GlobalArray *> &elems) {
+                                    const ArrayCandidates &elems) {
   assert(expr->getType().array);
   assert(!elems.empty());
 
   Type t = Expr::getArrayCandidateType(elems);
 #ifndef NDEBUG
   for (auto i = elems.begin(), e = elems.end(); i != e; ++i) {
-    assert(*i == nullptr || (*i)->getRangeType() == t);
+    assert((*i)->getRangeType() == t);
   }
 #endif
 
-  return new ArrayMemberOfExpr(Type(Type::ArrayOf, t), expr, elems);
+  return new ArrayMemberOfExpr(Type(Type::ArrayOf, t), std::move(expr), elems);
 }
 
 ref<Expr> BVToPtrExpr::create(unsigned ptrWidth, ref<Expr> bv) {
@@ -389,7 +664,7 @@ ref<Expr> BVToPtrExpr::create(unsigned ptrWidth, ref<Expr> bv) {
       return PointerExpr::create(NullArrayRefExpr::create(),
                                  BVConstExpr::createZero(ptrWidth));
 
-  return new BVToPtrExpr(Type(Type::Pointer, ptrWidth), bv);
+  return intern(new BVToPtrExpr(Type(Type::Pointer, ptrWidth), std::move(bv)));
 }
 
 ref<Expr> PtrToBVExpr::create(unsigned bvWidth, ref<Expr> ptr) {
@@ -402,7 +677,7 @@ ref<Expr> PtrToBVExpr::create(unsigned bvWidth, ref<Expr> ptr) {
     if (dyn_cast<NullArrayRefExpr>(e->getArray()))
       return BVZExtExpr::create(bvWidth, e->getOffset());
 
-  return new PtrToBVExpr(Type(Type::BV, bvWidth), ptr);
+  return intern(new PtrToBVExpr(Type(Type::BV, bvWidth), std::move(ptr)));
 }
 
 ref<Expr> SafeBVToPtrExpr::create(unsigned ptrWidth, ref<Expr> bv) {
@@ -416,8 +691,8 @@ ref<Expr> SafeBVToPtrExpr::create(unsigned ptrWidth, ref<Expr> bv) {
       return PointerExpr::create(NullArrayRefExpr::create(),
                                  BVConstExpr::createZero(ptrWidth));
 
-  return new SafeBVToPtrExpr(Type(Type::Pointer, ptrWidth),
-                             BVZExtExpr::create(ptrWidth, bv));
+  return intern(new SafeBVToPtrExpr(Type(Type::Pointer, ptrWidth),
+                                    BVZExtExpr::create(ptrWidth, bv)));
 }
 
 ref<Expr> SafePtrToBVExpr::create(unsigned bvWidth, ref<Expr> ptr) {
@@ -431,8 +706,8 @@ ref<Expr> SafePtrToBVExpr::create(unsigned bvWidth, ref<Expr> ptr) {
     if (dyn_cast<NullArrayRefExpr>(e->getArray()))
       return BVZExtExpr::create(bvWidth, e->getOffset());
 
-  return BVZExtExpr::create(bvWidth,
-                            new SafePtrToBVExpr(Type(Type::BV, ty.width), ptr));
+  return BVZExtExpr::create(
+      bvWidth, intern(new SafePtrToBVExpr(Type(Type::BV, ty.width), ptr)));
 }
 
 ref<Expr> BVToFuncPtrExpr::create(unsigned ptrWidth, ref<Expr> bv) {
@@ -441,7 +716,8 @@ ref<Expr> BVToFuncPtrExpr::create(unsigned ptrWidth, ref<Expr> bv) {
   if (auto e = dyn_cast<FuncPtrToBVExpr>(bv))
     return e->getSubExpr();
 
-  return new BVToFuncPtrExpr(Type(Type::FunctionPointer, ptrWidth), bv);
+  return intern(
+      new BVToFuncPtrExpr(Type(Type::FunctionPointer, ptrWidth), bv));
 }
 
 ref<Expr> FuncPtrToBVExpr::create(unsigned bvWidth, ref<Expr> ptr) {
@@ -450,7 +726,7 @@ ref<Expr> FuncPtrToBVExpr::create(unsigned bvWidth, ref<Expr> ptr) {
   if (auto e = dyn_cast<BVToFuncPtrExpr>(ptr))
     return BVZExtExpr::create(bvWidth, e->getSubExpr());
 
-  return new FuncPtrToBVExpr(Type(Type::BV, bvWidth), ptr);
+  return intern(new FuncPtrToBVExpr(Type(Type::BV, bvWidth), std::move(ptr)));
 }
 
 ref<Expr> PtrToFuncPtrExpr::create(ref<Expr> ptr) {
@@ -463,7 +739,8 @@ ref<Expr> PtrToFuncPtrExpr::create(ref<Expr> ptr) {
   if (auto e = dyn_cast<FuncPtrToPtrExpr>(ptr))
     return e->getSubExpr();
 
-  return new PtrToFuncPtrExpr(Type(Type::FunctionPointer, ty.width), ptr);
+  return intern(
+      new PtrToFuncPtrExpr(Type(Type::FunctionPointer, ty.width), ptr));
 }
 
 ref<Expr> FuncPtrToPtrExpr::create(ref<Expr> ptr) {
@@ -476,7 +753,8 @@ ref<Expr> FuncPtrToPtrExpr::create(ref<Expr> ptr) {
   if (auto e = dyn_cast<PtrToFuncPtrExpr>(ptr))
     return e->getSubExpr();
 
-  return new FuncPtrToPtrExpr(Type(Type::Pointer, ty.width), ptr);
+  return intern(new FuncPtrToPtrExpr(Type(Type::Pointer, ty.width),
+                                     std::move(ptr)));
 }
 
 ref<Expr> BVToBoolExpr::create(ref<Expr> bv) {
@@ -486,7 +764,7 @@ ref<Expr> BVToBoolExpr::create(ref<Expr> bv) {
   if (auto e = dyn_cast<BoolToBVExpr>(bv))
     return e->getSubExpr();
 
-  return new BVToBoolExpr(Type(Type::Bool), bv);
+  return intern(new BVToBoolExpr(Type(Type::Bool), std::move(bv)));
 }
 
 ref<Expr> BoolToBVExpr::create(ref<Expr> bv) {
@@ -495,7 +773,7 @@ ref<Expr> BoolToBVExpr::create(ref<Expr> bv) {
   if (auto e = dyn_cast<BVToBoolExpr>(bv))
     return e->getSubExpr();
 
-  return new BoolToBVExpr(Type(Type::BV, 1), bv);
+  return intern(new BoolToBVExpr(Type(Type::BV, 1), std::move(bv)));
 }
 
 ref<Expr> EqExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
@@ -517,7 +795,7 @@ ref<Expr> EqExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
     if (auto e2 = dyn_cast<GlobalArrayRefExpr>(rhs))
       return BoolConstExpr::create(e1->getArray() == e2->getArray());
 
-  return new EqExpr(Type(Type::Bool), lhs, rhs);
+  return intern(new EqExpr(Type(Type::Bool), std::move(lhs), std::move(rhs)));
 }
 
 ref<Expr> NeExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
@@ -535,7 +813,7 @@ ref<Expr> NeExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
     if (auto e2 = dyn_cast<GlobalArrayRefExpr>(rhs))
       return BoolConstExpr::create(e1->getArray() != e2->getArray());
 
-  return new NeExpr(Type(Type::Bool), lhs, rhs);
+  return intern(new NeExpr(Type(Type::Bool), std::move(lhs), std::move(rhs)));
 }
 
 ref<Expr> Expr::createNeZero(ref<Expr> bv) {
@@ -552,7 +830,7 @@ ref<Expr> AndExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
   if (auto e2 = dyn_cast<BoolConstExpr>(rhs))
     return e2->getValue() ? lhs : rhs;
 
-  return new AndExpr(Type(Type::Bool), lhs, rhs);
+  return intern(new AndExpr(Type(Type::Bool), std::move(lhs), std::move(rhs)));
 }
 
 ref<Expr> OrExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
@@ -565,7 +843,7 @@ ref<Expr> OrExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
   if (auto e2 = dyn_cast<BoolConstExpr>(rhs))
     return e2->getValue() ? rhs : lhs;
 
-  return new OrExpr(Type(Type::Bool), lhs, rhs);
+  return intern(new OrExpr(Type(Type::Bool), std::move(lhs), std::move(rhs)));
 }
 
 static ref<Expr> reassociateConstAdd(BVAddExpr *nonConstOp,
@@ -606,7 +884,8 @@ ref<Expr> BVAddExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
     }
   }
 
-  return new BVAddExpr(Type(Type::BV, lhsTy.width), lhs, rhs);
+  return intern(new BVAddExpr(Type(Type::BV, lhsTy.width), std::move(lhs),
+                              std::move(rhs)));
 }
 
 ref<Expr> BVSubExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
@@ -622,7 +901,8 @@ ref<Expr> BVSubExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
     if (e2->getValue().isMinValue())
       return lhs;
 
-  return new BVSubExpr(Type(Type::BV, lhsTy.width), lhs, rhs);
+  return intern(new BVSubExpr(Type(Type::BV, lhsTy.width), std::move(lhs),
+                              std::move(rhs)));
 }
 
 ref<Expr> BVMulExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
@@ -641,7 +921,8 @@ ref<Expr> BVMulExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
     if (e2->getValue().getLimitedValue() == 1)
       return lhs;
 
-  return new BVMulExpr(Type(Type::BV, lhsTy.width), lhs, rhs);
+  return intern(new BVMulExpr(Type(Type::BV, lhsTy.width), std::move(lhs),
+                              std::move(rhs)));
 }
 
 ref<Expr> BVSDivExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
@@ -654,7 +935,8 @@ ref<Expr> BVSDivExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
       if (e2->getValue().getSExtValue() != 0)
         return BVConstExpr::create(e1->getValue().sdiv(e2->getValue()));
 
-  return new BVSDivExpr(Type(Type::BV, lhsTy.width), lhs, rhs);
+  return intern(new BVSDivExpr(Type(Type::BV, lhsTy.width), std::move(lhs),
+                               std::move(rhs)));
 }
 
 ref<Expr> BVUDivExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
@@ -667,7 +949,8 @@ ref<Expr> BVUDivExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
       if (e2->getValue().getZExtValue() != 0)
         return BVConstExpr::create(e1->getValue().udiv(e2->getValue()));
 
-  return new BVUDivExpr(Type(Type::BV, lhsTy.width), lhs, rhs);
+  return intern(new BVUDivExpr(Type(Type::BV, lhsTy.width), std::move(lhs),
+                               std::move(rhs)));
 }
 
 static ref<Expr> createExactBVSDivMul(Expr *nonConstOp, BVConstExpr *constOp,
@@ -727,7 +1010,8 @@ ref<Expr> BVSRemExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
       if (e2->getValue().getSExtValue() != 0)
         return BVConstExpr::create(e1->getValue().srem(e2->getValue()));
 
-  return new BVSRemExpr(Type(Type::BV, lhsTy.width), lhs, rhs);
+  return intern(new BVSRemExpr(Type(Type::BV, lhsTy.width), std::move(lhs),
+                               std::move(rhs)));
 }
 
 ref<Expr> BVURemExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
@@ -740,7 +1024,8 @@ ref<Expr> BVURemExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
       if (e2->getValue().getZExtValue() != 0)
         return BVConstExpr::create(e1->getValue().urem(e2->getValue()));
 
-  return new BVURemExpr(Type(Type::BV, lhsTy.width), lhs, rhs);
+  return intern(new BVURemExpr(Type(Type::BV, lhsTy.width), std::move(lhs),
+                               std::move(rhs)));
 }
 
 ref<Expr> BVShlExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
@@ -752,7 +1037,8 @@ ref<Expr> BVShlExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
     if (auto e2 = dyn_cast<BVConstExpr>(rhs))
       return BVConstExpr::create(e1->getValue().shl(e2->getValue()));
 
-  return new BVShlExpr(Type(Type::BV, lhsTy.width), lhs, rhs);
+  return intern(new BVShlExpr(Type(Type::BV, lhsTy.width), std::move(lhs),
+                              std::move(rhs)));
 }
 
 ref<Expr> BVAShrExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
@@ -764,7 +1050,8 @@ ref<Expr> BVAShrExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
     if (auto e2 = dyn_cast<BVConstExpr>(rhs))
       return BVConstExpr::create(e1->getValue().ashr(e2->getValue()));
 
-  return new BVAShrExpr(Type(Type::BV, lhsTy.width), lhs, rhs);
+  return intern(new BVAShrExpr(Type(Type::BV, lhsTy.width), std::move(lhs),
+                               std::move(rhs)));
 }
 
 ref<Expr> BVLShrExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
@@ -776,7 +1063,8 @@ ref<Expr> BVLShrExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
     if (auto e2 = dyn_cast<BVConstExpr>(rhs))
       return BVConstExpr::create(e1->getValue().lshr(e2->getValue()));
 
-  return new BVLShrExpr(Type(Type::BV, lhsTy.width), lhs, rhs);
+  return intern(new BVLShrExpr(Type(Type::BV, lhsTy.width), std::move(lhs),
+                               std::move(rhs)));
 }
 
 ref<Expr> BVAndExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
@@ -788,7 +1076,8 @@ ref<Expr> BVAndExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
     if (auto e2 = dyn_cast<BVConstExpr>(rhs))
       return BVConstExpr::create(e1->getValue() & e2->getValue());
 
-  return new BVAndExpr(Type(Type::BV, lhsTy.width), lhs, rhs);
+  return intern(new BVAndExpr(Type(Type::BV, lhsTy.width), std::move(lhs),
+                              std::move(rhs)));
 }
 
 ref<Expr> BVOrExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
@@ -800,7 +1089,8 @@ ref<Expr> BVOrExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
     if (auto e2 = dyn_cast<BVConstExpr>(rhs))
       return BVConstExpr::create(e1->getValue() | e2->getValue());
 
-  return new BVOrExpr(Type(Type::BV, lhsTy.width), lhs, rhs);
+  return intern(new BVOrExpr(Type(Type::BV, lhsTy.width), std::move(lhs),
+                             std::move(rhs)));
 }
 
 ref<Expr> BVXorExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
@@ -812,7 +1102,8 @@ ref<Expr> BVXorExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
     if (auto e2 = dyn_cast<BVConstExpr>(rhs))
       return BVConstExpr::create(e1->getValue() ^ e2->getValue());
 
-  return new BVXorExpr(Type(Type::BV, lhsTy.width), lhs, rhs);
+  return intern(new BVXorExpr(Type(Type::BV, lhsTy.width), std::move(lhs),
+                              std::move(rhs)));
 }
 
 ref<Expr> BVConcatExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
@@ -828,7 +1119,8 @@ ref<Expr> BVConcatExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
       return BVConstExpr::create(Tmp);
     }
 
-  return new BVConcatExpr(Type(Type::BV, resWidth), lhs, rhs);
+  return intern(new BVConcatExpr(Type(Type::BV, resWidth), std::move(lhs),
+                                 std::move(rhs)));
 }
 
 ref<Expr> Expr::createBVConcatN(const std::vector<ref<Expr>> &exprs) {
@@ -846,7 +1138,7 @@ ref<Expr> Expr::createBVConcatN(const std::vector<ref<Expr>> &exprs) {
       if (auto e2 = dyn_cast<BVConstExpr>(rhs))                                \
         return BoolConstExpr::create(e1->getValue().method(e2->getValue()));   \
                                                                                \
-    return new cls(Type(Type::Bool), lhs, rhs);                                \
+    return intern(new cls(Type(Type::Bool), std::move(lhs), std::move(rhs)));  \
   }
 
 ICMP_EXPR_CREATE(BVUgtExpr, ugt)
@@ -862,84 +1154,84 @@ ref<Expr> FAddExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
   assert(lhs->getType().isKind(Type::BV));
   assert(lhs->getType() == rhs->getType());
 
-  return new FAddExpr(lhs->getType(), lhs, rhs);
+  return intern(new FAddExpr(lhs->getType(), lhs, rhs));
 }
 
 ref<Expr> FSubExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
   assert(lhs->getType().isKind(Type::BV));
   assert(lhs->getType() == rhs->getType());
 
-  return new FSubExpr(lhs->getType(), lhs, rhs);
+  return intern(new FSubExpr(lhs->getType(), lhs, rhs));
 }
 
 ref<Expr> FMulExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
   assert(lhs->getType().isKind(Type::BV));
   assert(lhs->getType() == rhs->getType());
 
-  return new FMulExpr(lhs->getType(), lhs, rhs);
+  return intern(new FMulExpr(lhs->getType(), lhs, rhs));
 }
 
 ref<Expr> FDivExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
   assert(lhs->getType().isKind(Type::BV));
   assert(lhs->getType() == rhs->getType());
 
-  return new FDivExpr(lhs->getType(), lhs, rhs);
+  return intern(new FDivExpr(lhs->getType(), lhs, rhs));
 }
 
 ref<Expr> FRemExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
   assert(lhs->getType().isKind(Type::BV));
   assert(lhs->getType() == rhs->getType());
 
-  return new FRemExpr(lhs->getType(), lhs, rhs);
+  return intern(new FRemExpr(lhs->getType(), lhs, rhs));
 }
 
 ref<Expr> FPowExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
   assert(lhs->getType().isKind(Type::BV));
   assert(lhs->getType() == rhs->getType());
 
-  return new FPowExpr(lhs->getType(), lhs, rhs);
+  return intern(new FPowExpr(lhs->getType(), lhs, rhs));
 }
 
 ref<Expr> FMaxExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
   assert(lhs->getType().isKind(Type::BV));
   assert(lhs->getType() == rhs->getType());
 
-  return new FMaxExpr(lhs->getType(), lhs, rhs);
+  return intern(new FMaxExpr(lhs->getType(), lhs, rhs));
 }
 
 ref<Expr> FMinExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
   assert(lhs->getType().isKind(Type::BV));
   assert(lhs->getType() == rhs->getType());
 
-  return new FMinExpr(lhs->getType(), lhs, rhs);
+  return intern(new FMinExpr(lhs->getType(), lhs, rhs));
 }
 
 ref<Expr> FPowiExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
   assert(lhs->getType().isKind(Type::BV));
   assert(rhs->getType().isKind(Type::BV));
 
-  return new FPowiExpr(lhs->getType(), lhs, rhs);
+  return intern(new FPowiExpr(lhs->getType(), lhs, rhs));
 }
 
 ref<Expr> FLtExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
   assert(lhs->getType().isKind(Type::BV));
   assert(lhs->getType() == rhs->getType());
 
-  return new FLtExpr(Type(Type::Bool), lhs, rhs);
+  return intern(new FLtExpr(Type(Type::Bool), std::move(lhs), std::move(rhs)));
 }
 
 ref<Expr> FEqExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
   assert(lhs->getType().isKind(Type::BV));
   assert(lhs->getType() == rhs->getType());
 
-  return new FEqExpr(Type(Type::Bool), lhs, rhs);
+  return intern(new FEqExpr(Type(Type::Bool), std::move(lhs), std::move(rhs)));
 }
 
 ref<Expr> FUnoExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
   assert(lhs->getType().isKind(Type::BV));
   assert(lhs->getType() == rhs->getType());
 
-  return new FUnoExpr(Type(Type::Bool), lhs, rhs);
+  return intern(new FUnoExpr(Type(Type::Bool), std::move(lhs), std::move(rhs)));
 }
 
 ref<Expr> Expr::createPtrLt(ref<Expr> lhs, ref<Expr> rhs) {
@@ -964,7 +1256,8 @@ ref<Expr> PtrLtExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
   assert(lhs->getType().isKind(Type::Pointer));
   assert(rhs->getType().isKind(Type::Pointer));
 
-  return new PtrLtExpr(Type(Type::Bool), lhs, rhs);
+  return intern(new PtrLtExpr(Type(Type::Bool), std::move(lhs),
+                              std::move(rhs)));
 }
 
 ref<Expr> Expr::createFuncPtrLt(ref<Expr> lhs, ref<Expr> rhs) {
@@ -981,14 +1274,16 @@ ref<Expr> FuncPtrLtExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
   assert(lhs->getType().isKind(Type::FunctionPointer));
   assert(rhs->getType().isKind(Type::FunctionPointer));
 
-  return new FuncPtrLtExpr(Type(Type::Bool), lhs, rhs);
+  return intern(new FuncPtrLtExpr(Type(Type::Bool), std::move(lhs),
+                                  std::move(rhs)));
 }
 
 ref<Expr> ImpliesExpr::create(ref<Expr> lhs, ref<Expr> rhs) {
   assert(lhs->getType().isKind(Type::Bool));
   assert(rhs->getType().isKind(Type::Bool));
 
-  return new ImpliesExpr(Type(Type::Bool), lhs, rhs);
+  return intern(new ImpliesExpr(Type(Type::Bool), std::move(lhs),
+                                std::move(rhs)));
 }
 
 ref<Expr> CallExpr::create(Function *f, const std::vector<ref<Expr>> &args) {
@@ -1007,57 +1302,57 @@ ref<Expr> CallMemberOfExpr::create(ref<Expr> f, std::vector<ref<Expr>> &ces) {
     assert(CE->getType() == T);
   }
 #endif
-  return new CallMemberOfExpr(T, f, ces);
+  return new CallMemberOfExpr(T, std::move(f), ces);
 }
 
 ref<Expr> OldExpr::create(ref<Expr> op) {
-  return new OldExpr(op->getType(), op);
+  return intern(new OldExpr(op->getType(), op));
 }
 
 ref<Expr> GetImageWidthExpr::create(ref<Expr> op) {
-  return new GetImageWidthExpr(Type(Type::BV, 32), op);
+  return intern(new GetImageWidthExpr(Type(Type::BV, 32), std::move(op)));
 }
 
 ref<Expr> GetImageHeightExpr::create(ref<Expr> op) {
-  return new GetImageHeightExpr(Type(Type::BV, 32), op);
+  return intern(new GetImageHeightExpr(Type(Type::BV, 32), std::move(op)));
 }
 
 ref<Expr> OtherBoolExpr::create(ref<Expr> op) {
   assert(op->getType().isKind(Type::Bool));
-  return new OtherBoolExpr(Type(Type::Bool), op);
+  return intern(new OtherBoolExpr(Type(Type::Bool), std::move(op)));
 }
 
 ref<Expr> OtherIntExpr::create(ref<Expr> op) {
   assert(op->getType().isKind(Type::BV));
-  return new OtherIntExpr(Type(Type::BV, op->getType().width), op);
+  return intern(new OtherIntExpr(Type(Type::BV, op->getType().width), op));
 }
 
 ref<Expr> OtherPtrBaseExpr::create(ref<Expr> op) {
-  return new OtherPtrBaseExpr(op->getType(), op);
+  return intern(new OtherPtrBaseExpr(op->getType(), op));
 }
 
 ref<Expr> AccessHasOccurredExpr::create(ref<Expr> array, bool isWrite) {
   assert(array->getType().array);
-  return new AccessHasOccurredExpr(array, isWrite);
+  return new AccessHasOccurredExpr(std::move(array), isWrite);
 }
 
 ref<Expr> AccessOffsetExpr::create(ref<Expr> array, unsigned pointerSize,
                                    bool isWrite) {
   assert(array->getType().array);
-  return new AccessOffsetExpr(array, pointerSize, isWrite);
+  return new AccessOffsetExpr(std::move(array), pointerSize, isWrite);
 }
 
 ref<Expr> ArraySnapshotExpr::create(ref<Expr> dst, ref<Expr> src) {
   assert(dst->getType().array);
   assert(src->getType().array);
 
-  return new ArraySnapshotExpr(dst, src);
+  return new ArraySnapshotExpr(std::move(dst), std::move(src));
 }
 
 ref<Expr> UnderlyingArrayExpr::create(ref<Expr> array) {
   assert(array->getType().array);
 
-  return new UnderlyingArrayExpr(array);
+  return new UnderlyingArrayExpr(std::move(array));
 }
 
 ref<Expr> AddNoovflExpr::create(ref<Expr> first, ref<Expr> second,
@@ -1066,7 +1361,7 @@ ref<Expr> AddNoovflExpr::create(ref<Expr> first, ref<Expr> second,
   assert(second->getType().isKind(Type::BV));
   assert(first->getType().width == second->getType().width);
 
-  return new AddNoovflExpr(first, second, isSigned);
+  return new AddNoovflExpr(std::move(first), std::move(second), isSigned);
 }
 
 ref<Expr> AddNoovflPredicateExpr::create(const std::vector<ref<Expr>> &exprs) {
@@ -1093,7 +1388,8 @@ ref<Expr> AtomicHasTakenValueExpr::create(ref<Expr> atomicArray,
   assert(offset->getType().isKind(Type::BV));
   assert(value->getType().isKind(Type::BV));
 
-  return new AtomicHasTakenValueExpr(atomicArray, offset, value);
+  return new AtomicHasTakenValueExpr(std::move(atomicArray), std::move(offset),
+                                     std::move(value));
 }
 
 ref<Expr> AsyncWorkGroupCopyExpr::create(ref<Expr> dst, ref<Expr> dstOffset,
@@ -1105,6 +1401,7 @@ ref<Expr> AsyncWorkGroupCopyExpr::create(ref<Expr> dst, ref<Expr> dstOffset,
   assert(srcOffset->getType().isKind(Type::BV));
   assert(size->getType().isKind(Type::BV));
   assert(handle->getType().isKind(Type::BV));
-  return new AsyncWorkGroupCopyExpr(dst, dstOffset, src, srcOffset, size,
-                                    handle);
+  return new AsyncWorkGroupCopyExpr(std::move(dst), std::move(dstOffset),
+                                    std::move(src), std::move(srcOffset),
+                                    std::move(size), std::move(handle));
 }
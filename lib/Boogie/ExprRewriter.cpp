@@ -0,0 +1,747 @@
+#include "bugle/ExprRewriter.h"
+#include "bugle/util/ErrorReporter.h"
+#include "bugle/util/Statistics.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace bugle;
+
+static llvm::cl::opt<bool> RewriteExprs(
+    "rewrite-exprs",
+    llvm::cl::desc("Simplify expressions with the rewrite rules as they are "
+                   "created"),
+    llvm::cl::init(false));
+
+static llvm::cl::list<std::string> DisabledRewrites(
+    "disable-expr-rewrite", llvm::cl::CommaSeparated,
+    llvm::cl::desc("Do not apply the named expression rewrite rules"),
+    llvm::cl::value_desc("rules"));
+
+static bool isConst(const ref<Expr> &E) {
+  return isa<BVConstExpr>(E) || isa<BoolConstExpr>(E);
+}
+
+static bool isZero(const ref<Expr> &E) {
+  auto CE = dyn_cast<BVConstExpr>(E);
+  return CE && CE->getValue().isMinValue();
+}
+
+static bool isOne(const ref<Expr> &E) {
+  auto CE = dyn_cast<BVConstExpr>(E);
+  return CE && CE->getValue() == 1;
+}
+
+static bool isAllOnes(const ref<Expr> &E) {
+  auto CE = dyn_cast<BVConstExpr>(E);
+  return CE && CE->getValue().isMaxValue();
+}
+
+// Holds if A is the negation of B.
+static bool isNotOf(const ref<Expr> &A, const ref<Expr> &B) {
+  auto NE = dyn_cast<NotExpr>(A);
+  return NE && NE->getSubExpr().get() == B.get();
+}
+
+static bool isComparison(Expr::Kind K) {
+  return K == Expr::Eq || K == Expr::Ne ||
+         (K >= Expr::BVUgt && K <= Expr::BVSle);
+}
+
+// The comparison that holds iff K holds of the swapped operands; for the
+// commutative operations, K itself.
+static Expr::Kind getSwappedKind(Expr::Kind K) {
+  switch (K) {
+  case Expr::BVUgt:
+    return Expr::BVUlt;
+  case Expr::BVUge:
+    return Expr::BVUle;
+  case Expr::BVUlt:
+    return Expr::BVUgt;
+  case Expr::BVUle:
+    return Expr::BVUge;
+  case Expr::BVSgt:
+    return Expr::BVSlt;
+  case Expr::BVSge:
+    return Expr::BVSle;
+  case Expr::BVSlt:
+    return Expr::BVSgt;
+  case Expr::BVSle:
+    return Expr::BVSge;
+  default:
+    return K;
+  }
+}
+
+// The comparison that holds iff K does not.
+static Expr::Kind getInverseKind(Expr::Kind K) {
+  switch (K) {
+  case Expr::Eq:
+    return Expr::Ne;
+  case Expr::Ne:
+    return Expr::Eq;
+  case Expr::BVUgt:
+    return Expr::BVUle;
+  case Expr::BVUge:
+    return Expr::BVUlt;
+  case Expr::BVUlt:
+    return Expr::BVUge;
+  case Expr::BVUle:
+    return Expr::BVUgt;
+  case Expr::BVSgt:
+    return Expr::BVSle;
+  case Expr::BVSge:
+    return Expr::BVSlt;
+  case Expr::BVSlt:
+    return Expr::BVSge;
+  case Expr::BVSle:
+    return Expr::BVSgt;
+  default:
+    llvm_unreachable("Not a comparison");
+  }
+}
+
+static ref<Expr> createBinary(Expr::Kind K, ref<Expr> LHS, ref<Expr> RHS) {
+  switch (K) {
+#define HANDLE_BINARY_EXPR(Kind)                                               \
+  case Expr::Kind:                                                             \
+    return Kind##Expr::create(std::move(LHS), std::move(RHS));
+#include "bugle/ExprKinds.def"
+  default:
+    llvm_unreachable("Not a binary expression");
+  }
+}
+
+// Boolean identities and absorption.
+
+static ref<Expr> foldAndOr(Expr *E) {
+  auto BE = cast<BinaryExpr>(E);
+  bool IsAnd = isa<AndExpr>(E);
+  ref<Expr> LHS = BE->getLHS(), RHS = BE->getRHS();
+  // x && x = x, x || x = x
+  if (LHS.get() == RHS.get())
+    return LHS;
+  // x && !x = false, x || !x = true
+  if (isNotOf(LHS, RHS) || isNotOf(RHS, LHS))
+    return BoolConstExpr::create(!IsAnd);
+  return ref<Expr>();
+}
+
+// x && (x || y) = x, x || (x && y) = x, and symmetrically.
+static ref<Expr> foldAndOrAbsorption(Expr *E) {
+  auto BE = cast<BinaryExpr>(E);
+  Expr::Kind Inner = isa<AndExpr>(E) ? Expr::Or : Expr::And;
+  ref<Expr> Ops[] = {BE->getLHS(), BE->getRHS()};
+  for (unsigned i = 0; i != 2; ++i) {
+    if (Ops[1 - i]->getKind() != Inner)
+      continue;
+    auto IBE = cast<BinaryExpr>(Ops[1 - i]);
+    if (IBE->getLHS().get() == Ops[i].get() ||
+        IBE->getRHS().get() == Ops[i].get())
+      return Ops[i];
+  }
+  return ref<Expr>();
+}
+
+static ref<Expr> foldNotNot(Expr *E) {
+  if (auto NE = dyn_cast<NotExpr>(cast<NotExpr>(E)->getSubExpr()))
+    return NE->getSubExpr();
+  return ref<Expr>();
+}
+
+static ref<Expr> foldImplies(Expr *E) {
+  auto IE = cast<ImpliesExpr>(E);
+  ref<Expr> LHS = IE->getLHS(), RHS = IE->getRHS();
+  if (auto CE = dyn_cast<BoolConstExpr>(LHS))
+    return CE->getValue() ? RHS : BoolConstExpr::create(true);
+  if (auto CE = dyn_cast<BoolConstExpr>(RHS))
+    return CE->getValue() ? RHS : NotExpr::create(LHS);
+  if (LHS.get() == RHS.get())
+    return BoolConstExpr::create(true);
+  return ref<Expr>();
+}
+
+// Comparison canonicalisation.
+
+// Moves a constant operand of a comparison or a commutative operation to the
+// right, so that the other rules and hash-consing need only consider one
+// order of the operands.
+static ref<Expr> moveConstRight(Expr *E) {
+  auto BE = cast<BinaryExpr>(E);
+  if (!isConst(BE->getLHS()) || isConst(BE->getRHS()))
+    return ref<Expr>();
+  return createBinary(getSwappedKind(E->getKind()), BE->getRHS(),
+                      BE->getLHS());
+}
+
+static ref<Expr> foldCmpSame(Expr *E) {
+  auto BE = cast<BinaryExpr>(E);
+  if (BE->getLHS().get() != BE->getRHS().get())
+    return ref<Expr>();
+  switch (E->getKind()) {
+  case Expr::Eq:
+  case Expr::BVUge:
+  case Expr::BVUle:
+  case Expr::BVSge:
+  case Expr::BVSle:
+    return BoolConstExpr::create(true);
+  default:
+    return BoolConstExpr::create(false);
+  }
+}
+
+// Folds the comparisons with the least or the greatest value, and turns the
+// remaining unsigned comparisons with zero into equalities.
+static ref<Expr> foldCmpBound(Expr *E) {
+  auto BE = cast<BinaryExpr>(E);
+  auto CE = dyn_cast<BVConstExpr>(BE->getRHS());
+  if (!CE)
+    return ref<Expr>();
+  const llvm::APInt &Val = CE->getValue();
+  switch (E->getKind()) {
+  case Expr::BVUlt:
+  case Expr::BVUge:
+    if (Val.isMinValue())
+      return BoolConstExpr::create(E->getKind() == Expr::BVUge);
+    break;
+  case Expr::BVUle:
+  case Expr::BVUgt:
+    if (Val.isMaxValue())
+      return BoolConstExpr::create(E->getKind() == Expr::BVUle);
+    if (Val.isMinValue())
+      return createBinary(E->getKind() == Expr::BVUle ? Expr::Eq : Expr::Ne,
+                          BE->getLHS(), BE->getRHS());
+    break;
+  case Expr::BVSlt:
+  case Expr::BVSge:
+    if (Val.isMinSignedValue())
+      return BoolConstExpr::create(E->getKind() == Expr::BVSge);
+    break;
+  case Expr::BVSle:
+  case Expr::BVSgt:
+    if (Val.isMaxSignedValue())
+      return BoolConstExpr::create(E->getKind() == Expr::BVSle);
+    break;
+  default:
+    break;
+  }
+  return ref<Expr>();
+}
+
+// x == true = x, x == false = !x, and the converse for !=.
+static ref<Expr> foldEqBoolConst(Expr *E) {
+  auto BE = cast<BinaryExpr>(E);
+  ref<Expr> LHS = BE->getLHS(), RHS = BE->getRHS();
+  if (isa<BoolConstExpr>(LHS))
+    std::swap(LHS, RHS);
+  auto CE = dyn_cast<BoolConstExpr>(RHS);
+  if (!CE)
+    return ref<Expr>();
+  return CE->getValue() == isa<EqExpr>(E) ? LHS : NotExpr::create(LHS);
+}
+
+// Compares booleans that were converted to bitvectors as booleans.
+static ref<Expr> foldEqBoolToBV(Expr *E) {
+  auto BE = cast<BinaryExpr>(E);
+  ref<Expr> LHS = BE->getLHS(), RHS = BE->getRHS();
+  if (!isa<BoolToBVExpr>(LHS))
+    std::swap(LHS, RHS);
+  auto B2BV = dyn_cast<BoolToBVExpr>(LHS);
+  if (!B2BV)
+    return ref<Expr>();
+  if (auto RB2BV = dyn_cast<BoolToBVExpr>(RHS))
+    return createBinary(E->getKind(), B2BV->getSubExpr(),
+                        RB2BV->getSubExpr());
+  if (isConst(RHS))
+    return createBinary(E->getKind(), B2BV->getSubExpr(),
+                        BoolConstExpr::create(isOne(RHS)));
+  return ref<Expr>();
+}
+
+// !(x < y) = x >= y, and so on.
+static ref<Expr> foldNotCmp(Expr *E) {
+  ref<Expr> Op = cast<NotExpr>(E)->getSubExpr();
+  if (!isComparison(Op->getKind()))
+    return ref<Expr>();
+  auto BE = cast<BinaryExpr>(Op);
+  return createBinary(getInverseKind(Op->getKind()), BE->getLHS(),
+                      BE->getRHS());
+}
+
+// Bitvector identities and absorption.
+
+// x - x = 0, and x - c = x + -c, such that constants are reassociated by
+// BVAddExpr::create.
+static ref<Expr> foldBVSub(Expr *E) {
+  auto SE = cast<BVSubExpr>(E);
+  ref<Expr> LHS = SE->getLHS(), RHS = SE->getRHS();
+  if (LHS.get() == RHS.get())
+    return BVConstExpr::createZero(E->getType().width);
+  if (auto CE = dyn_cast<BVConstExpr>(RHS))
+    if (!isConst(LHS))
+      return BVAddExpr::create(LHS, BVConstExpr::create(-CE->getValue()));
+  return ref<Expr>();
+}
+
+static ref<Expr> foldBVMulZero(Expr *E) {
+  auto ME = cast<BVMulExpr>(E);
+  if (isZero(ME->getLHS()))
+    return ME->getLHS();
+  if (isZero(ME->getRHS()))
+    return ME->getRHS();
+  return ref<Expr>();
+}
+
+static ref<Expr> foldBVBitwise(Expr *E) {
+  auto BE = cast<BinaryExpr>(E);
+  ref<Expr> LHS = BE->getLHS(), RHS = BE->getRHS();
+  if (isConst(LHS))
+    std::swap(LHS, RHS);
+  bool Same = LHS.get() == RHS.get();
+  switch (E->getKind()) {
+  case Expr::BVAnd:
+    if (Same || isAllOnes(RHS))
+      return LHS;
+    if (isZero(RHS))
+      return RHS;
+    break;
+  case Expr::BVOr:
+    if (Same || isZero(RHS))
+      return LHS;
+    if (isAllOnes(RHS))
+      return RHS;
+    break;
+  case Expr::BVXor:
+    if (Same)
+      return BVConstExpr::createZero(E->getType().width);
+    if (isZero(RHS))
+      return LHS;
+    break;
+  default:
+    break;
+  }
+  return ref<Expr>();
+}
+
+// x << 0 = x, 0 << x = 0, and shifting out every bit yields 0.
+static ref<Expr> foldShift(Expr *E) {
+  auto BE = cast<BinaryExpr>(E);
+  ref<Expr> LHS = BE->getLHS(), RHS = BE->getRHS();
+  if (isZero(RHS) || isZero(LHS))
+    return LHS;
+  auto CE = dyn_cast<BVConstExpr>(RHS);
+  if (CE && !isa<BVAShrExpr>(E) &&
+      CE->getValue().uge(E->getType().width))
+    return BVConstExpr::createZero(E->getType().width);
+  return ref<Expr>();
+}
+
+static ref<Expr> foldDivOne(Expr *E) {
+  auto BE = cast<BinaryExpr>(E);
+  return isOne(BE->getRHS()) ? BE->getLHS() : ref<Expr>();
+}
+
+static ref<Expr> foldRemOne(Expr *E) {
+  auto BE = cast<BinaryExpr>(E);
+  if (isOne(BE->getRHS()))
+    return BVConstExpr::createZero(E->getType().width);
+  return ref<Expr>();
+}
+
+// Constant propagation through extract, concat and extension.
+
+// Extracts bits that a constant shift moves into place from the operand of
+// the shift, or folds them to zero if they were shifted in.
+static ref<Expr> foldExtractShift(Expr *E) {
+  auto EE = cast<BVExtractExpr>(E);
+  ref<Expr> Op = EE->getSubExpr();
+  if (!isa<BVShlExpr>(Op) && !isa<BVLShrExpr>(Op) && !isa<BVAShrExpr>(Op))
+    return ref<Expr>();
+  auto SE = cast<BinaryExpr>(Op);
+  auto CE = dyn_cast<BVConstExpr>(SE->getRHS());
+  if (!CE)
+    return ref<Expr>();
+
+  unsigned OpWidth = Op->getType().width;
+  unsigned Offset = EE->getOffset(), Width = E->getType().width;
+  unsigned Shift = CE->getValue().getLimitedValue(OpWidth);
+  if (isa<BVShlExpr>(Op)) {
+    if (Offset + Width <= Shift)
+      return BVConstExpr::createZero(Width);
+    if (Offset >= Shift)
+      return BVExtractExpr::create(SE->getLHS(), Offset - Shift, Width);
+  } else if (Offset + Shift + Width <= OpWidth) {
+    return BVExtractExpr::create(SE->getLHS(), Offset + Shift, Width);
+  } else if (isa<BVLShrExpr>(Op) && Offset + Shift >= OpWidth) {
+    return BVConstExpr::createZero(Width);
+  }
+  return ref<Expr>();
+}
+
+// Pushes an extract into a bitwise operation with a constant, such that the
+// constant is narrowed and the extract may fold with the other operand.
+static ref<Expr> foldExtractBitwise(Expr *E) {
+  auto EE = cast<BVExtractExpr>(E);
+  ref<Expr> Op = EE->getSubExpr();
+  if (!isa<BVAndExpr>(Op) && !isa<BVOrExpr>(Op) && !isa<BVXorExpr>(Op))
+    return ref<Expr>();
+  auto BE = cast<BinaryExpr>(Op);
+  if (!isConst(BE->getLHS()) && !isConst(BE->getRHS()))
+    return ref<Expr>();
+  unsigned Offset = EE->getOffset(), Width = E->getType().width;
+  return createBinary(Op->getKind(),
+                      BVExtractExpr::create(BE->getLHS(), Offset, Width),
+                      BVExtractExpr::create(BE->getRHS(), Offset, Width));
+}
+
+// The low bits of a sum, difference or product only depend on the low bits
+// of the operands. The extract is pushed into the operation if this lets it
+// fold with at least one of the operands.
+static ref<Expr> foldExtractArithLow(Expr *E) {
+  auto EE = cast<BVExtractExpr>(E);
+  ref<Expr> Op = EE->getSubExpr();
+  if (EE->getOffset() != 0 ||
+      (!isa<BVAddExpr>(Op) && !isa<BVSubExpr>(Op) && !isa<BVMulExpr>(Op)))
+    return ref<Expr>();
+  auto BE = cast<BinaryExpr>(Op);
+  unsigned Width = E->getType().width;
+  ref<Expr> LHS = BVExtractExpr::create(BE->getLHS(), 0, Width);
+  ref<Expr> RHS = BVExtractExpr::create(BE->getRHS(), 0, Width);
+  if (isa<BVExtractExpr>(LHS) && isa<BVExtractExpr>(RHS))
+    return ref<Expr>();
+  return createBinary(Op->getKind(), LHS, RHS);
+}
+
+// Extracts of the bits an extension adds; BVExtractExpr::create handles the
+// extracts of the bits of the extended operand.
+static ref<Expr> foldExtractExt(Expr *E) {
+  auto EE = cast<BVExtractExpr>(E);
+  ref<Expr> Op = EE->getSubExpr();
+  if (!isa<BVZExtExpr>(Op) && !isa<BVSExtExpr>(Op))
+    return ref<Expr>();
+  ref<Expr> Inner = cast<UnaryExpr>(Op)->getSubExpr();
+  unsigned InnerWidth = Inner->getType().width;
+  unsigned Offset = EE->getOffset(), Width = E->getType().width;
+  if (isa<BVZExtExpr>(Op) && Offset >= InnerWidth)
+    return BVConstExpr::createZero(Width);
+  if (Offset == 0 && Width > InnerWidth)
+    return isa<BVZExtExpr>(Op) ? BVZExtExpr::create(Width, Inner)
+                               : BVSExtExpr::create(Width, Inner);
+  return ref<Expr>();
+}
+
+// zext(zext(x)) = zext(x), sext(sext(x)) = sext(x), and sext(zext(x)) =
+// zext(x), as the sign bit of a widening zero extension is zero.
+static ref<Expr> foldExtExt(Expr *E) {
+  ref<Expr> Op = cast<UnaryExpr>(E)->getSubExpr();
+  unsigned Width = E->getType().width;
+  if (auto ZE = dyn_cast<BVZExtExpr>(Op))
+    return BVZExtExpr::create(Width, ZE->getSubExpr());
+  if (auto SE = dyn_cast<BVSExtExpr>(Op))
+    if (isa<BVSExtExpr>(E))
+      return BVSExtExpr::create(Width, SE->getSubExpr());
+  return ref<Expr>();
+}
+
+static ref<Expr> foldConcatZero(Expr *E) {
+  auto CE = cast<BVConcatExpr>(E);
+  if (isZero(CE->getLHS()) && !isConst(CE->getRHS()))
+    return BVZExtExpr::create(E->getType().width, CE->getRHS());
+  return ref<Expr>();
+}
+
+// Concatenations of adjacent extracts of the same bitvector.
+static ref<Expr> foldConcatExtracts(Expr *E) {
+  auto CE = cast<BVConcatExpr>(E);
+  auto High = dyn_cast<BVExtractExpr>(CE->getLHS());
+  auto Low = dyn_cast<BVExtractExpr>(CE->getRHS());
+  if (!High || !Low || High->getSubExpr().get() != Low->getSubExpr().get() ||
+      High->getOffset() != Low->getOffset() + Low->getType().width)
+    return ref<Expr>();
+  return BVExtractExpr::create(Low->getSubExpr(), Low->getOffset(),
+                               E->getType().width);
+}
+
+static ref<Expr> foldBoolBVConst(Expr *E) {
+  ref<Expr> Op = cast<UnaryExpr>(E)->getSubExpr();
+  if (auto CE = dyn_cast<BVConstExpr>(Op))
+    return BoolConstExpr::create(CE->getValue() == 1);
+  if (auto CE = dyn_cast<BoolConstExpr>(Op))
+    return BVConstExpr::create(1, CE->getValue());
+  return ref<Expr>();
+}
+
+// If-then-else simplification and lifting.
+
+static ref<Expr> foldITESameArms(Expr *E) {
+  auto ITE = cast<IfThenElseExpr>(E);
+  if (ITE->getTrueExpr().get() == ITE->getFalseExpr().get())
+    return ITE->getTrueExpr();
+  return ref<Expr>();
+}
+
+static ref<Expr> foldITENotCond(Expr *E) {
+  auto ITE = cast<IfThenElseExpr>(E);
+  if (auto NE = dyn_cast<NotExpr>(ITE->getCond()))
+    return IfThenElseExpr::create(NE->getSubExpr(), ITE->getFalseExpr(),
+                                  ITE->getTrueExpr());
+  return ref<Expr>();
+}
+
+// An arm that tests the condition again knows its outcome.
+static ref<Expr> foldITENestedCond(Expr *E) {
+  auto ITE = cast<IfThenElseExpr>(E);
+  ref<Expr> Cond = ITE->getCond();
+  if (auto T = dyn_cast<IfThenElseExpr>(ITE->getTrueExpr()))
+    if (T->getCond().get() == Cond.get())
+      return IfThenElseExpr::create(Cond, T->getTrueExpr(),
+                                    ITE->getFalseExpr());
+  if (auto F = dyn_cast<IfThenElseExpr>(ITE->getFalseExpr()))
+    if (F->getCond().get() == Cond.get())
+      return IfThenElseExpr::create(Cond, ITE->getTrueExpr(),
+                                    F->getFalseExpr());
+  return ref<Expr>();
+}
+
+// Conditionals with a boolean constant arm are conjunctions or disjunctions.
+static ref<Expr> foldITEBoolArms(Expr *E) {
+  auto ITE = cast<IfThenElseExpr>(E);
+  ref<Expr> Cond = ITE->getCond();
+  if (auto CE = dyn_cast<BoolConstExpr>(ITE->getTrueExpr()))
+    return CE->getValue()
+               ? OrExpr::create(Cond, ITE->getFalseExpr())
+               : AndExpr::create(NotExpr::create(Cond), ITE->getFalseExpr());
+  if (auto CE = dyn_cast<BoolConstExpr>(ITE->getFalseExpr()))
+    return CE->getValue()
+               ? OrExpr::create(NotExpr::create(Cond), ITE->getTrueExpr())
+               : AndExpr::create(Cond, ITE->getTrueExpr());
+  return ref<Expr>();
+}
+
+static IfThenElseExpr *getITEWithConstArms(const ref<Expr> &E) {
+  auto ITE = dyn_cast<IfThenElseExpr>(E);
+  if (ITE && isConst(ITE->getTrueExpr()) && isConst(ITE->getFalseExpr()))
+    return ITE;
+  return nullptr;
+}
+
+static ref<Expr> recreateUnary(Expr *E, ref<Expr> Op) {
+  unsigned Width = E->getType().width;
+  switch (E->getKind()) {
+  case Expr::BVExtract:
+    return BVExtractExpr::create(Op, cast<BVExtractExpr>(E)->getOffset(),
+                                 Width);
+  case Expr::BVZExt:
+    return BVZExtExpr::create(Width, Op);
+  case Expr::BVSExt:
+    return BVSExtExpr::create(Width, Op);
+  case Expr::BVToBool:
+    return BVToBoolExpr::create(Op);
+  case Expr::BoolToBV:
+    return BoolToBVExpr::create(Op);
+  default:
+    llvm_unreachable("Unexpected expression kind");
+  }
+}
+
+// op(ite(c, k1, k2)) = ite(c, op(k1), op(k2)) if both arms fold to constants.
+static ref<Expr> liftITEUnary(Expr *E) {
+  ref<Expr> Op = isa<BVExtractExpr>(E) ? cast<BVExtractExpr>(E)->getSubExpr()
+                                       : cast<UnaryExpr>(E)->getSubExpr();
+  auto ITE = getITEWithConstArms(Op);
+  if (!ITE)
+    return ref<Expr>();
+  ref<Expr> T = recreateUnary(E, ITE->getTrueExpr());
+  ref<Expr> F = recreateUnary(E, ITE->getFalseExpr());
+  if (!isConst(T) || !isConst(F))
+    return ref<Expr>();
+  return IfThenElseExpr::create(ITE->getCond(), T, F);
+}
+
+// op(ite(c, k1, k2), k) = ite(c, op(k1, k), op(k2, k)) if both arms fold to
+// constants, and likewise if the other operand is a conditional on c.
+static ref<Expr> liftITEBinary(Expr *E) {
+  auto BE = cast<BinaryExpr>(E);
+  ref<Expr> Cond, Arms[2][2];
+  ref<Expr> Ops[] = {BE->getLHS(), BE->getRHS()};
+  for (unsigned i = 0; i != 2; ++i) {
+    if (auto ITE = getITEWithConstArms(Ops[i])) {
+      if (!Cond.isNull() && Cond.get() != ITE->getCond().get())
+        return ref<Expr>();
+      Cond = ITE->getCond();
+      Arms[0][i] = ITE->getTrueExpr();
+      Arms[1][i] = ITE->getFalseExpr();
+    } else if (isConst(Ops[i])) {
+      Arms[0][i] = Arms[1][i] = Ops[i];
+    } else {
+      return ref<Expr>();
+    }
+  }
+  if (Cond.isNull())
+    return ref<Expr>();
+
+  ref<Expr> T = createBinary(E->getKind(), Arms[0][0], Arms[0][1]);
+  ref<Expr> F = createBinary(E->getKind(), Arms[1][0], Arms[1][1]);
+  if (!isConst(T) || !isConst(F))
+    return ref<Expr>();
+  return IfThenElseExpr::create(Cond, T, F);
+}
+
+// The rules of each kind are tried in the order in which they are listed.
+static const RewriteRule Rules[] = {
+    {"and-or-idempotent", Expr::And, foldAndOr},
+    {"and-or-idempotent", Expr::Or, foldAndOr},
+    {"and-or-absorb", Expr::And, foldAndOrAbsorption},
+    {"and-or-absorb", Expr::Or, foldAndOrAbsorption},
+    {"not-not", Expr::Not, foldNotNot},
+    {"not-cmp", Expr::Not, foldNotCmp},
+    {"implies-fold", Expr::Implies, foldImplies},
+
+    {"cmp-same", Expr::Eq, foldCmpSame},
+    {"cmp-same", Expr::Ne, foldCmpSame},
+    {"cmp-same", Expr::BVUgt, foldCmpSame},
+    {"cmp-same", Expr::BVUge, foldCmpSame},
+    {"cmp-same", Expr::BVUlt, foldCmpSame},
+    {"cmp-same", Expr::BVUle, foldCmpSame},
+    {"cmp-same", Expr::BVSgt, foldCmpSame},
+    {"cmp-same", Expr::BVSge, foldCmpSame},
+    {"cmp-same", Expr::BVSlt, foldCmpSame},
+    {"cmp-same", Expr::BVSle, foldCmpSame},
+    {"const-right", Expr::Eq, moveConstRight},
+    {"const-right", Expr::Ne, moveConstRight},
+    {"const-right", Expr::BVUgt, moveConstRight},
+    {"const-right", Expr::BVUge, moveConstRight},
+    {"const-right", Expr::BVUlt, moveConstRight},
+    {"const-right", Expr::BVUle, moveConstRight},
+    {"const-right", Expr::BVSgt, moveConstRight},
+    {"const-right", Expr::BVSge, moveConstRight},
+    {"const-right", Expr::BVSlt, moveConstRight},
+    {"const-right", Expr::BVSle, moveConstRight},
+    {"const-right", Expr::BVAdd, moveConstRight},
+    {"const-right", Expr::BVMul, moveConstRight},
+    {"const-right", Expr::BVAnd, moveConstRight},
+    {"const-right", Expr::BVOr, moveConstRight},
+    {"const-right", Expr::BVXor, moveConstRight},
+    {"cmp-bound", Expr::BVUgt, foldCmpBound},
+    {"cmp-bound", Expr::BVUge, foldCmpBound},
+    {"cmp-bound", Expr::BVUlt, foldCmpBound},
+    {"cmp-bound", Expr::BVUle, foldCmpBound},
+    {"cmp-bound", Expr::BVSgt, foldCmpBound},
+    {"cmp-bound", Expr::BVSge, foldCmpBound},
+    {"cmp-bound", Expr::BVSlt, foldCmpBound},
+    {"cmp-bound", Expr::BVSle, foldCmpBound},
+    {"eq-bool-const", Expr::Eq, foldEqBoolConst},
+    {"eq-bool-const", Expr::Ne, foldEqBoolConst},
+    {"eq-bool-to-bv", Expr::Eq, foldEqBoolToBV},
+    {"eq-bool-to-bv", Expr::Ne, foldEqBoolToBV},
+
+    {"bvsub-fold", Expr::BVSub, foldBVSub},
+    {"bvmul-zero", Expr::BVMul, foldBVMulZero},
+    {"bitwise-fold", Expr::BVAnd, foldBVBitwise},
+    {"bitwise-fold", Expr::BVOr, foldBVBitwise},
+    {"bitwise-fold", Expr::BVXor, foldBVBitwise},
+    {"shift-fold", Expr::BVShl, foldShift},
+    {"shift-fold", Expr::BVLShr, foldShift},
+    {"shift-fold", Expr::BVAShr, foldShift},
+    {"div-one", Expr::BVUDiv, foldDivOne},
+    {"div-one", Expr::BVSDiv, foldDivOne},
+    {"rem-one", Expr::BVURem, foldRemOne},
+    {"rem-one", Expr::BVSRem, foldRemOne},
+
+    {"extract-shift", Expr::BVExtract, foldExtractShift},
+    {"extract-bitwise", Expr::BVExtract, foldExtractBitwise},
+    {"extract-arith-low", Expr::BVExtract, foldExtractArithLow},
+    {"extract-ext", Expr::BVExtract, foldExtractExt},
+    {"ext-ext", Expr::BVZExt, foldExtExt},
+    {"ext-ext", Expr::BVSExt, foldExtExt},
+    {"concat-zero", Expr::BVConcat, foldConcatZero},
+    {"concat-extracts", Expr::BVConcat, foldConcatExtracts},
+    {"bool-bv-const", Expr::BVToBool, foldBoolBVConst},
+    {"bool-bv-const", Expr::BoolToBV, foldBoolBVConst},
+
+    {"ite-same-arms", Expr::IfThenElse, foldITESameArms},
+    {"ite-not-cond", Expr::IfThenElse, foldITENotCond},
+    {"ite-nested-cond", Expr::IfThenElse, foldITENestedCond},
+    {"ite-bool-arms", Expr::IfThenElse, foldITEBoolArms},
+    {"ite-lift", Expr::BVExtract, liftITEUnary},
+    {"ite-lift", Expr::BVZExt, liftITEUnary},
+    {"ite-lift", Expr::BVSExt, liftITEUnary},
+    {"ite-lift", Expr::BVToBool, liftITEUnary},
+    {"ite-lift", Expr::BoolToBV, liftITEUnary},
+    {"ite-lift", Expr::Eq, liftITEBinary},
+    {"ite-lift", Expr::Ne, liftITEBinary},
+    {"ite-lift", Expr::BVAdd, liftITEBinary},
+    {"ite-lift", Expr::BVSub, liftITEBinary},
+    {"ite-lift", Expr::BVMul, liftITEBinary},
+    {"ite-lift", Expr::BVShl, liftITEBinary},
+    {"ite-lift", Expr::BVLShr, liftITEBinary},
+    {"ite-lift", Expr::BVAShr, liftITEBinary},
+    {"ite-lift", Expr::BVAnd, liftITEBinary},
+    {"ite-lift", Expr::BVOr, liftITEBinary},
+    {"ite-lift", Expr::BVXor, liftITEBinary},
+    {"ite-lift", Expr::BVConcat, liftITEBinary},
+    {"ite-lift", Expr::BVUgt, liftITEBinary},
+    {"ite-lift", Expr::BVUge, liftITEBinary},
+    {"ite-lift", Expr::BVUlt, liftITEBinary},
+    {"ite-lift", Expr::BVUle, liftITEBinary},
+    {"ite-lift", Expr::BVSgt, liftITEBinary},
+    {"ite-lift", Expr::BVSge, liftITEBinary},
+    {"ite-lift", Expr::BVSlt, liftITEBinary},
+    {"ite-lift", Expr::BVSle, liftITEBinary},
+};
+
+namespace {
+
+enum {
+  NumExprKinds = 0
+#define HANDLE_EXPR(Kind) +1
+#include "bugle/ExprKinds.def"
+};
+}
+
+thread_local const ExprRewriter *ExprRewriter::Current = nullptr;
+
+ExprRewriter::ExprRewriter(llvm::ArrayRef<std::string> DisabledRules)
+    : KindRules(NumExprKinds) {
+  for (auto &R : Rules) {
+    if (std::find(DisabledRules.begin(), DisabledRules.end(), R.Name) !=
+        DisabledRules.end())
+      Disabled.push_back(R.Name);
+    else
+      KindRules[R.Kind].push_back(&R);
+  }
+  std::sort(Disabled.begin(), Disabled.end());
+  Disabled.erase(std::unique(Disabled.begin(), Disabled.end()),
+                 Disabled.end());
+}
+
+llvm::ArrayRef<RewriteRule> ExprRewriter::getRules() { return Rules; }
+
+std::unique_ptr<ExprRewriter> ExprRewriter::createFromOptions() {
+  for (auto i = DisabledRewrites.begin(), e = DisabledRewrites.end(); i != e;
+       ++i) {
+    auto IsNamed = [&](const RewriteRule &R) { return *i == R.Name; };
+    if (std::none_of(std::begin(Rules), std::end(Rules), IsNamed))
+      ErrorReporter::reportParameterError(
+          "Unknown expression rewrite rule '" + *i + "'");
+  }
+
+  if (!RewriteExprs)
+    return nullptr;
+  return std::unique_ptr<ExprRewriter>(new ExprRewriter(DisabledRewrites));
+}
+
+ref<Expr> ExprRewriter::rewrite(Expr *E) const {
+  auto &Candidates = KindRules[E->getKind()];
+  for (auto i = Candidates.begin(), e = Candidates.end(); i != e; ++i) {
+    ref<Expr> Result = (*i)->Apply(E);
+    if (!Result.isNull()) {
+      if (Statistics::isEnabled())
+        Statistics::add("expr-rewrites", (*i)->Name);
+      return Result;
+    }
+  }
+  return ref<Expr>();
+}
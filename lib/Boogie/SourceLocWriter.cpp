@@ -1,7 +1,6 @@
 #include "bugle/SourceLocWriter.h"
 #include "bugle/SourceLoc.h"
 #include "llvm/Support/raw_ostream.h"
-#include "llvm/Support/ToolOutputFile.h"
 
 using namespace bugle;
 
@@ -10,7 +9,7 @@ unsigned SourceLocWriter::writeSourceLocs(const SourceLocsRef &sourcelocs) {
   if (L == 0)
     return SourceLocCounter - 1;
 
-  llvm::raw_ostream &OS = L->os();
+  llvm::raw_ostream &OS = *L;
 
   for (auto i = sourcelocs->begin(), e = sourcelocs->end(); i != e; ++i) {
     OS << i->getLineNo() << "\x1F";   // unit separator
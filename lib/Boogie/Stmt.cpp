@@ -2,13 +2,18 @@
 #include "bugle/Expr.h"
 #include "bugle/GlobalArray.h"
 #include "bugle/Ref.h"
+#include "bugle/util/Statistics.h"
 
 using namespace bugle;
 
 EvalStmt *EvalStmt::create(ref<Expr> expr, const SourceLocsRef &sourcelocs) {
   assert(!expr->hasEvalStmt);
   expr->hasEvalStmt = true;
-  return new EvalStmt(expr, sourcelocs);
+  // Structurally equal expressions created later may be evaluated elsewhere.
+  expr->removeFromUniqueTable();
+  if (Statistics::isEnabled())
+    Statistics::add("eval-stmts-created");
+  return new EvalStmt(std::move(expr), sourcelocs);
 }
 
 EvalStmt::~EvalStmt() { expr->hasEvalStmt = false; }
@@ -21,18 +26,19 @@ StoreStmt *StoreStmt::create(ref<Expr> array, ref<Expr> offset, ref<Expr> value,
          value->getType().isKind(array->getType().kind));
   assert(array->getType().kind == Type::Any ||
          value->getType().width == array->getType().width);
-  return new StoreStmt(array, offset, value, sourcelocs);
+  return new StoreStmt(std::move(array), std::move(offset), std::move(value),
+                       sourcelocs);
 }
 
 VarAssignStmt *VarAssignStmt::create(Var *var, ref<Expr> value) {
   assert(var->getType() == value->getType());
   std::vector<Var *> vars(1, var);
-  std::vector<ref<Expr>> values(1, value);
-  return new VarAssignStmt(vars, values);
+  std::vector<ref<Expr>> values(1, std::move(value));
+  return new VarAssignStmt(std::move(vars), std::move(values));
 }
 
-VarAssignStmt *VarAssignStmt::create(const std::vector<Var *> &vars,
-                                     const std::vector<ref<Expr>> &values) {
+VarAssignStmt *VarAssignStmt::create(std::vector<Var *> vars,
+                                     std::vector<ref<Expr>> values) {
   assert(!vars.empty() && vars.size() == values.size());
 #ifndef NDEBUG
   auto li = vars.begin(), le = vars.end();
@@ -40,7 +46,7 @@ VarAssignStmt *VarAssignStmt::create(const std::vector<Var *> &vars,
     assert((*li)->getType() == (*ri)->getType());
   }
 #endif
-  return new VarAssignStmt(vars, values);
+  return new VarAssignStmt(std::move(vars), std::move(values));
 }
 
 GotoStmt *GotoStmt::create(BasicBlock *block) {
@@ -55,16 +61,16 @@ GotoStmt *GotoStmt::create(const std::vector<BasicBlock *> &blocks) {
 ReturnStmt *ReturnStmt::create() { return new ReturnStmt(); }
 
 AssumeStmt *AssumeStmt::create(ref<Expr> pred) {
-  return new AssumeStmt(pred, false);
+  return new AssumeStmt(std::move(pred), false);
 }
 
 AssumeStmt *AssumeStmt::createPartition(ref<Expr> pred) {
-  return new AssumeStmt(pred, true);
+  return new AssumeStmt(std::move(pred), true);
 }
 
 AssertStmt *AssertStmt::create(ref<Expr> pred, bool global, bool candidate,
                                const SourceLocsRef &sourcelocs) {
-  AssertStmt *AS = new AssertStmt(pred, sourcelocs);
+  AssertStmt *AS = new AssertStmt(std::move(pred), sourcelocs);
   AS->global = global;
   AS->candidate = candidate;
   return AS;
@@ -73,7 +79,7 @@ AssertStmt *AssertStmt::create(ref<Expr> pred, bool global, bool candidate,
 AssertStmt *AssertStmt::createInvariant(ref<Expr> pred, bool global,
                                         bool candidate,
                                         const SourceLocsRef &sourcelocs) {
-  AssertStmt *AS = new AssertStmt(pred, sourcelocs);
+  AssertStmt *AS = new AssertStmt(std::move(pred), sourcelocs);
   AS->invariant = true;
   AS->global = global;
   AS->candidate = candidate;
@@ -92,9 +98,9 @@ AssertStmt *AssertStmt::createBlockSourceLoc(const SourceLocsRef &sourcelocs) {
   return AS;
 }
 
-CallStmt *CallStmt::create(Function *callee, const std::vector<ref<Expr>> &args,
+CallStmt *CallStmt::create(Function *callee, std::vector<ref<Expr>> args,
                            const SourceLocsRef &sourcelocs) {
-  return new CallStmt(callee, args, sourcelocs);
+  return new CallStmt(callee, std::move(args), sourcelocs);
 }
 
 CallMemberOfStmt *CallMemberOfStmt::create(ref<Expr> func,
@@ -104,11 +110,11 @@ CallMemberOfStmt *CallMemberOfStmt::create(ref<Expr> func,
   for (auto i = callStmts.begin(), e = callStmts.end(); i != e; ++i)
     assert(isa<CallStmt>(*i));
 #endif
-  return new CallMemberOfStmt(func, callStmts, sourcelocs);
+  return new CallMemberOfStmt(std::move(func), callStmts, sourcelocs);
 }
 
 Stmt *WaitGroupEventStmt::create(ref<Expr> handle,
                                  const SourceLocsRef &sourcelocs) {
   assert(handle->getType().isKind(Type::BV));
-  return new WaitGroupEventStmt(handle, sourcelocs);
+  return new WaitGroupEventStmt(std::move(handle), sourcelocs);
 }
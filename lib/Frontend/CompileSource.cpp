@@ -0,0 +1,113 @@
+#include "bugle/Frontend/CompileSource.h"
+#include "bugle/Frontend/InlineCheck.h"
+#include "bugle/util/ErrorReporter.h"
+#include "clang/CodeGen/CodeGenAction.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/MultiplexConsumer.h"
+#include "llvm/IR/Module.h"
+
+using namespace bugle;
+using namespace clang;
+
+namespace {
+
+// Generates LLVM IR, while also running the inline check.
+class BugleCodeGenAction : public EmitLLVMOnlyAction {
+public:
+  BugleCodeGenAction(llvm::LLVMContext *Context)
+      : EmitLLVMOnlyAction(Context) {}
+
+protected:
+  std::unique_ptr<ASTConsumer>
+  CreateASTConsumer(CompilerInstance &CI, llvm::StringRef InFile) override {
+    std::vector<std::unique_ptr<ASTConsumer>> Consumers;
+    Consumers.push_back(createInlineCheckConsumer(CI));
+    Consumers.push_back(EmitLLVMOnlyAction::CreateASTConsumer(CI, InFile));
+    return llvm::make_unique<MultiplexConsumer>(std::move(Consumers));
+  }
+};
+}
+
+#ifndef BUGLE_CLANG_RESOURCE_DIR
+#define BUGLE_CLANG_RESOURCE_DIR ""
+#endif
+
+// The -cc1 arguments corresponding to the clang invocation used by GPUVerify,
+// except that headers such as opencl.h are not included implicitly; sources
+// include them, or -include is given as an extra argument.
+static void getFrontendArgs(llvm::StringRef Filename,
+                            TranslateModule::SourceLanguage SL,
+                            const FrontendOptions &Opts,
+                            std::vector<std::string> &Args) {
+  Args.push_back("-triple");
+  Args.push_back(Opts.Triple);
+  Args.push_back("-O0");
+  Args.push_back("-disable-O0-optnone");
+  Args.push_back("-fno-builtin");
+  Args.push_back("-debug-info-kind=limited");
+  Args.push_back("-dwarf-column-info");
+  Args.push_back("-Wall");
+
+  if (*BUGLE_CLANG_RESOURCE_DIR) {
+    Args.push_back("-resource-dir");
+    Args.push_back(BUGLE_CLANG_RESOURCE_DIR);
+  }
+  Args.push_back("-I");
+  Args.push_back(Opts.IncludeDir);
+
+  switch (SL) {
+  case TranslateModule::SL_OpenCL:
+    Args.push_back("-x");
+    Args.push_back("cl");
+    Args.push_back("-cl-std=CL1.2");
+    break;
+  case TranslateModule::SL_CUDA:
+    Args.push_back("-x");
+    Args.push_back("cuda");
+    Args.push_back("-fcuda-is-device");
+    break;
+  default:
+    Args.push_back("-x");
+    Args.push_back("c");
+    break;
+  }
+
+  Args.insert(Args.end(), Opts.ExtraArgs.begin(), Opts.ExtraArgs.end());
+  Args.push_back(Filename.str());
+}
+
+std::unique_ptr<llvm::Module>
+bugle::compileSource(llvm::MemoryBufferRef Buffer,
+                     TranslateModule::SourceLanguage SL,
+                     const FrontendOptions &Opts, llvm::LLVMContext &Context) {
+  llvm::StringRef Filename = Buffer.getBufferIdentifier();
+  std::vector<std::string> Args;
+  getFrontendArgs(Filename, SL, Opts, Args);
+  std::vector<const char *> ArgPtrs;
+  for (auto i = Args.begin(), e = Args.end(); i != e; ++i)
+    ArgPtrs.push_back(i->c_str());
+
+  CompilerInstance CI;
+  CI.createDiagnostics();
+  if (!CompilerInvocation::CreateFromArgs(CI.getInvocation(), ArgPtrs.data(),
+                                          ArgPtrs.data() + ArgPtrs.size(),
+                                          CI.getDiagnostics()))
+    ErrorReporter::reportParameterError("Invalid frontend arguments");
+
+  // The source is read from Buffer rather than from the file system, so that
+  // sources received by the server can be compiled too.
+  CI.getPreprocessorOpts().addRemappedFile(
+      Filename,
+      llvm::MemoryBuffer::getMemBufferCopy(Buffer.getBuffer(), Filename)
+          .release());
+
+  BugleCodeGenAction Action(&Context);
+  if (!CI.ExecuteAction(Action))
+    ErrorReporter::reportFatalError("Compilation failed");
+
+  std::unique_ptr<llvm::Module> M = Action.takeModule();
+  if (!M)
+    ErrorReporter::reportFatalError("Compilation failed");
+  return M;
+}
@@ -1,7 +1,5 @@
+#include "bugle/Frontend/InlineCheck.h"
 #include "clang/AST/ASTConsumer.h"
-#include "clang/AST/AST.h"
-#include "clang/AST/Attr.h"
-#include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/FrontendPluginRegistry.h"
 
@@ -9,49 +7,11 @@ using namespace clang;
 
 namespace {
 
-class CheckInlineVisitor : public RecursiveASTVisitor<CheckInlineVisitor> {
-public:
-  CheckInlineVisitor(CompilerInstance &CI) : Instance(CI) {}
-
-  bool VisitFunctionDecl(FunctionDecl *F) {
-    if (F->isInlineSpecified() && F->hasBody() &&
-        !F->hasAttr<AlwaysInlineAttr>()) {
-      FullSourceLoc FL = Instance.getASTContext().getFullLoc(F->getLocStart());
-      DiagnosticsEngine &D = Instance.getDiagnostics();
-      unsigned DiagID =
-          D.getCustomDiagID(DiagnosticsEngine::Error,
-                            "inline occurs without always_inline attribute");
-
-      if (FL.isValid())
-        D.Report(FL, DiagID);
-      else
-        D.Report(DiagID);
-    }
-
-    return true;
-  }
-
-private:
-  CompilerInstance &Instance;
-};
-
-class CheckInlineConsumer : public ASTConsumer {
-public:
-  explicit CheckInlineConsumer(CompilerInstance &CI) : Visitor(CI) {}
-
-  void HandleTranslationUnit(ASTContext &AT) override {
-    Visitor.TraverseDecl(AT.getTranslationUnitDecl());
-  }
-
-private:
-  CheckInlineVisitor Visitor;
-};
-
 class CheckInlineAction : public PluginASTAction {
 protected:
   std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &CI,
                                                  llvm::StringRef) {
-    return llvm::make_unique<CheckInlineConsumer>(CI);
+    return bugle::createInlineCheckConsumer(CI);
   }
 
   bool ParseArgs(const CompilerInstance &CI,
@@ -23,7 +23,7 @@ bool InlinePass::doInline(llvm::Instruction *I, llvm::Function *OF) {
     ErrorReporter::reportImplementationLimitation(
         "Function pointers not compatible with inlining");
 
-  if (!(TranslateModule::isGPUEntryPoint(OF, M, SL, GPUEntryPoints) ||
+  if (!(EntryPoints.contains(OF) ||
         TranslateFunction::isStandardEntryPoint(SL, OF->getName()))) {
     if (TranslateFunction::isPreOrPostCondition(F->getName())) {
       ErrorReporter::reportFatalError(
@@ -39,7 +39,7 @@ bool InlinePass::doInline(llvm::Instruction *I, llvm::Function *OF) {
 
   // Do not inline entry points in entry points, they may have pre- and
   // post-conditions.
-  if (TranslateModule::isGPUEntryPoint(F, M, SL, GPUEntryPoints) ||
+  if (EntryPoints.contains(F) ||
       TranslateFunction::isStandardEntryPoint(SL, F->getName()))
     return false;
 
@@ -75,6 +75,7 @@ void InlinePass::doInline(llvm::Function *F) {
 
 bool InlinePass::runOnModule(llvm::Module &M) {
   this->M = &M;
+  EntryPoints = TranslateModule::GPUEntryPointSet(&M, SL, GPUEntryPoints);
 
   for (auto i = M.begin(), e = M.end(); i != e; ++i)
     doInline(&*i);
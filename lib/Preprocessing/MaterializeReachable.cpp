@@ -0,0 +1,136 @@
+#include "bugle/Preprocessing/MaterializeReachable.h"
+#include "bugle/Preprocessing/SimpleInternalizePass.h"
+#include "bugle/Translator/TranslateFunction.h"
+#include "bugle/util/ErrorReporter.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include <map>
+#include <vector>
+
+using namespace llvm;
+using namespace bugle;
+
+namespace {
+
+class ReachableMaterializer {
+  llvm::Module *M;
+  std::map<const Comdat *, std::vector<llvm::Function *>> ComdatMembers;
+  SmallPtrSet<llvm::Function *, 32> Reachable;
+  SmallPtrSet<Constant *, 32> VisitedConstants;
+  std::vector<llvm::Function *> Worklist;
+
+  void markReachable(llvm::Function *F);
+  void markReferencedFunctions(Value *V);
+  void materialize(llvm::Function *F);
+
+public:
+  ReachableMaterializer(llvm::Module *M) : M(M) {}
+  void run(TranslateModule::SourceLanguage SL,
+           std::set<std::string> &GPUEntryPoints,
+           const std::set<std::string> &ExternalRoots, bool Internalize,
+           bool OnlyExplicitEntryPoints);
+};
+}
+
+void ReachableMaterializer::markReachable(llvm::Function *F) {
+  if (!Reachable.insert(F).second)
+    return;
+
+  Worklist.push_back(F);
+
+  // As with global DCE, the members of a comdat are kept together.
+  if (const Comdat *C = F->getComdat()) {
+    auto &Members = ComdatMembers[C];
+    for (auto i = Members.begin(), e = Members.end(); i != e; ++i)
+      markReachable(*i);
+  }
+}
+
+void ReachableMaterializer::markReferencedFunctions(Value *V) {
+  if (auto *F = dyn_cast<llvm::Function>(V)) {
+    markReachable(F);
+    return;
+  }
+
+  // Global variables and aliases are handled as roots.
+  auto *C = dyn_cast<Constant>(V);
+  if (!C || isa<GlobalValue>(C) || !VisitedConstants.insert(C).second)
+    return;
+
+  for (auto i = C->op_begin(), e = C->op_end(); i != e; ++i)
+    markReferencedFunctions(*i);
+}
+
+void ReachableMaterializer::materialize(llvm::Function *F) {
+  if (Error E = F->materialize())
+    ErrorReporter::reportFatalError(toString(std::move(E)));
+
+  for (auto bi = F->begin(), be = F->end(); bi != be; ++bi)
+    for (auto ii = bi->begin(), ie = bi->end(); ii != ie; ++ii)
+      for (auto oi = ii->op_begin(), oe = ii->op_end(); oi != oe; ++oi)
+        markReferencedFunctions(*oi);
+
+  if (F->hasPersonalityFn())
+    markReferencedFunctions(F->getPersonalityFn());
+}
+
+void ReachableMaterializer::run(TranslateModule::SourceLanguage SL,
+                                std::set<std::string> &GPUEntryPoints,
+                                const std::set<std::string> &ExternalRoots,
+                                bool Internalize,
+                                bool OnlyExplicitEntryPoints) {
+  for (auto i = M->begin(), e = M->end(); i != e; ++i)
+    if (const Comdat *C = i->getComdat())
+      ComdatMembers[C].push_back(&*i);
+
+  TranslateModule::GPUEntryPointSet EPS(M, SL, GPUEntryPoints);
+  for (auto i = M->begin(), e = M->end(); i != e; ++i) {
+    llvm::Function *F = &*i;
+    if (!TranslateFunction::isNormalFunction(SL, F) ||
+        SimpleInternalizePass::isEntryPoint(SL, EPS, OnlyExplicitEntryPoints,
+                                            F) ||
+        ExternalRoots.count(F->getName().str()) ||
+        (!Internalize && !F->isDiscardableIfUnused()))
+      markReachable(F);
+  }
+
+  for (auto i = M->global_begin(), e = M->global_end(); i != e; ++i)
+    if (i->hasInitializer())
+      markReferencedFunctions(i->getInitializer());
+
+  for (auto i = M->alias_begin(), e = M->alias_end(); i != e; ++i)
+    markReferencedFunctions(i->getAliasee());
+
+  while (!Worklist.empty()) {
+    llvm::Function *F = Worklist.back();
+    Worklist.pop_back();
+    materialize(F);
+  }
+
+  for (auto i = M->begin(), e = M->end(); i != e;) {
+    llvm::Function *F = &*i++;
+    if (!F->isMaterializable() || Reachable.count(F))
+      continue;
+    F->deleteBody();
+    if (F->use_empty())
+      F->eraseFromParent();
+  }
+
+  // Only the remainder of the module, such as its metadata, is left to be
+  // materialized.
+  if (Error E = M->materializeAll())
+    ErrorReporter::reportFatalError(toString(std::move(E)));
+}
+
+void bugle::materializeReachable(llvm::Module *M,
+                                 TranslateModule::SourceLanguage SL,
+                                 std::set<std::string> &GPUEntryPoints,
+                                 const std::set<std::string> &ExternalRoots,
+                                 bool Internalize,
+                                 bool OnlyExplicitEntryPoints) {
+  ReachableMaterializer RM(M);
+  RM.run(SL, GPUEntryPoints, ExternalRoots, Internalize,
+         OnlyExplicitEntryPoints);
+}
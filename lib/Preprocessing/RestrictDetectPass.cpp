@@ -1,4 +1,5 @@
 #include "bugle/Preprocessing/RestrictDetectPass.h"
+#include "bugle/Translator/DebugInfoIndex.h"
 #include "bugle/Translator/TranslateFunction.h"
 #include "bugle/Translator/TranslateModule.h"
 #include "bugle/util/ErrorReporter.h"
@@ -15,22 +16,12 @@ using namespace bugle;
 
 bool RestrictDetectPass::doInitialization(llvm::Module &M) {
   this->M = &M;
-  DIF.processModule(M);
+  EntryPoints = TranslateModule::GPUEntryPointSet(&M, SL, GPUEntryPoints);
   return false;
 }
 
-const DISubprogram *RestrictDetectPass::getDebugInfo(llvm::Function *F) {
-  auto SS = DIF.subprograms();
-  for (auto i = SS.begin(), e = SS.end(); i != e; ++i) {
-    if ((*i)->describes(F))
-      return *i;
-  }
-
-  return 0;
-}
-
 std::string RestrictDetectPass::getFunctionLocation(llvm::Function *F) {
-  auto MDS = getDebugInfo(F);
+  auto MDS = DebugInfo.getSubprogram(F);
   if (MDS) {
     std::string l; llvm::raw_string_ostream lS(l);
     lS << "'" << MDS->getName() << "' on line " << MDS->getLine()
@@ -49,7 +40,7 @@ bool RestrictDetectPass::ignoreArgument(unsigned i, const DISubprogram *DIS) {
 }
 
 void RestrictDetectPass::doRestrictCheck(llvm::Function &F) {
-  auto *DIS = getDebugInfo(&F);
+  auto *DIS = DebugInfo.getSubprogram(&F);
   std::vector<Argument *> AL;
   for (auto i = F.arg_begin(), e = F.arg_end(); i != e; ++i) {
     if (!i->getType()->isPointerTy())
@@ -77,7 +68,7 @@ void RestrictDetectPass::doRestrictCheck(llvm::Function &F) {
 
   auto i = AL.begin(), e = AL.end();
   do {
-    msg += "'" + TranslateModule::getSourceName(*i, &F) + "'";
+    msg += "'" + DebugInfo.getSourceName(*i, &F) + "'";
     ++i;
     if (i != e)
       msg += ", ";
@@ -94,7 +85,7 @@ bool RestrictDetectPass::runOnFunction(llvm::Function &F) {
     return false;
   if (!TranslateFunction::isNormalFunction(SL, &F))
     return false;
-  if (!TranslateModule::isGPUEntryPoint(&F, M, SL, GPUEntryPoints))
+  if (!EntryPoints.contains(&F))
     return false;
 
   doRestrictCheck(F);
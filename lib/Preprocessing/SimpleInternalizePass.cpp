@@ -8,16 +8,20 @@
 using namespace llvm;
 using namespace bugle;
 
-bool SimpleInternalizePass::isEntryPoint(llvm::Function *F) {
+bool SimpleInternalizePass::isEntryPoint(
+    TranslateModule::SourceLanguage SL,
+    const TranslateModule::GPUEntryPointSet &EPS, bool OnlyExplicitEntryPoints,
+    llvm::Function *F) {
   if (OnlyExplicitEntryPoints)
-    return GPUEntryPoints.find(F->getName()) != GPUEntryPoints.end();
+    return EPS.isExplicit(F);
   else
-    return TranslateModule::isGPUEntryPoint(F, M, SL, GPUEntryPoints) ||
+    return EPS.contains(F) ||
            TranslateFunction::isStandardEntryPoint(SL, F->getName());
 }
 
 bool SimpleInternalizePass::doInternalize(llvm::Function *F) {
-  if (!TranslateFunction::isNormalFunction(SL, F) || isEntryPoint(F) ||
+  if (!TranslateFunction::isNormalFunction(SL, F) ||
+      isEntryPoint(SL, EntryPoints, OnlyExplicitEntryPoints, F) ||
       F->isDeclaration())
     return false;
 
@@ -29,6 +33,7 @@ bool SimpleInternalizePass::doInternalize(llvm::Function *F) {
 bool SimpleInternalizePass::runOnModule(llvm::Module &M) {
   bool changed = false;
   this->M = &M;
+  EntryPoints = TranslateModule::GPUEntryPointSet(&M, SL, GPUEntryPoints);
 
   for (auto i = M.begin(), e = M.end(); i != e; ++i)
     changed &= doInternalize(&*i);
@@ -2,24 +2,40 @@
 #include "bugle/Module.h"
 #include "bugle/Function.h"
 #include "bugle/BasicBlock.h"
+#include "bugle/ExprVisitor.h"
+#include "bugle/util/Statistics.h"
+#include "bugle/util/TimeTrace.h"
 
 using namespace bugle;
 
 namespace {
 
-bool hasSideEffects(Expr *e) {
-  return isa<CallExpr>(e) || isa<CallMemberOfExpr>(e) ||
-         isa<ArraySnapshotExpr>(e) || isa<AddNoovflExpr>(e) ||
-         isa<AtomicExpr>(e);
-}
+// Holds for expressions whose evaluation cannot be dropped.
+class HasSideEffects : public ExprVisitor<HasSideEffects, bool> {
+public:
+  bool visitCallExpr(CallExpr *) { return true; }
+  bool visitCallMemberOfExpr(CallMemberOfExpr *) { return true; }
+  bool visitArraySnapshotExpr(ArraySnapshotExpr *) { return true; }
+  bool visitAddNoovflExpr(AddNoovflExpr *) { return true; }
+  bool visitAtomicExpr(AtomicExpr *) { return true; }
+  bool visitExpr(Expr *) { return false; }
+};
 
-bool isTemporal(Expr *e) {
-  if (auto LE = dyn_cast<LoadExpr>(e)) {
-    return LE->getIsTemporal();
-  }
-  return isa<HavocExpr>(e) || isa<ArraySnapshotExpr>(e) || isa<AtomicExpr>(e) ||
-         isa<AsyncWorkGroupCopyExpr>(e) || isa<BVCtlzExpr>(e);
-}
+// Holds for expressions whose value depends on the point of evaluation.
+class IsTemporal : public ExprVisitor<IsTemporal, bool> {
+public:
+  bool visitLoadExpr(LoadExpr *LE) { return LE->getIsTemporal(); }
+  bool visitHavocExpr(HavocExpr *) { return true; }
+  bool visitArraySnapshotExpr(ArraySnapshotExpr *) { return true; }
+  bool visitAtomicExpr(AtomicExpr *) { return true; }
+  bool visitAsyncWorkGroupCopyExpr(AsyncWorkGroupCopyExpr *) { return true; }
+  bool visitBVCtlzExpr(BVCtlzExpr *) { return true; }
+  bool visitExpr(Expr *) { return false; }
+};
+
+bool hasSideEffects(Expr *e) { return HasSideEffects().visit(e); }
+
+bool isTemporal(Expr *e) { return IsTemporal().visit(e); }
 
 void ProcessBasicBlock(BasicBlock *BB) {
   OwningPtrVector<Stmt> &V = BB->getStmtVector();
@@ -47,6 +63,8 @@ void ProcessBasicBlock(BasicBlock *BB) {
           --i;
         delete *ii;
         V.erase(ii);
+        if (Statistics::isEnabled())
+          Statistics::add("eval-stmts-removed");
         if (begin)
           break;
         else
@@ -70,4 +88,7 @@ void ProcessModule(Module *M) {
 }
 }
 
-void bugle::simplifyStmt(Module *M) { ProcessModule(M); }
+void bugle::simplifyStmt(Module *M) {
+  TimeTraceScope Scope("Simplify statements");
+  ProcessModule(M);
+}
@@ -0,0 +1,83 @@
+#include "bugle/Translator/DebugInfoIndex.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+
+using namespace llvm;
+using namespace bugle;
+
+DebugInfoIndex::DebugInfoIndex(llvm::Module *M) {
+  // Each function is mapped to the first subprogram that describes it, either
+  // as its attached subprogram or by name.
+  std::map<const DISubprogram *, const llvm::Function *> Attached;
+  for (auto &F : *M) {
+    if (auto *SP = F.getSubprogram())
+      Attached.insert(std::make_pair(SP, &F));
+  }
+
+  DebugInfoFinder DIF;
+  DIF.processModule(*M);
+  auto SS = DIF.subprograms();
+  for (auto i = SS.begin(), e = SS.end(); i != e; ++i) {
+    auto AI = Attached.find(*i);
+    if (AI != Attached.end())
+      Subprograms.insert(std::make_pair(AI->second, *i));
+
+    StringRef Name = (*i)->getLinkageName();
+    if (Name.empty())
+      Name = (*i)->getName();
+    if (auto *F = M->getFunction(Name))
+      Subprograms.insert(std::make_pair(F, *i));
+  }
+
+  for (auto &F : *M) {
+    for (auto &BB : F) {
+      for (auto &I : BB) {
+        const Value *V;
+        const DILocalVariable *Var;
+        if (const auto *DVI = dyn_cast<DbgValueInst>(&I)) {
+          V = DVI->getValue();
+          Var = DVI->getVariable();
+        } else if (const auto *DDI = dyn_cast<DbgDeclareInst>(&I)) {
+          V = DDI->getAddress();
+          Var = DDI->getVariable();
+        } else {
+          continue;
+        }
+
+        if (V)
+          LocalVars.insert(std::make_pair(std::make_pair(&F, V), Var));
+      }
+    }
+  }
+}
+
+const DISubprogram *
+DebugInfoIndex::getSubprogram(const llvm::Function *F) const {
+  auto SI = Subprograms.find(F);
+  return SI != Subprograms.end() ? SI->second : nullptr;
+}
+
+const DILocalVariable *
+DebugInfoIndex::getLocalVariable(const Value *V,
+                                 const llvm::Function *F) const {
+  auto LI = LocalVars.find(std::make_pair(F, V));
+  return LI != LocalVars.end() ? LI->second : nullptr;
+}
+
+std::string
+DebugInfoIndex::getSourceFunctionName(const llvm::Function *F) const {
+  if (auto *SP = getSubprogram(F))
+    return SP->getName();
+
+  return F->getName();
+}
+
+std::string DebugInfoIndex::getSourceName(const Value *V,
+                                          const llvm::Function *F) const {
+  if (auto *DILV = getLocalVariable(V, F))
+    return DILV->getName();
+  else
+    return V->getName();
+}
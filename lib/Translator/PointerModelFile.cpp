@@ -0,0 +1,216 @@
+#include "bugle/Translator/PointerModelFile.h"
+#include "bugle/Translator/TranslateModule.h"
+#include "bugle/Expr.h"
+#include "bugle/util/ErrorReporter.h"
+#include "bugle/util/Statistics.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace bugle;
+
+// The version of the file format, to be bumped whenever it changes.
+static const char *const FileVersion = "bugle-models-1";
+
+// Number the values that may have a model or be modelled as an array: the
+// globals, the functions, their arguments and instructions, and the struct
+// members of the arguments of the entry points.
+void PointerModelFile::numberValues() {
+  llvm::Module *M = TM->M;
+  auto Number = [&](Value *V) {
+    Numbers[V] = Values.size();
+    Values.push_back(V);
+  };
+
+  for (auto i = M->global_begin(), e = M->global_end(); i != e; ++i)
+    Number(&*i);
+  for (auto i = M->begin(), e = M->end(); i != e; ++i)
+    Number(&*i);
+  for (auto i = M->begin(), e = M->end(); i != e; ++i) {
+    for (auto ai = i->arg_begin(), ae = i->arg_end(); ai != ae; ++ai)
+      Number(&*ai);
+    for (auto ii = inst_begin(&*i), ie = inst_end(&*i); ii != ie; ++ii)
+      Number(&*ii);
+    if (!i->isDeclaration() && TM->EntryPoints.contains(&*i)) {
+      auto SV = TM->getStructArrays(&*i);
+      for (auto si = SV->begin(), se = SV->end(); si != se; ++si)
+        Number(*si);
+    }
+  }
+}
+
+// Parse the models in Contents, only updating the models of the module if
+// all of them refer to known values.
+bool PointerModelFile::parse(StringRef Contents) {
+  bool AllAsByteArray = false;
+  std::set<Value *> ByteArray, MayBeNull;
+  std::map<Value *, std::set<Value *>> GlobalOffset;
+
+  StringRef Line, Rest;
+  std::tie(Line, Rest) = Contents.split('\n');
+  if (Line != (std::string(FileVersion) + " " + Key))
+    return false;
+
+  while (!Rest.empty()) {
+    std::tie(Line, Rest) = Rest.split('\n');
+    SmallVector<StringRef, 8> Fields;
+    Line.split(Fields, ' ', -1, /*KeepEmpty=*/false);
+    if (Fields.size() < 2)
+      return false;
+
+    if (Fields[0] == "all-byte-array" && Fields.size() == 2) {
+      AllAsByteArray = Fields[1] == "1";
+      continue;
+    }
+
+    std::vector<Value *> Vs;
+    for (auto i = Fields.begin() + 1, e = Fields.end(); i != e; ++i) {
+      unsigned N;
+      if (i->getAsInteger(10, N) || N >= Values.size())
+        return false;
+      Vs.push_back(Values[N]);
+    }
+
+    if (Fields[0] == "byte-array" && Vs.size() == 1)
+      ByteArray.insert(Vs[0]);
+    else if (Fields[0] == "may-be-null" && Vs.size() == 1)
+      MayBeNull.insert(Vs[0]);
+    else if (Fields[0] == "global-offset" && Vs.size() > 1)
+      GlobalOffset[Vs[0]].insert(Vs.begin() + 1, Vs.end());
+    else
+      return false;
+  }
+
+  TM->ModelAsByteArray = ByteArray;
+  TM->ModelAllAsByteArray = TM->NextModelAllAsByteArray = AllAsByteArray;
+  TM->ModelPtrAsGlobalOffset = TM->NextModelPtrAsGlobalOffset = GlobalOffset;
+  TM->PtrMayBeNull = TM->NextPtrMayBeNull = MayBeNull;
+  return true;
+}
+
+// Print the models of the module to Contents. Values are written in the
+// order of their numbers, such that unchanged models give the same contents.
+// Returns false if a model refers to a value that is not numbered.
+bool PointerModelFile::print(std::string &Contents) {
+  std::map<unsigned, const std::set<Value *> *> GlobalOffset;
+  std::set<unsigned> ByteArray, MayBeNull;
+  auto GetNumber = [&](Value *V, unsigned &N) {
+    auto NI = Numbers.find(V);
+    if (NI == Numbers.end())
+      return false;
+    N = NI->second;
+    return true;
+  };
+
+  unsigned N;
+  for (auto i = TM->ModelAsByteArray.begin(), e = TM->ModelAsByteArray.end();
+       i != e; ++i) {
+    if (!GetNumber(*i, N))
+      return false;
+    ByteArray.insert(N);
+  }
+  for (auto i = TM->PtrMayBeNull.begin(), e = TM->PtrMayBeNull.end(); i != e;
+       ++i) {
+    if (!GetNumber(*i, N))
+      return false;
+    MayBeNull.insert(N);
+  }
+  for (auto i = TM->ModelPtrAsGlobalOffset.begin(),
+            e = TM->ModelPtrAsGlobalOffset.end();
+       i != e; ++i) {
+    if (!GetNumber(i->first, N))
+      return false;
+    GlobalOffset[N] = &i->second;
+  }
+
+  raw_string_ostream OS(Contents);
+  OS << FileVersion << " " << Key << "\n";
+  OS << "all-byte-array " << (TM->ModelAllAsByteArray ? 1 : 0) << "\n";
+  for (auto i = ByteArray.begin(), e = ByteArray.end(); i != e; ++i)
+    OS << "byte-array " << *i << "\n";
+  for (auto i = GlobalOffset.begin(), e = GlobalOffset.end(); i != e; ++i) {
+    std::set<unsigned> Arrays;
+    for (auto ai = i->second->begin(), ae = i->second->end(); ai != ae; ++ai) {
+      if (!GetNumber(*ai, N))
+        return false;
+      Arrays.insert(N);
+    }
+    OS << "global-offset " << i->first;
+    for (auto ai = Arrays.begin(), ae = Arrays.end(); ai != ae; ++ai)
+      OS << " " << *ai;
+    OS << "\n";
+  }
+  for (auto i = MayBeNull.begin(), e = MayBeNull.end(); i != e; ++i)
+    OS << "may-be-null " << *i << "\n";
+  OS.flush();
+  return true;
+}
+
+// Load the models from the file, returning whether they were saved for this
+// module. A missing or outdated file is not an error.
+bool PointerModelFile::load() {
+  numberValues();
+
+  std::string KeyData;
+  raw_string_ostream KS(KeyData);
+  TM->writeModelKey(KS);
+  WriteBitcodeToFile(TM->M, KS);
+  KS.flush();
+  SHA1 Hasher;
+  Hasher.update(KeyData);
+  Key = toHex(Hasher.final());
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+      MemoryBuffer::getFile(Path);
+  if (!BufferOrErr)
+    return false;
+  Contents = BufferOrErr.get()->getBuffer().str();
+  if (!parse(Contents))
+    return false;
+
+  if (Statistics::isEnabled())
+    Statistics::add("loaded-models");
+  return true;
+}
+
+// Save the models to the file if they changed. The file is written under a
+// temporary name and renamed into place, so that a concurrent translation
+// never loads a partial file.
+void PointerModelFile::save() {
+  std::string NewContents;
+  if (!print(NewContents) || NewContents == Contents)
+    return;
+
+  int FD;
+  SmallString<128> TempPath;
+  if (sys::fs::createUniqueFile(Path + ".tmp-%%%%%%%%", FD, TempPath)) {
+    ErrorReporter::emitWarning("Cannot save pointer models to " + Path);
+    return;
+  }
+
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << NewContents;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath);
+      ErrorReporter::emitWarning("Cannot save pointer models to " + Path);
+      return;
+    }
+  }
+
+  if (sys::fs::rename(TempPath, Path)) {
+    sys::fs::remove(TempPath);
+    ErrorReporter::emitWarning("Cannot save pointer models to " + Path);
+    return;
+  }
+  Contents = NewContents;
+}
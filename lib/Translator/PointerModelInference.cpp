@@ -0,0 +1,376 @@
+#include "bugle/Translator/PointerModelInference.h"
+#include "bugle/Translator/TranslateFunction.h"
+#include "bugle/Translator/TranslateModule.h"
+#include "bugle/Type.h"
+#include "bugle/util/Statistics.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GetElementPtrTypeIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Support/MathExtras.h"
+
+using namespace llvm;
+using namespace bugle;
+
+bool PointerModelInference::PointerInfo::isDivisibleBy(uint64_t Div) const {
+  // Mirrors Expr::createExactBVSDiv, which only divides by powers of two.
+  if (Div == 1)
+    return true;
+  if (Div == 0 || (Div & (Div - 1)) != 0)
+    return false;
+  return ConstOffset % Div == 0 && Stride % Div == 0;
+}
+
+bool PointerModelInference::isTranslated(llvm::Function *F) {
+  if (F->isIntrinsic())
+    return false;
+  return TranslateFunction::isAxiomFunction(F->getName()) ||
+         !TranslateFunction::isSpecialFunction(TM->SL, F->getName());
+}
+
+uint64_t PointerModelInference::getRangeBytes(Value *V) {
+  return TM->getGlobalArrayRangeType(V).width / 8;
+}
+
+// Mirrors Expr::getArrayCandidateType.
+bugle::Type
+PointerModelInference::getCandidateType(const std::set<Value *> &Arrays) {
+  bugle::Type T(bugle::Type::Any);
+  for (auto i = Arrays.begin(), e = Arrays.end(); i != e; ++i) {
+    if (!*i)
+      continue;
+    bugle::Type RT = TM->getGlobalArrayRangeType(*i);
+    if (T.kind == bugle::Type::Any)
+      T = RT;
+    else if (T != RT)
+      return bugle::Type(bugle::Type::Unknown);
+  }
+  return T;
+}
+
+// The translation of a modelled value V is given by unmodelValue.
+PointerModelInference::PointerInfo
+PointerModelInference::getModelledInfo(Value *V) {
+  auto MI = Models.find(V);
+  if (MI == Models.end())
+    return PointerInfo(PointerInfo::Opaque);
+
+  PointerInfo PI(PointerInfo::Known);
+  PI.Arrays = MI->second;
+  if (MayBeNull.find(V) != MayBeNull.end())
+    PI.Arrays.insert(nullptr);
+  PI.Stride = getRangeBytes(*MI->second.begin());
+  return PI;
+}
+
+const PointerModelInference::PointerInfo &
+PointerModelInference::getInfo(Value *V) {
+  auto II = InfoMap.find(V);
+  if (II != InfoMap.end())
+    return II->second;
+
+  return InfoMap.insert(std::make_pair(V, computeInfo(V))).first->second;
+}
+
+PointerModelInference::PointerInfo
+PointerModelInference::computeInfo(Value *V) {
+  auto PT = dyn_cast<PointerType>(V->getType());
+  if (!PT || PT->getElementType()->isFunctionTy())
+    return PointerInfo(PointerInfo::Unsure);
+
+  if (isa<ConstantPointerNull>(V)) {
+    PointerInfo PI(PointerInfo::Known);
+    PI.Arrays.insert(nullptr);
+    return PI;
+  }
+
+  if (auto GV = dyn_cast<GlobalVariable>(V)) {
+    // The CUDA built-in variables are not translated into arrays.
+    if (TM->SL == TranslateModule::SL_CUDA &&
+        (GV->getName() == "gridDim" || GV->getName() == "blockIdx" ||
+         GV->getName() == "blockDim" || GV->getName() == "threadIdx" ||
+         GV->getName() == "warpSize"))
+      return PointerInfo(PointerInfo::Unsure);
+  }
+
+  if (isa<GlobalVariable>(V) || isa<AllocaInst>(V)) {
+    PointerInfo PI(PointerInfo::Known);
+    PI.Arrays.insert(V);
+    return PI;
+  }
+
+  if (auto A = dyn_cast<Argument>(V)) {
+    if (TM->EntryPoints.contains(A->getParent())) {
+      PointerInfo PI(PointerInfo::Known);
+      PI.Arrays.insert(V);
+      return PI;
+    }
+    return getModelledInfo(V);
+  }
+
+  if (isa<PHINode>(V))
+    return getModelledInfo(V);
+
+  if (auto CI = dyn_cast<CallInst>(V)) {
+    auto F = CI->getCalledFunction();
+    if (!F)
+      return PointerInfo(PointerInfo::Opaque);
+    // Calls to special functions, uninterpreted ones included, are looked up
+    // by the same trimmed name as when they are translated.
+    if (F->isIntrinsic() ||
+        TranslateFunction::isSpecialFunction(
+            TM->SL,
+            TranslateFunction::trimForRequiresFreshArrayFunction(F->getName())))
+      return PointerInfo(PointerInfo::Unsure);
+    return getModelledInfo(F);
+  }
+
+  if (isa<LoadInst>(V) || isa<IntToPtrInst>(V))
+    return PointerInfo(PointerInfo::Opaque);
+
+  switch (Operator::getOpcode(V)) {
+  case Instruction::BitCast:
+  case Instruction::AddrSpaceCast:
+    return getInfo(cast<Operator>(V)->getOperand(0));
+  case Instruction::GetElementPtr:
+    return computeGEPInfo(V);
+  case Instruction::Select:
+    if (auto SI = dyn_cast<SelectInst>(V)) {
+      PointerInfo TI = getInfo(SI->getTrueValue()),
+                  FI = getInfo(SI->getFalseValue());
+      if (TI.K == PointerInfo::Opaque || FI.K == PointerInfo::Opaque)
+        return PointerInfo(PointerInfo::Opaque);
+      if (TI.K != PointerInfo::Known || FI.K != PointerInfo::Known)
+        return PointerInfo(PointerInfo::Unsure);
+
+      // The offset of the translated select is not a sum of terms.
+      PointerInfo PI(PointerInfo::Known);
+      PI.Arrays = TI.Arrays;
+      PI.Arrays.insert(FI.Arrays.begin(), FI.Arrays.end());
+      PI.Stride = 1;
+      return PI;
+    }
+    break;
+  }
+
+  return PointerInfo(PointerInfo::Unsure);
+}
+
+// Mirrors TranslateModule::translateGEP.
+PointerModelInference::PointerInfo
+PointerModelInference::computeGEPInfo(Value *V) {
+  auto GEP = cast<GEPOperator>(V);
+  PointerInfo PI = getInfo(GEP->getPointerOperand());
+  if (PI.K != PointerInfo::Known)
+    return PI;
+
+  unsigned PtrWidth = TM->TD.getPointerSizeInBits();
+  for (auto i = gep_type_begin(GEP), e = gep_type_end(GEP); i != e; ++i) {
+    if (StructType *ST = i.getStructTypeOrNull()) {
+      unsigned Field = cast<ConstantInt>(i.getOperand())->getZExtValue();
+      PI.ConstOffset += TM->TD.getStructLayout(ST)->getElementOffset(Field);
+    } else {
+      uint64_t Size = TM->TD.getTypeAllocSize(i.getIndexedType());
+      if (auto CI = dyn_cast<ConstantInt>(i.getOperand()))
+        PI.ConstOffset +=
+            CI->getValue().zextOrTrunc(PtrWidth).getZExtValue() * Size;
+      else if (i.getOperand()->getType()->isIntegerTy())
+        PI.Stride = GreatestCommonDivisor64(PI.Stride, Size);
+      else
+        return PointerInfo(PointerInfo::Unsure);
+    }
+  }
+
+  return PI;
+}
+
+void PointerModelInference::modelAsByteArray(const PointerInfo &PI) {
+  for (auto i = PI.Arrays.begin(), e = PI.Arrays.end(); i != e; ++i) {
+    if (*i && TM->ModelAsByteArray.insert(*i).second)
+      Changed = true;
+  }
+}
+
+// Mirrors the translation of loads and stores in TranslateFunction.
+void PointerModelInference::checkAccess(Value *Ptr, llvm::Type *AccessTy) {
+  const PointerInfo &PI = getInfo(Ptr);
+  if (PI.K == PointerInfo::Opaque) {
+    CaseSplit = true;
+    return;
+  }
+  if (PI.K != PointerInfo::Known)
+    return;
+
+  bugle::Type ArrRangeTy = getCandidateType(PI.Arrays);
+  bugle::Type Ty = TM->translateType(AccessTy);
+  bugle::Type ElTy = TM->translateArrayRangeType(AccessTy);
+
+  if ((ArrRangeTy == ElTy || ArrRangeTy == bugle::Type(bugle::Type::Any)) &&
+      PI.isDivisibleBy(ElTy.width / 8))
+    return;
+  if (ArrRangeTy.kind == bugle::Type::BV &&
+      Ty.width % ArrRangeTy.width == 0 &&
+      PI.isDivisibleBy(ArrRangeTy.width / 8))
+    return;
+  if (TM->useMixedWidthArrays() && ArrRangeTy.kind == bugle::Type::BV) {
+    // Only the constant offset may fall within an element.
+    PointerInfo Terms(PI);
+    Terms.ConstOffset = 0;
+    if (Terms.isDivisibleBy(ArrRangeTy.width / 8))
+      return;
+  }
+
+  modelAsByteArray(PI);
+}
+
+// Mirrors TranslateModule::computeValueModel.
+void PointerModelInference::computeValueModel(
+    Value *V, const std::vector<PointerInfo> &Infos) {
+  if (Models.find(V) != Models.end() || Infos.empty())
+    return;
+
+  std::set<Value *> Arrays;
+  for (auto i = Infos.begin(), e = Infos.end(); i != e; ++i) {
+    if (i->K != PointerInfo::Known)
+      return;
+    Arrays.insert(i->Arrays.begin(), i->Arrays.end());
+  }
+
+  bugle::Type GlobalsType = getCandidateType(Arrays);
+  bool ModelGlobalsAsByteArray = false;
+  if (GlobalsType.isKind(bugle::Type::Any) ||
+      GlobalsType.isKind(bugle::Type::Unknown)) {
+    ModelGlobalsAsByteArray = true;
+  } else {
+    for (auto i = Infos.begin(), e = Infos.end(); i != e; ++i) {
+      if (!i->isDivisibleBy(GlobalsType.width / 8)) {
+        ModelGlobalsAsByteArray = true;
+        break;
+      }
+    }
+  }
+
+  if (Arrays.erase(nullptr) && MayBeNull.insert(V).second)
+    Changed = true;
+
+  if (Arrays.empty())
+    return;
+
+  auto &GlobalValSet = NextModels[V];
+  GlobalValSet.insert(Arrays.begin(), Arrays.end());
+  Changed = true;
+
+  if (ModelGlobalsAsByteArray) {
+    PointerInfo PI(PointerInfo::Known);
+    PI.Arrays = Arrays;
+    modelAsByteArray(PI);
+  }
+}
+
+// Mirrors TranslateFunction::computeClosure.
+void PointerModelInference::collectPhiInfos(PHINode *PN,
+                                            std::set<PHINode *> &Found,
+                                            std::vector<PointerInfo> &Infos) {
+  for (unsigned i = 0, e = PN->getNumIncomingValues(); i != e; ++i) {
+    Value *Operand = PN->getIncomingValue(i);
+    while (isa<GetElementPtrInst>(Operand))
+      Operand = cast<GetElementPtrInst>(Operand)->getPointerOperand();
+    if (auto OPN = dyn_cast<PHINode>(Operand)) {
+      if (Found.insert(OPN).second)
+        collectPhiInfos(OPN, Found, Infos);
+    } else {
+      Infos.push_back(getInfo(PN->getIncomingValue(i)));
+    }
+  }
+}
+
+void PointerModelInference::analyzeFunction(llvm::Function *F) {
+  std::vector<PointerInfo> ReturnInfos;
+  for (auto BB = F->begin(), BE = F->end(); BB != BE; ++BB) {
+    for (auto I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+      if (auto LI = dyn_cast<LoadInst>(&*I)) {
+        checkAccess(LI->getPointerOperand(), LI->getType());
+      } else if (auto SI = dyn_cast<StoreInst>(&*I)) {
+        checkAccess(SI->getPointerOperand(),
+                    SI->getValueOperand()->getType());
+      } else if (auto PN = dyn_cast<PHINode>(&*I)) {
+        auto PT = dyn_cast<PointerType>(PN->getType());
+        if (!PT || PT->getElementType()->isFunctionTy())
+          continue;
+        std::set<PHINode *> Found;
+        Found.insert(PN);
+        std::vector<PointerInfo> Infos;
+        collectPhiInfos(PN, Found, Infos);
+        computeValueModel(PN, Infos);
+      } else if (auto RI = dyn_cast<ReturnInst>(&*I)) {
+        if (auto V = RI->getReturnValue())
+          ReturnInfos.push_back(getInfo(V));
+      }
+    }
+  }
+
+  auto RT = dyn_cast<PointerType>(F->getReturnType());
+  if (!F->empty() && RT && !RT->getElementType()->isFunctionTy())
+    computeValueModel(F, ReturnInfos);
+}
+
+// Mirrors the modelling of parameters from the call sites of a function,
+// which the translation performs after a case split. Functions that may be
+// called indirectly are left to the translation.
+void PointerModelInference::analyzeCallSites(llvm::Function *F) {
+  if (F->hasAddressTaken() || TM->EntryPoints.contains(F))
+    return;
+
+  std::vector<CallInst *> Calls;
+  for (auto U : F->users()) {
+    auto CI = dyn_cast<CallInst>(U);
+    if (CI && CI->getCalledFunction() == F &&
+        isTranslated(CI->getParent()->getParent()))
+      Calls.push_back(CI);
+  }
+  if (Calls.empty())
+    return;
+
+  unsigned Idx = 0;
+  for (auto A = F->arg_begin(), AE = F->arg_end(); A != AE; ++A, ++Idx) {
+    auto PT = dyn_cast<PointerType>(A->getType());
+    if (!PT || PT->getElementType()->isFunctionTy())
+      continue;
+    std::vector<PointerInfo> Infos;
+    for (auto CI : Calls)
+      Infos.push_back(getInfo(CI->getArgOperand(Idx)));
+    computeValueModel(&*A, Infos);
+  }
+}
+
+void PointerModelInference::infer() {
+  // Each iteration corresponds to a round of the fixed point computation in
+  // TranslateModule::translate.
+  do {
+    Changed = CaseSplit = false;
+    InfoMap.clear();
+    NextModels = Models;
+
+    for (auto F = TM->M->begin(), FE = TM->M->end(); F != FE; ++F) {
+      if (isTranslated(&*F))
+        analyzeFunction(&*F);
+    }
+
+    if (CaseSplit) {
+      for (auto F = TM->M->begin(), FE = TM->M->end(); F != FE; ++F) {
+        if (isTranslated(&*F) &&
+            !TranslateFunction::isAxiomFunction(F->getName()))
+          analyzeCallSites(&*F);
+      }
+    }
+
+    Models = NextModels;
+  } while (Changed);
+
+  TM->ModelPtrAsGlobalOffset = TM->NextModelPtrAsGlobalOffset = Models;
+  TM->PtrMayBeNull = TM->NextPtrMayBeNull = MayBeNull;
+
+  if (Statistics::isEnabled())
+    Statistics::add("inferred-models", Models.size());
+}
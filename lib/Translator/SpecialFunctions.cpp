@@ -0,0 +1,393 @@
+#include "bugle/Translator/SpecialFunctions.h"
+#include "bugle/Expr.h"
+#include "llvm/IR/Intrinsics.h"
+#include <cstdint>
+#include <tuple>
+
+using namespace llvm;
+using namespace bugle;
+
+namespace {
+
+// The source languages in which a special function exists.
+enum {
+  SFL_C = 1 << TranslateModule::SL_C,
+  SFL_CUDA = 1 << TranslateModule::SL_CUDA,
+  SFL_OpenCL = 1 << TranslateModule::SL_OpenCL,
+  SFL_GPU = SFL_CUDA | SFL_OpenCL,
+  SFL_All = SFL_C | SFL_GPU
+};
+}
+
+// The FNV-1a hash of a name. The names of the table below are hashed at
+// compile time, and as they are case labels the compiler rejects any two
+// names with the same hash, which makes the hash perfect for the table.
+static constexpr uint64_t hashLiteral(const char *S,
+                                      uint64_t H = 14695981039346656037ULL) {
+  return *S ? hashLiteral(S + 1, (H ^ (unsigned char)*S) * 1099511628211ULL)
+            : H;
+}
+
+static uint64_t hashName(StringRef Name) {
+  uint64_t H = 14695981039346656037ULL;
+  for (char C : Name)
+    H = (H ^ (unsigned char)C) * 1099511628211ULL;
+  return H;
+}
+
+// Look up the functions that are special under a single name.
+static SpecialFunctionKind lookupName(StringRef Name, unsigned &Languages) {
+  switch (hashName(Name)) {
+#define SPECIAL_FUNCTION(NAME, KIND, LANGUAGES)                                \
+  case hashLiteral(NAME):                                                      \
+    if (Name != NAME)                                                          \
+      return SF_None;                                                          \
+    Languages = LANGUAGES;                                                     \
+    return KIND;
+
+  SPECIAL_FUNCTION("bugle_assert", SF_Assert, SFL_All)
+  SPECIAL_FUNCTION("__assert", SF_Assert, SFL_All)
+  SPECIAL_FUNCTION("__global_assert", SF_GlobalAssert, SFL_All)
+  SPECIAL_FUNCTION("__candidate_assert", SF_CandidateAssert, SFL_All)
+  SPECIAL_FUNCTION("__candidate_global_assert", SF_CandidateGlobalAssert,
+                   SFL_All)
+  SPECIAL_FUNCTION("__invariant", SF_Invariant, SFL_All)
+  SPECIAL_FUNCTION("__global_invariant", SF_GlobalInvariant, SFL_All)
+  SPECIAL_FUNCTION("__candidate_invariant", SF_CandidateInvariant, SFL_All)
+  SPECIAL_FUNCTION("__candidate_global_invariant",
+                   SF_CandidateGlobalInvariant, SFL_All)
+  SPECIAL_FUNCTION("__non_temporal_loads_begin", SF_NonTemporalLoadsBegin,
+                   SFL_All)
+  SPECIAL_FUNCTION("__non_temporal_loads_end", SF_NonTemporalLoadsEnd,
+                   SFL_All)
+  SPECIAL_FUNCTION("bugle_assume", SF_Assume, SFL_All)
+  SPECIAL_FUNCTION("__assert_fail", SF_AssertFail, SFL_All)
+  SPECIAL_FUNCTION("bugle_requires", SF_Requires, SFL_All)
+  SPECIAL_FUNCTION("__requires", SF_Requires, SFL_All)
+  SPECIAL_FUNCTION("__global_requires", SF_GlobalRequires, SFL_All)
+  SPECIAL_FUNCTION("__requires_fresh_array", SF_RequiresFreshArray, SFL_All)
+  SPECIAL_FUNCTION("bugle_ensures", SF_Ensures, SFL_All)
+  SPECIAL_FUNCTION("__ensures", SF_Ensures, SFL_All)
+  SPECIAL_FUNCTION("__global_ensures", SF_GlobalEnsures, SFL_All)
+  SPECIAL_FUNCTION("__function_wide_invariant", SF_FunctionWideInvariant,
+                   SFL_All)
+  SPECIAL_FUNCTION("__function_wide_candidate_invariant",
+                   SF_FunctionWideCandidateInvariant, SFL_All)
+  SPECIAL_FUNCTION("__reads_from", SF_ReadsFrom, SFL_All)
+  SPECIAL_FUNCTION("__reads_from_local", SF_ReadsFrom, SFL_All)
+  SPECIAL_FUNCTION("__reads_from_global", SF_ReadsFrom, SFL_All)
+  SPECIAL_FUNCTION("__writes_to", SF_WritesTo, SFL_All)
+  SPECIAL_FUNCTION("__writes_to_local", SF_WritesTo, SFL_All)
+  SPECIAL_FUNCTION("__writes_to_global", SF_WritesTo, SFL_All)
+  SPECIAL_FUNCTION("bugle_frexp_exp", SF_FrexpExp, SFL_All)
+  SPECIAL_FUNCTION("bugle_frexp_frac", SF_FrexpFrac, SFL_All)
+  SPECIAL_FUNCTION("__add_noovfl_char", SF_AddNoovflSigned, SFL_All)
+  SPECIAL_FUNCTION("__add_noovfl_short", SF_AddNoovflSigned, SFL_All)
+  SPECIAL_FUNCTION("__add_noovfl_int", SF_AddNoovflSigned, SFL_All)
+  SPECIAL_FUNCTION("__add_noovfl_long", SF_AddNoovflSigned, SFL_All)
+  SPECIAL_FUNCTION("__add_noovfl_unsigned_char", SF_AddNoovflUnsigned,
+                   SFL_All)
+  SPECIAL_FUNCTION("__add_noovfl_unsigned_short", SF_AddNoovflUnsigned,
+                   SFL_All)
+  SPECIAL_FUNCTION("__add_noovfl_unsigned_int", SF_AddNoovflUnsigned, SFL_All)
+  SPECIAL_FUNCTION("__add_noovfl_unsigned_long", SF_AddNoovflUnsigned,
+                   SFL_All)
+  SPECIAL_FUNCTION("__atomic_has_taken_value_local", SF_AtomicHasTakenValue,
+                   SFL_All)
+  SPECIAL_FUNCTION("__atomic_has_taken_value_global", SF_AtomicHasTakenValue,
+                   SFL_All)
+  SPECIAL_FUNCTION("__atomic_has_taken_value", SF_AtomicHasTakenValue,
+                   SFL_All)
+  SPECIAL_FUNCTION("__add_char", SF_Add, SFL_All)
+  SPECIAL_FUNCTION("__add_short", SF_Add, SFL_All)
+  SPECIAL_FUNCTION("__add_int", SF_Add, SFL_All)
+  SPECIAL_FUNCTION("__add_long", SF_Add, SFL_All)
+  SPECIAL_FUNCTION("__add_unsigned_char", SF_Add, SFL_All)
+  SPECIAL_FUNCTION("__add_unsigned_short", SF_Add, SFL_All)
+  SPECIAL_FUNCTION("__add_unsigned_int", SF_Add, SFL_All)
+  SPECIAL_FUNCTION("__add_unsigned_long", SF_Add, SFL_All)
+  SPECIAL_FUNCTION("__ite_char", SF_Ite, SFL_All)
+  SPECIAL_FUNCTION("__ite_short", SF_Ite, SFL_All)
+  SPECIAL_FUNCTION("__ite_int", SF_Ite, SFL_All)
+  SPECIAL_FUNCTION("__ite_long", SF_Ite, SFL_All)
+  SPECIAL_FUNCTION("__ite_unsigned_char", SF_Ite, SFL_All)
+  SPECIAL_FUNCTION("__ite_unsigned_short", SF_Ite, SFL_All)
+  SPECIAL_FUNCTION("__ite_unsigned_int", SF_Ite, SFL_All)
+  SPECIAL_FUNCTION("__ite_unsigned_long", SF_Ite, SFL_All)
+  SPECIAL_FUNCTION("__ite_size_t", SF_Ite, SFL_All)
+  SPECIAL_FUNCTION("__return_val_int", SF_ReturnVal, SFL_All)
+  SPECIAL_FUNCTION("__return_val_int4", SF_ReturnVal, SFL_All)
+  SPECIAL_FUNCTION("__return_val_bool", SF_ReturnVal, SFL_All)
+  SPECIAL_FUNCTION("__return_val_ptr", SF_ReturnVal, SFL_All)
+  SPECIAL_FUNCTION("__return_val_funptr", SF_ReturnVal, SFL_All)
+  SPECIAL_FUNCTION("__old_int", SF_Old, SFL_All)
+  SPECIAL_FUNCTION("__old_bool", SF_Old, SFL_All)
+  SPECIAL_FUNCTION("__other_int", SF_OtherInt, SFL_All)
+  SPECIAL_FUNCTION("__other_bool", SF_OtherBool, SFL_All)
+  SPECIAL_FUNCTION("__other_ptr_base", SF_OtherPtrBase, SFL_All)
+  SPECIAL_FUNCTION("__implies", SF_Implies, SFL_All)
+  SPECIAL_FUNCTION("__enabled", SF_Enabled, SFL_All)
+  SPECIAL_FUNCTION("__dominator_enabled", SF_DominatorEnabled, SFL_All)
+  SPECIAL_FUNCTION("__read_local", SF_ReadHasOccurred, SFL_All)
+  SPECIAL_FUNCTION("__read_global", SF_ReadHasOccurred, SFL_All)
+  SPECIAL_FUNCTION("__read", SF_ReadHasOccurred, SFL_All)
+  SPECIAL_FUNCTION("__write_local", SF_WriteHasOccurred, SFL_All)
+  SPECIAL_FUNCTION("__write_global", SF_WriteHasOccurred, SFL_All)
+  SPECIAL_FUNCTION("__write", SF_WriteHasOccurred, SFL_All)
+  SPECIAL_FUNCTION("__read_offset_bytes_local", SF_ReadOffset, SFL_All)
+  SPECIAL_FUNCTION("__read_offset_bytes_global", SF_ReadOffset, SFL_All)
+  SPECIAL_FUNCTION("__read_offset_bytes", SF_ReadOffset, SFL_All)
+  SPECIAL_FUNCTION("__write_offset_bytes_local", SF_WriteOffset, SFL_All)
+  SPECIAL_FUNCTION("__write_offset_bytes_global", SF_WriteOffset, SFL_All)
+  SPECIAL_FUNCTION("__write_offset_bytes", SF_WriteOffset, SFL_All)
+  SPECIAL_FUNCTION("__ptr_base_local", SF_PtrBase, SFL_All)
+  SPECIAL_FUNCTION("__ptr_base_global", SF_PtrBase, SFL_All)
+  SPECIAL_FUNCTION("__ptr_base", SF_PtrBase, SFL_All)
+  SPECIAL_FUNCTION("__ptr_offset_bytes_local", SF_PtrOffset, SFL_All)
+  SPECIAL_FUNCTION("__ptr_offset_bytes_global", SF_PtrOffset, SFL_All)
+  SPECIAL_FUNCTION("__ptr_offset_bytes", SF_PtrOffset, SFL_All)
+  SPECIAL_FUNCTION("__array_snapshot_local", SF_ArraySnapshot, SFL_All)
+  SPECIAL_FUNCTION("__array_snapshot_global", SF_ArraySnapshot, SFL_All)
+  SPECIAL_FUNCTION("__array_snapshot", SF_ArraySnapshot, SFL_All)
+
+  SPECIAL_FUNCTION("bugle_barrier", SF_Barrier, SFL_GPU)
+
+  SPECIAL_FUNCTION("get_local_id", SF_GetLocalId, SFL_OpenCL)
+  SPECIAL_FUNCTION("get_group_id", SF_GetGroupId, SFL_OpenCL)
+  SPECIAL_FUNCTION("get_local_size", SF_GetLocalSize, SFL_OpenCL)
+  SPECIAL_FUNCTION("get_num_groups", SF_GetNumGroups, SFL_OpenCL)
+  SPECIAL_FUNCTION("get_global_offset", SF_GetGlobalOffset, SFL_OpenCL)
+  SPECIAL_FUNCTION("get_work_dim", SF_GetWorkDim, SFL_OpenCL)
+  SPECIAL_FUNCTION("get_image_width", SF_GetImageWidth, SFL_OpenCL)
+  SPECIAL_FUNCTION("get_image_height", SF_GetImageHeight, SFL_OpenCL)
+  SPECIAL_FUNCTION("__translate_sampler_initializer", SF_SamplerInitializer,
+                   SFL_OpenCL)
+  SPECIAL_FUNCTION("__bugle_wait_group_events", SF_WaitGroupEvents,
+                   SFL_OpenCL)
+
+  SPECIAL_FUNCTION("cos", SF_Cos, SFL_CUDA)
+  SPECIAL_FUNCTION("sin", SF_Sin, SFL_CUDA)
+  SPECIAL_FUNCTION("sqrt", SF_Sqrt, SFL_CUDA)
+  SPECIAL_FUNCTION("sqrtf", SF_Sqrt, SFL_CUDA)
+  SPECIAL_FUNCTION("rsqrt", SF_Rsqrt, SFL_CUDA)
+  SPECIAL_FUNCTION("log2", SF_Log2, SFL_CUDA)
+  SPECIAL_FUNCTION("exp2", SF_Exp, SFL_CUDA)
+  SPECIAL_FUNCTION("__clz", SF_Ctlz, SFL_CUDA)
+
+#undef SPECIAL_FUNCTION
+  default:
+    return SF_None;
+  }
+}
+
+// Decode a decimal number without leading zeros that is at most Max.
+static bool decodeNumber(StringRef S, unsigned Max) {
+  unsigned N;
+  if (S.empty() || (S.size() > 1 && S[0] == '0') || S.getAsInteger(10, N))
+    return false;
+  return N <= Max;
+}
+
+// The highest arity of the __add_noovfl_unsigned_<type>_<arity> predicates
+// and of the barrier invariants.
+static const unsigned NOOVFL_PREDICATE_MAX_ARITY = 20;
+static const unsigned BARRIER_INVARIANT_MAX_ARITY = 20;
+
+// __add_noovfl_unsigned_<type>_<arity>, for the integer types of C.
+static bool decodeAddNoovflPredicate(StringRef Name) {
+  if (!Name.consume_front("__add_noovfl_unsigned_"))
+    return false;
+  StringRef Ty, Arity;
+  std::tie(Ty, Arity) = Name.split('_');
+  return (Ty == "char" || Ty == "short" || Ty == "int" || Ty == "long") &&
+         decodeNumber(Arity, NOOVFL_PREDICATE_MAX_ARITY);
+}
+
+// __bugle_atomic_<operation>_<address space>_<type>, the OpenCL atomics.
+static bool decodeOpenCLAtomic(StringRef Name) {
+  if (!Name.consume_front("__bugle_atomic_"))
+    return false;
+  StringRef Op, Space, Ty;
+  std::tie(Op, Name) = Name.split('_');
+  std::tie(Space, Ty) = Name.split('_');
+  if (Space != "local" && Space != "global")
+    return false;
+  if (Op != "add" && Op != "sub" && Op != "xchg" && Op != "min" &&
+      Op != "max" && Op != "and" && Op != "or" && Op != "xor" &&
+      Op != "cmpxchg" && Op != "inc" && Op != "dec")
+    return false;
+  return Ty == "int" || Ty == "uint" || Ty == "long" ||
+         Ty == "unsigned_long" || (Op == "xchg" && Ty == "float");
+}
+
+// __atomic<Operation>_<type>, the CUDA atomics.
+static bool decodeCUDAAtomic(StringRef Name) {
+  if (!Name.consume_front("__atomic"))
+    return false;
+  enum { Int = 1, UInt = 2, ULongLong = 4, Float = 8 };
+  static const struct {
+    const char *Op;
+    unsigned Types;
+  } Atomics[] = {{"Add", Int | UInt | ULongLong | Float},
+                 {"Sub", Int | UInt},
+                 {"Exch", Int | UInt | ULongLong | Float},
+                 {"Min", Int | UInt | ULongLong},
+                 {"Max", Int | UInt | ULongLong},
+                 {"And", Int | UInt | ULongLong},
+                 {"Or", Int | UInt | ULongLong},
+                 {"Xor", Int | UInt | ULongLong},
+                 {"Inc", UInt},
+                 {"Dec", UInt},
+                 {"CAS", Int | UInt | ULongLong}};
+
+  StringRef Op, Ty;
+  std::tie(Op, Ty) = Name.split('_');
+  unsigned T = Ty == "int" ? Int
+             : Ty == "unsigned_int" ? UInt
+             : Ty == "unsigned_long_long_int" ? ULongLong
+             : Ty == "float" ? Float : 0;
+  for (const auto &A : Atomics) {
+    if (Op == A.Op)
+      return (A.Types & T) != 0;
+  }
+  return false;
+}
+
+// __bugle_async_work_group_copy_<direction>_<type><width>, where the width of
+// a scalar copy is omitted.
+static bool decodeAsyncWorkGroupCopy(StringRef Name) {
+  if (!Name.consume_front("__bugle_async_work_group_copy_"))
+    return false;
+  if (!Name.consume_front("global_to_local_") &&
+      !Name.consume_front("local_to_global_"))
+    return false;
+  size_t WidthPos = Name.find_first_of("0123456789");
+  StringRef Ty = Name.substr(0, WidthPos), Width = Name.substr(WidthPos);
+  if (!Width.empty() && Width != "2" && Width != "4" && Width != "8" &&
+      Width != "16")
+    return false;
+  return Ty == "char" || Ty == "uchar" || Ty == "short" || Ty == "ushort" ||
+         Ty == "int" || Ty == "uint" || Ty == "long" || Ty == "ulong" ||
+         Ty == "float" || Ty == "double";
+}
+
+// Look up a name first among the single names, and then among the families
+// of names that share a kind.
+static SpecialFunctionKind lookup(StringRef Name, unsigned &Languages) {
+  SpecialFunctionKind K = lookupName(Name, Languages);
+  if (K != SF_None)
+    return K;
+
+  Languages = SFL_All;
+  if (Name.startswith("__uninterpreted_function_"))
+    return SF_UninterpretedFunction;
+  if (Name.startswith("__axiom"))
+    return SF_Axiom;
+  if (Name.startswith("__spec"))
+    return SF_Specification;
+  if (decodeAddNoovflPredicate(Name))
+    return SF_AddNoovflPredicate;
+
+  Languages = SFL_GPU;
+  StringRef Arity = Name;
+  if (Arity.consume_front("__barrier_invariant_binary_"))
+    return decodeNumber(Arity, BARRIER_INVARIANT_MAX_ARITY)
+               ? SF_BarrierInvariantBinary
+               : SF_None;
+  if (Arity.consume_front("__barrier_invariant_"))
+    return decodeNumber(Arity, BARRIER_INVARIANT_MAX_ARITY)
+               ? SF_BarrierInvariant
+               : SF_None;
+
+  Languages = SFL_OpenCL;
+  if (decodeOpenCLAtomic(Name))
+    return SF_Atomic;
+  if (decodeAsyncWorkGroupCopy(Name))
+    return SF_AsyncWorkGroupCopy;
+
+  Languages = SFL_CUDA;
+  if (decodeCUDAAtomic(Name))
+    return SF_Atomic;
+
+  return SF_None;
+}
+
+SpecialFunctionKind
+bugle::lookupSpecialFunction(TranslateModule::SourceLanguage SL,
+                             StringRef Name) {
+  unsigned Languages;
+  SpecialFunctionKind K = lookup(Name, Languages);
+  return (Languages & (1 << SL)) ? K : SF_None;
+}
+
+SpecialFunctionKind bugle::lookupSpecialFunction(StringRef Name) {
+  unsigned Languages;
+  return lookup(Name, Languages);
+}
+
+SpecialFunctionKind bugle::lookupSpecialIntrinsic(unsigned ID) {
+  switch (ID) {
+  case Intrinsic::ceil:
+    return SF_Ceil;
+  case Intrinsic::ctpop:
+    return SF_Ctpop;
+  case Intrinsic::cos:
+    return SF_Cos;
+  case Intrinsic::ctlz:
+    return SF_Ctlz;
+  case Intrinsic::exp:
+    return SF_Exp;
+  case Intrinsic::exp2:
+    return SF_Exp2;
+  case Intrinsic::fabs:
+    return SF_Fabs;
+  case Intrinsic::fma:
+  case Intrinsic::fmuladd:
+    return SF_Fma;
+  case Intrinsic::floor:
+    return SF_Floor;
+  case Intrinsic::log:
+    return SF_Log;
+  case Intrinsic::log10:
+    return SF_Log10;
+  case Intrinsic::log2:
+    return SF_Log2;
+  case Intrinsic::maxnum:
+    return SF_Fmax;
+  case Intrinsic::minnum:
+    return SF_Fmin;
+  case Intrinsic::pow:
+    return SF_Pow;
+  case Intrinsic::powi:
+    return SF_Powi;
+  case Intrinsic::rint:
+    return SF_Rint;
+  case Intrinsic::sin:
+    return SF_Sin;
+  case Intrinsic::sqrt:
+    return SF_Sqrt;
+  case Intrinsic::trunc:
+    return SF_Trunc;
+  case Intrinsic::uadd_with_overflow:
+    return SF_UaddOvl;
+  case Intrinsic::sadd_with_overflow:
+    return SF_SaddOvl;
+  case Intrinsic::usub_with_overflow:
+    return SF_UsubOvl;
+  case Intrinsic::ssub_with_overflow:
+    return SF_SsubOvl;
+  case Intrinsic::dbg_value:
+  case Intrinsic::dbg_declare:
+  case Intrinsic::lifetime_start:
+  case Intrinsic::lifetime_end:
+    return SF_Noop;
+  case Intrinsic::memset:
+    return SF_Memset;
+  case Intrinsic::memcpy:
+    return SF_Memcpy;
+  case Intrinsic::trap:
+    return SF_Trap;
+  default:
+    return SF_None;
+  }
+}
@@ -1,4 +1,5 @@
 #include "bugle/Translator/TranslateFunction.h"
+#include "bugle/Translator/DebugInfoIndex.h"
 #include "bugle/Translator/TranslateModule.h"
 #include "bugle/BPLFunctionWriter.h"
 #include "bugle/BPLModuleWriter.h"
@@ -9,6 +10,7 @@
 #include "bugle/RaceInstrumenter.h"
 #include "bugle/util/ErrorReporter.h"
 #include "bugle/util/Functional.h"
+#include "bugle/util/TimeTrace.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/CFG.h"
@@ -28,9 +30,6 @@ using namespace llvm;
 
 typedef std::vector<ref<Expr>> ExprVec;
 
-TranslateFunction::SpecialFnMapTy
-    TranslateFunction::SpecialFunctionMaps[TranslateModule::SL_Count];
-
 // Appends at least the given basic block to the given list BBList (if not
 // already present), so as to maintain the invariants that:
 //  1) Each element of BBList is also a member of BBSet and vice versa;
@@ -59,70 +58,88 @@ static void AddBasicBlockInOrder(std::set<llvm::BasicBlock *> &BBSet,
   BBList.push_back(BB);
 }
 
-bool TranslateFunction::isSpecialFunction(TranslateModule::SourceLanguage SL,
-                                          const std::string &fnName) {
-  SpecialFnMapTy &SpecialFunctionMap = initSpecialFunctionMap(SL);
-  return SpecialFunctionMap.Functions.find(fnName) !=
-         SpecialFunctionMap.Functions.end();
+// Split the byte offset Ofs into the index of an element of an array whose
+// elements are ElemBytes wide and the constant offset ByteOfs into that
+// element. Returns null if the offset has a term that is not a multiple of
+// ElemBytes, or more than one constant term that is not.
+static ref<Expr> splitArrayOffset(ref<Expr> Ofs, uint64_t ElemBytes,
+                                  uint64_t &ByteOfs) {
+  ref<Expr> Div = Expr::createExactBVSDiv(Ofs, ElemBytes);
+  if (!Div.isNull()) {
+    ByteOfs = 0;
+    return Div;
+  }
+
+  if (auto CE = dyn_cast<BVConstExpr>(Ofs)) {
+    int64_t Val = CE->getValue().getSExtValue(), Bytes = ElemBytes;
+    int64_t Index = Val / Bytes - (Val % Bytes < 0 ? 1 : 0);
+    ByteOfs = Val - Index * Bytes;
+    return BVConstExpr::create(CE->getType().width, (uint64_t)Index);
+  } else if (auto AE = dyn_cast<BVAddExpr>(Ofs)) {
+    ref<Expr> LHSDiv = Expr::createExactBVSDiv(AE->getLHS(), ElemBytes);
+    if (!LHSDiv.isNull()) {
+      ref<Expr> RHSIndex = splitArrayOffset(AE->getRHS(), ElemBytes, ByteOfs);
+      if (!RHSIndex.isNull())
+        return BVAddExpr::create(LHSDiv, RHSIndex);
+    }
+    ref<Expr> RHSDiv = Expr::createExactBVSDiv(AE->getRHS(), ElemBytes);
+    if (!RHSDiv.isNull()) {
+      ref<Expr> LHSIndex = splitArrayOffset(AE->getLHS(), ElemBytes, ByteOfs);
+      if (!LHSIndex.isNull())
+        return BVAddExpr::create(LHSIndex, RHSDiv);
+    }
+  }
+
+  return ref<Expr>();
 }
 
-void
-TranslateFunction::addUninterpretedFunction(TranslateModule::SourceLanguage SL,
-                                            const std::string &fnName) {
-  SpecialFnMapTy &SpecialFunctionMap = initSpecialFunctionMap(SL);
-  SpecialFunctionMap.Functions[fnName] =
-      &TranslateFunction::handleUninterpretedFunction;
+bool TranslateFunction::isSpecialFunction(TranslateModule::SourceLanguage SL,
+                                          const std::string &fnName) {
+  switch (lookupSpecialFunction(SL, fnName)) {
+  case SF_None:
+  case SF_Axiom:
+  case SF_Specification:
+  case SF_Barrier:
+    return false;
+  default:
+    return true;
+  }
 }
 
 bool TranslateFunction::isAxiomFunction(StringRef fnName) {
-  return fnName.startswith("__axiom");
+  return lookupSpecialFunction(fnName) == SF_Axiom;
 }
 
 bool TranslateFunction::isUninterpretedFunction(StringRef fnName) {
-  return fnName.startswith("__uninterpreted_function_");
+  return lookupSpecialFunction(fnName) == SF_UninterpretedFunction;
 }
 
 bool TranslateFunction::isSpecificationFunction(StringRef fnName) {
-  return fnName.startswith("__spec");
+  return lookupSpecialFunction(fnName) == SF_Specification;
 }
 
 bool TranslateFunction::isPreOrPostCondition(StringRef fnName) {
-  if (fnName == "bugle_requires")
-    return true;
-  if (fnName == "__requires")
-    return true;
-  if (fnName == "__global_requires")
-    return true;
-  if (fnName == "bugle_ensures")
+  switch (lookupSpecialFunction(fnName)) {
+  case SF_Requires:
+  case SF_GlobalRequires:
+  case SF_Ensures:
+  case SF_GlobalEnsures:
     return true;
-  if (fnName == "__ensures")
-    return true;
-  if (fnName == "__global_ensures")
-    return true;
-  return false;
+  default:
+    return false;
+  }
 }
 
 bool TranslateFunction::isBarrierFunction(TranslateModule::SourceLanguage SL,
                                           StringRef fnName) {
-  return (SL == TranslateModule::SL_OpenCL || SL == TranslateModule::SL_CUDA) &&
-         fnName == "bugle_barrier";
+  return lookupSpecialFunction(SL, fnName) == SF_Barrier;
 }
 
 bool TranslateFunction::isNormalFunction(TranslateModule::SourceLanguage SL,
                                          llvm::Function *F) {
   if (F->isIntrinsic())
     return false;
-  if (isAxiomFunction(F->getName()))
-    return false;
-  if (isUninterpretedFunction(F->getName()))
-    return false;
-  if (isSpecialFunction(SL, F->getName()))
-    return false;
-  if (isSpecificationFunction(F->getName()))
-    return false;
-  if (isBarrierFunction(SL, F->getName()))
-    return false;
-  return true;
+  return lookupSpecialFunction(SL, F->getName()) == SF_None;
 }
 
 bool TranslateFunction::isStandardEntryPoint(TranslateModule::SourceLanguage SL,
@@ -131,7 +148,7 @@ bool TranslateFunction::isStandardEntryPoint(TranslateModule::SourceLanguage SL,
 }
 
 bool TranslateFunction::isRequiresFreshArrayFunction(llvm::StringRef fnName) {
-  return fnName == "__requires_fresh_array";
+  return lookupSpecialFunction(fnName) == SF_RequiresFreshArray;
 }
 
 llvm::StringRef
@@ -140,331 +157,201 @@ TranslateFunction::trimForRequiresFreshArrayFunction(llvm::StringRef fnName) {
                                                       : fnName;
 }
 
-TranslateFunction::SpecialFnMapTy &
-TranslateFunction::initSpecialFunctionMap(TranslateModule::SourceLanguage SL) {
-  SpecialFnMapTy &SpecialFunctionMap = SpecialFunctionMaps[SL];
-  if (SpecialFunctionMap.Functions.empty()) {
-    auto &fns = SpecialFunctionMap.Functions;
-    fns["bugle_assert"] = &TranslateFunction::handleAssert;
-    fns["__assert"] = &TranslateFunction::handleAssert;
-    fns["__global_assert"] = &TranslateFunction::handleGlobalAssert;
-    fns["__candidate_assert"] = &TranslateFunction::handleCandidateAssert;
-    fns["__candidate_global_assert"] = &TranslateFunction::handleCandidateGlobalAssert;
-    fns["__invariant"] = &TranslateFunction::handleInvariant;
-    fns["__global_invariant"] = &TranslateFunction::handleGlobalInvariant;
-    fns["__candidate_invariant"] = &TranslateFunction::handleCandidateInvariant;
-    fns["__candidate_global_invariant"] = &TranslateFunction::handleCandidateGlobalInvariant;
-    fns["__non_temporal_loads_begin"] = &TranslateFunction::handleNonTemporalLoadsBegin;
-    fns["__non_temporal_loads_end"] = &TranslateFunction::handleNonTemporalLoadsEnd;
-    fns["bugle_assume"] = &TranslateFunction::handleAssume;
-    fns["__assert_fail"] = &TranslateFunction::handleAssertFail;
-    fns["bugle_requires"] = &TranslateFunction::handleRequires;
-    fns["__requires"] = &TranslateFunction::handleRequires;
-    fns["__global_requires"] = &TranslateFunction::handleGlobalRequires;
-    fns["__requires_fresh_array"] = &TranslateFunction::handleRequiresFreshArray;
-    fns["bugle_ensures"] = &TranslateFunction::handleEnsures;
-    fns["__ensures"] = &TranslateFunction::handleEnsures;
-    fns["__global_ensures"] = &TranslateFunction::handleGlobalEnsures;
-    fns["__function_wide_invariant"] = &TranslateFunction::handleFunctionWideInvariant;
-    fns["__function_wide_candidate_invariant"] = &TranslateFunction::handleFunctionWideCandidateInvariant;
-    fns["__reads_from"] = &TranslateFunction::handleReadsFrom;
-    fns["__reads_from_local"] = &TranslateFunction::handleReadsFrom;
-    fns["__reads_from_global"] = &TranslateFunction::handleReadsFrom;
-    fns["__writes_to"] = &TranslateFunction::handleWritesTo;
-    fns["__writes_to_local"] = &TranslateFunction::handleWritesTo;
-    fns["__writes_to_global"] = &TranslateFunction::handleWritesTo;
-    fns["bugle_frexp_exp"] = &TranslateFunction::handleFrexpExp;
-    fns["bugle_frexp_frac"] = &TranslateFunction::handleFrexpFrac;
-    fns["__add_noovfl_char"] = &TranslateFunction::handleAddNoovflSigned;
-    fns["__add_noovfl_short"] = &TranslateFunction::handleAddNoovflSigned;
-    fns["__add_noovfl_int"] = &TranslateFunction::handleAddNoovflSigned;
-    fns["__add_noovfl_long"] = &TranslateFunction::handleAddNoovflSigned;
-    fns["__add_noovfl_unsigned_char"] = &TranslateFunction::handleAddNoovflUnsigned;
-    fns["__add_noovfl_unsigned_short"] = &TranslateFunction::handleAddNoovflUnsigned;
-    fns["__add_noovfl_unsigned_int"] = &TranslateFunction::handleAddNoovflUnsigned;
-    fns["__add_noovfl_unsigned_long"] = &TranslateFunction::handleAddNoovflUnsigned;
-    fns["__atomic_has_taken_value_local"] = &TranslateFunction::handleAtomicHasTakenValue;
-    fns["__atomic_has_taken_value_global"] = &TranslateFunction::handleAtomicHasTakenValue;
-    fns["__atomic_has_taken_value"] = &TranslateFunction::handleAtomicHasTakenValue;
-    const unsigned NOOVFL_PREDICATE_MAX_ARITY = 20;
-    const std::string tys[] = {"char", "short", "int", "long"};
-    for (unsigned j = 0; j < 4; ++j) {
-      std::string t = tys[j];
-      for (unsigned i = 0; i <= NOOVFL_PREDICATE_MAX_ARITY; ++i) {
-        std::string S = "__add_noovfl_unsigned_";
-        llvm::raw_string_ostream SS(S);
-        SS << t << "_" << i;
-        fns[SS.str()] = &TranslateFunction::handleAddNoovflPredicate;
-      }
-    }
-    fns["__add_char"] = &TranslateFunction::handleAdd;
-    fns["__add_short"] = &TranslateFunction::handleAdd;
-    fns["__add_int"] = &TranslateFunction::handleAdd;
-    fns["__add_long"] = &TranslateFunction::handleAdd;
-    fns["__add_unsigned_char"] = &TranslateFunction::handleAdd;
-    fns["__add_unsigned_short"] = &TranslateFunction::handleAdd;
-    fns["__add_unsigned_int"] = &TranslateFunction::handleAdd;
-    fns["__add_unsigned_long"] = &TranslateFunction::handleAdd;
-    fns["__ite_char"] = &TranslateFunction::handleIte;
-    fns["__ite_short"] = &TranslateFunction::handleIte;
-    fns["__ite_int"] = &TranslateFunction::handleIte;
-    fns["__ite_long"] = &TranslateFunction::handleIte;
-    fns["__ite_unsigned_char"] = &TranslateFunction::handleIte;
-    fns["__ite_unsigned_short"] = &TranslateFunction::handleIte;
-    fns["__ite_unsigned_int"] = &TranslateFunction::handleIte;
-    fns["__ite_unsigned_long"] = &TranslateFunction::handleIte;
-    fns["__ite_size_t"] = &TranslateFunction::handleIte;
-    fns["__return_val_int"] = &TranslateFunction::handleReturnVal;
-    fns["__return_val_int4"] = &TranslateFunction::handleReturnVal;
-    fns["__return_val_bool"] = &TranslateFunction::handleReturnVal;
-    fns["__return_val_ptr"] = &TranslateFunction::handleReturnVal;
-    fns["__return_val_funptr"] = &TranslateFunction::handleReturnVal;
-    fns["__old_int"] = &TranslateFunction::handleOld;
-    fns["__old_bool"] = &TranslateFunction::handleOld;
-    fns["__other_int"] = &TranslateFunction::handleOtherInt;
-    fns["__other_bool"] = &TranslateFunction::handleOtherBool;
-    fns["__other_ptr_base"] = &TranslateFunction::handleOtherPtrBase;
-    fns["__implies"] = &TranslateFunction::handleImplies;
-    fns["__enabled"] = &TranslateFunction::handleEnabled;
-    fns["__dominator_enabled"] = &TranslateFunction::handleDominatorEnabled;
-    fns["__read_local"] = &TranslateFunction::handleReadHasOccurred;
-    fns["__read_global"] = &TranslateFunction::handleReadHasOccurred;
-    fns["__read"] = &TranslateFunction::handleReadHasOccurred;
-    fns["__write_local"] = &TranslateFunction::handleWriteHasOccurred;
-    fns["__write_global"] = &TranslateFunction::handleWriteHasOccurred;
-    fns["__write"] = &TranslateFunction::handleWriteHasOccurred;
-    fns["__read_offset_bytes_local"] = &TranslateFunction::handleReadOffset;
-    fns["__read_offset_bytes_global"] = &TranslateFunction::handleReadOffset;
-    fns["__read_offset_bytes"] = &TranslateFunction::handleReadOffset;
-    fns["__write_offset_bytes_local"] = &TranslateFunction::handleWriteOffset;
-    fns["__write_offset_bytes_global"] = &TranslateFunction::handleWriteOffset;
-    fns["__write_offset_bytes"] = &TranslateFunction::handleWriteOffset;
-    fns["__ptr_base_local"] = &TranslateFunction::handlePtrBase;
-    fns["__ptr_base_global"] = &TranslateFunction::handlePtrBase;
-    fns["__ptr_base"] = &TranslateFunction::handlePtrBase;
-    fns["__ptr_offset_bytes_local"] = &TranslateFunction::handlePtrOffset;
-    fns["__ptr_offset_bytes_global"] = &TranslateFunction::handlePtrOffset;
-    fns["__ptr_offset_bytes"] = &TranslateFunction::handlePtrOffset;
-    fns["__array_snapshot_local"] = &TranslateFunction::handleArraySnapshot;
-    fns["__array_snapshot_global"] = &TranslateFunction::handleArraySnapshot;
-    fns["__array_snapshot"] = &TranslateFunction::handleArraySnapshot;
-
-    if (SL == TranslateModule::SL_OpenCL || SL == TranslateModule::SL_CUDA) {
-      const std::string opencl[] = {"__bugle_atomic_add",
-                                      "_local_int", "_local_uint",
-                                      "_global_int", "_global_uint",
-                                      "_local_long", "_local_unsigned_long",
-                                      "_global_long", "_global_unsigned_long",
-                                      "" ,
-                                    "__bugle_atomic_sub",
-                                      "_local_int", "_local_uint",
-                                      "_global_int", "_global_uint",
-                                      "_local_long", "_local_unsigned_long",
-                                      "_global_long", "_global_unsigned_long",
-                                      "" ,
-                                    "__bugle_atomic_xchg",
-                                      "_local_int", "_local_uint",
-                                      "_global_int", "_global_uint",
-                                      "_local_float", "_global_float",
-                                      "_local_long", "_local_unsigned_long",
-                                      "_global_long", "_global_unsigned_long",
-                                      "" ,
-                                    "__bugle_atomic_min",
-                                      "_local_int", "_local_uint",
-                                      "_global_int", "_global_uint",
-                                      "_local_long", "_local_unsigned_long",
-                                      "_global_long", "_global_unsigned_long",
-                                      "" ,
-                                    "__bugle_atomic_max",
-                                      "_local_int", "_local_uint",
-                                      "_global_int", "_global_uint",
-                                      "_local_long", "_local_unsigned_long",
-                                      "_global_long", "_global_unsigned_long",
-                                      "" ,
-                                    "__bugle_atomic_and",
-                                      "_local_int", "_local_uint",
-                                      "_global_int", "_global_uint",
-                                      "_local_long", "_local_unsigned_long",
-                                      "_global_long", "_global_unsigned_long",
-                                      "" ,
-                                    "__bugle_atomic_or",
-                                      "_local_int", "_local_uint",
-                                      "_global_int", "_global_uint",
-                                      "_local_long", "_local_unsigned_long",
-                                      "_global_long", "_global_unsigned_long",
-                                      "" ,
-                                    "__bugle_atomic_xor",
-                                      "_local_int", "_local_uint",
-                                      "_global_int", "_global_uint",
-                                      "_local_long", "_local_unsigned_long",
-                                      "_global_long", "_global_unsigned_long",
-                                      "" ,
-                                    "__bugle_atomic_cmpxchg",
-                                      "_local_int", "_local_uint",
-                                      "_global_int", "_global_uint",
-                                      "_local_long", "_local_unsigned_long",
-                                      "_global_long", "_global_unsigned_long",
-                                      "" ,
-                                    "__bugle_atomic_inc",
-                                      "_local_int", "_local_uint",
-                                      "_global_int", "_global_uint",
-                                      "_local_long", "_local_unsigned_long",
-                                      "_global_long", "_global_unsigned_long",
-                                      "" ,
-                                    "__bugle_atomic_dec",
-                                      "_local_int", "_local_uint",
-                                      "_global_int", "_global_uint",
-                                      "_local_long", "_local_unsigned_long",
-                                      "_global_long", "_global_unsigned_long",
-                                      "" ,
-                                    ""};
-
-      const std::string cuda[] = {"__atomicAdd",
-                                    "_int", "_unsigned_int",
-                                    "_unsigned_long_long_int",
-                                    "_float", "",
-                                  "__atomicSub",
-                                    "_int", "_unsigned_int", "",
-                                  "__atomicExch",
-                                    "_int", "_unsigned_int",
-                                    "_unsigned_long_long_int",
-                                    "_float", "",
-                                  "__atomicMin",
-                                    "_int", "_unsigned_int",
-                                    "_unsigned_long_long_int", "",
-                                  "__atomicMax",
-                                    "_int", "_unsigned_int",
-                                    "_unsigned_long_long_int", "",
-                                  "__atomicAnd",
-                                    "_int", "_unsigned_int",
-                                    "_unsigned_long_long_int", "",
-                                  "__atomicOr",
-                                    "_int", "_unsigned_int",
-                                    "_unsigned_long_long_int", "",
-                                  "__atomicXor",
-                                    "_int", "_unsigned_int",
-                                    "_unsigned_long_long_int", "",
-                                  "__atomicInc",
-                                    "_unsigned_int", "",
-                                  "__atomicDec",
-                                    "_unsigned_int", "",
-                                  "__atomicCAS",
-                                    "_int", "_unsigned_int",
-                                    "_unsigned_long_long_int", "",
-                                  ""};
-
-      const std::string *atomics =
-          ((SL == TranslateModule::SL_OpenCL) ? opencl : cuda);
-
-      int i = 0;
-      while (atomics[i] != "") {
-        std::string t = atomics[i];
-        ++i;
-        while (atomics[i] != "") {
-          fns[t + atomics[i]] = &TranslateFunction::handleAtomic;
-          ++i;
-        }
-        ++i;
-      }
-    }
-
-    if (SL == TranslateModule::SL_OpenCL || SL == TranslateModule::SL_CUDA) {
-      const unsigned BARRIER_INVARIANT_MAX_ARITY = 20;
-      for (unsigned i = 0; i <= BARRIER_INVARIANT_MAX_ARITY; ++i) {
-        std::string S = "__barrier_invariant_";
-        llvm::raw_string_ostream SS(S);
-        SS << i;
-        fns[SS.str()] = &TranslateFunction::handleBarrierInvariant;
-      }
-      for (unsigned i = 0; i <= BARRIER_INVARIANT_MAX_ARITY; ++i) {
-        std::string S = "__barrier_invariant_binary_";
-        llvm::raw_string_ostream SS(S);
-        SS << i;
-        fns[SS.str()] = &TranslateFunction::handleBarrierInvariantBinary;
-      }
-    }
-
-    if (SL == TranslateModule::SL_OpenCL) {
-      fns["get_local_id"] = &TranslateFunction::handleGetLocalId;
-      fns["get_group_id"] = &TranslateFunction::handleGetGroupId;
-      fns["get_local_size"] = &TranslateFunction::handleGetLocalSize;
-      fns["get_num_groups"] = &TranslateFunction::handleGetNumGroups;
-      fns["get_global_offset"] = &TranslateFunction::handleGetGlobalOffset;
-      fns["get_work_dim"] = &TranslateFunction::handleGetWorkDim;
-      fns["get_image_width"] = &TranslateFunction::handleGetImageWidth;
-      fns["get_image_height"] = &TranslateFunction::handleGetImageHeight;
-      fns["__translate_sampler_initializer"] = &TranslateFunction::handleSamplerInitializer;
-      {
-        const std::string types[] = {"char", "uchar", "short", "ushort", "int",
-                                     "uint", "long", "ulong", "float", "double",
-                                     ""};
-        for (unsigned i = 0; types[i] != ""; ++i) {
-          for (unsigned width = 1; width <= 16; width *= 2) {
-            std::string S;
-            llvm::raw_string_ostream SS(S);
-            if (width > 1) {
-              SS << width;
-            }
-            fns["__bugle_async_work_group_copy_global_to_local_" + types[i] +
-                SS.str()] = &TranslateFunction::handleAsyncWorkGroupCopy;
-            fns["__bugle_async_work_group_copy_local_to_global_" + types[i] +
-                SS.str()] = &TranslateFunction::handleAsyncWorkGroupCopy;
-          }
-        }
-      }
-      fns["__bugle_wait_group_events"] = &TranslateFunction::handleWaitGroupEvents;
-    }
-
-    if (SL == TranslateModule::SL_CUDA) {
-      fns["cos"] = &TranslateFunction::handleCos;
-      fns["sin"] = &TranslateFunction::handleSin;
-      fns["sqrt"] = &TranslateFunction::handleSqrt;
-      fns["sqrtf"] = &TranslateFunction::handleSqrt;
-      fns["rsqrt"] = &TranslateFunction::handleRsqrt;
-      fns["log2"] = &TranslateFunction::handleLog2;
-      fns["exp2"] = &TranslateFunction::handleExp;
-      fns["__clz"] = &TranslateFunction::handleCtlz;
-    }
-
-    auto &ints = SpecialFunctionMap.Intrinsics;
-    ints[Intrinsic::ceil] = &TranslateFunction::handleCeil;
-    ints[Intrinsic::ctpop] = &TranslateFunction::handleCtpop;
-    ints[Intrinsic::cos] = &TranslateFunction::handleCos;
-    ints[Intrinsic::ctlz] = &TranslateFunction::handleCtlz;
-    ints[Intrinsic::exp] = &TranslateFunction::handleExp;
-    ints[Intrinsic::exp2] = &TranslateFunction::handleExp2;
-    ints[Intrinsic::fabs] = &TranslateFunction::handleFabs;
-    ints[Intrinsic::fma] = &TranslateFunction::handleFma;
-    ints[Intrinsic::fmuladd] = &TranslateFunction::handleFma;
-    ints[Intrinsic::floor] = &TranslateFunction::handleFloor;
-    ints[Intrinsic::log] = &TranslateFunction::handleLog;
-    ints[Intrinsic::log10] = &TranslateFunction::handleLog10;
-    ints[Intrinsic::log2] = &TranslateFunction::handleLog2;
-    ints[Intrinsic::maxnum] = &TranslateFunction::handleFmax;
-    ints[Intrinsic::minnum] = &TranslateFunction::handleFmin;
-    ints[Intrinsic::pow] = &TranslateFunction::handlePow;
-    ints[Intrinsic::powi] = &TranslateFunction::handlePowi;
-    ints[Intrinsic::rint] = &TranslateFunction::handleRint;
-    ints[Intrinsic::sin] = &TranslateFunction::handleSin;
-    ints[Intrinsic::sqrt] = &TranslateFunction::handleSqrt;
-    ints[Intrinsic::trunc] = &TranslateFunction::handleTrunc;
-    ints[Intrinsic::uadd_with_overflow] = &TranslateFunction::handleUaddOvl;
-    ints[Intrinsic::sadd_with_overflow] = &TranslateFunction::handleSaddOvl;
-    ints[Intrinsic::usub_with_overflow] = &TranslateFunction::handleUsubOvl;
-    ints[Intrinsic::ssub_with_overflow] = &TranslateFunction::handleSsubOvl;
-    ints[Intrinsic::dbg_value] = &TranslateFunction::handleNoop;
-    ints[Intrinsic::dbg_declare] = &TranslateFunction::handleNoop;
-    ints[Intrinsic::memset] = &TranslateFunction::handleMemset;
-    ints[Intrinsic::memcpy] = &TranslateFunction::handleMemcpy;
-    ints[Intrinsic::trap] = &TranslateFunction::handleTrap;
-    ints[Intrinsic::lifetime_start] = &TranslateFunction::handleNoop;
-    ints[Intrinsic::lifetime_end] = &TranslateFunction::handleNoop;
+// Return the handler that translates calls to special functions of the given
+// kind, or null if calls to them are translated as normal calls.
+TranslateFunction::SpecialFnHandler TranslateFunction::*
+TranslateFunction::getSpecialFunctionHandler(SpecialFunctionKind K) {
+  switch (K) {
+  case SF_None:
+  case SF_Axiom:
+  case SF_Specification:
+  case SF_Barrier:
+    return nullptr;
+  case SF_UninterpretedFunction:
+    return &TranslateFunction::handleUninterpretedFunction;
+  case SF_Noop:
+    return &TranslateFunction::handleNoop;
+  case SF_AssertFail:
+    return &TranslateFunction::handleAssertFail;
+  case SF_Assume:
+    return &TranslateFunction::handleAssume;
+  case SF_Assert:
+    return &TranslateFunction::handleAssert;
+  case SF_GlobalAssert:
+    return &TranslateFunction::handleGlobalAssert;
+  case SF_CandidateAssert:
+    return &TranslateFunction::handleCandidateAssert;
+  case SF_CandidateGlobalAssert:
+    return &TranslateFunction::handleCandidateGlobalAssert;
+  case SF_Invariant:
+    return &TranslateFunction::handleInvariant;
+  case SF_GlobalInvariant:
+    return &TranslateFunction::handleGlobalInvariant;
+  case SF_CandidateInvariant:
+    return &TranslateFunction::handleCandidateInvariant;
+  case SF_CandidateGlobalInvariant:
+    return &TranslateFunction::handleCandidateGlobalInvariant;
+  case SF_NonTemporalLoadsBegin:
+    return &TranslateFunction::handleNonTemporalLoadsBegin;
+  case SF_NonTemporalLoadsEnd:
+    return &TranslateFunction::handleNonTemporalLoadsEnd;
+  case SF_Requires:
+    return &TranslateFunction::handleRequires;
+  case SF_Ensures:
+    return &TranslateFunction::handleEnsures;
+  case SF_GlobalRequires:
+    return &TranslateFunction::handleGlobalRequires;
+  case SF_GlobalEnsures:
+    return &TranslateFunction::handleGlobalEnsures;
+  case SF_RequiresFreshArray:
+    return &TranslateFunction::handleRequiresFreshArray;
+  case SF_FunctionWideInvariant:
+    return &TranslateFunction::handleFunctionWideInvariant;
+  case SF_FunctionWideCandidateInvariant:
+    return &TranslateFunction::handleFunctionWideCandidateInvariant;
+  case SF_ReadsFrom:
+    return &TranslateFunction::handleReadsFrom;
+  case SF_WritesTo:
+    return &TranslateFunction::handleWritesTo;
+  case SF_Enabled:
+    return &TranslateFunction::handleEnabled;
+  case SF_DominatorEnabled:
+    return &TranslateFunction::handleDominatorEnabled;
+  case SF_OtherInt:
+    return &TranslateFunction::handleOtherInt;
+  case SF_OtherBool:
+    return &TranslateFunction::handleOtherBool;
+  case SF_OtherPtrBase:
+    return &TranslateFunction::handleOtherPtrBase;
+  case SF_Old:
+    return &TranslateFunction::handleOld;
+  case SF_ReturnVal:
+    return &TranslateFunction::handleReturnVal;
+  case SF_Implies:
+    return &TranslateFunction::handleImplies;
+  case SF_ReadHasOccurred:
+    return &TranslateFunction::handleReadHasOccurred;
+  case SF_WriteHasOccurred:
+    return &TranslateFunction::handleWriteHasOccurred;
+  case SF_ReadOffset:
+    return &TranslateFunction::handleReadOffset;
+  case SF_WriteOffset:
+    return &TranslateFunction::handleWriteOffset;
+  case SF_PtrOffset:
+    return &TranslateFunction::handlePtrOffset;
+  case SF_PtrBase:
+    return &TranslateFunction::handlePtrBase;
+  case SF_ArraySnapshot:
+    return &TranslateFunction::handleArraySnapshot;
+  case SF_BarrierInvariant:
+    return &TranslateFunction::handleBarrierInvariant;
+  case SF_BarrierInvariantBinary:
+    return &TranslateFunction::handleBarrierInvariantBinary;
+  case SF_AddNoovflUnsigned:
+    return &TranslateFunction::handleAddNoovflUnsigned;
+  case SF_AddNoovflSigned:
+    return &TranslateFunction::handleAddNoovflSigned;
+  case SF_AddNoovflPredicate:
+    return &TranslateFunction::handleAddNoovflPredicate;
+  case SF_Add:
+    return &TranslateFunction::handleAdd;
+  case SF_Ite:
+    return &TranslateFunction::handleIte;
+  case SF_AtomicHasTakenValue:
+    return &TranslateFunction::handleAtomicHasTakenValue;
+  case SF_Atomic:
+    return &TranslateFunction::handleAtomic;
+  case SF_Memset:
+    return &TranslateFunction::handleMemset;
+  case SF_Memcpy:
+    return &TranslateFunction::handleMemcpy;
+  case SF_Trap:
+    return &TranslateFunction::handleTrap;
+  case SF_GetLocalId:
+    return &TranslateFunction::handleGetLocalId;
+  case SF_GetGroupId:
+    return &TranslateFunction::handleGetGroupId;
+  case SF_GetLocalSize:
+    return &TranslateFunction::handleGetLocalSize;
+  case SF_GetNumGroups:
+    return &TranslateFunction::handleGetNumGroups;
+  case SF_GetGlobalOffset:
+    return &TranslateFunction::handleGetGlobalOffset;
+  case SF_GetWorkDim:
+    return &TranslateFunction::handleGetWorkDim;
+  case SF_GetImageWidth:
+    return &TranslateFunction::handleGetImageWidth;
+  case SF_GetImageHeight:
+    return &TranslateFunction::handleGetImageHeight;
+  case SF_SamplerInitializer:
+    return &TranslateFunction::handleSamplerInitializer;
+  case SF_AsyncWorkGroupCopy:
+    return &TranslateFunction::handleAsyncWorkGroupCopy;
+  case SF_WaitGroupEvents:
+    return &TranslateFunction::handleWaitGroupEvents;
+  case SF_Ceil:
+    return &TranslateFunction::handleCeil;
+  case SF_Ctpop:
+    return &TranslateFunction::handleCtpop;
+  case SF_Cos:
+    return &TranslateFunction::handleCos;
+  case SF_Ctlz:
+    return &TranslateFunction::handleCtlz;
+  case SF_Exp:
+    return &TranslateFunction::handleExp;
+  case SF_Exp2:
+    return &TranslateFunction::handleExp2;
+  case SF_Fabs:
+    return &TranslateFunction::handleFabs;
+  case SF_Fmax:
+    return &TranslateFunction::handleFmax;
+  case SF_Fmin:
+    return &TranslateFunction::handleFmin;
+  case SF_Floor:
+    return &TranslateFunction::handleFloor;
+  case SF_FrexpExp:
+    return &TranslateFunction::handleFrexpExp;
+  case SF_FrexpFrac:
+    return &TranslateFunction::handleFrexpFrac;
+  case SF_Fma:
+    return &TranslateFunction::handleFma;
+  case SF_Log:
+    return &TranslateFunction::handleLog;
+  case SF_Log10:
+    return &TranslateFunction::handleLog10;
+  case SF_Log2:
+    return &TranslateFunction::handleLog2;
+  case SF_Pow:
+    return &TranslateFunction::handlePow;
+  case SF_Powi:
+    return &TranslateFunction::handlePowi;
+  case SF_Rint:
+    return &TranslateFunction::handleRint;
+  case SF_Rsqrt:
+    return &TranslateFunction::handleRsqrt;
+  case SF_SaddOvl:
+    return &TranslateFunction::handleSaddOvl;
+  case SF_Sin:
+    return &TranslateFunction::handleSin;
+  case SF_Sqrt:
+    return &TranslateFunction::handleSqrt;
+  case SF_SsubOvl:
+    return &TranslateFunction::handleSsubOvl;
+  case SF_Trunc:
+    return &TranslateFunction::handleTrunc;
+  case SF_UaddOvl:
+    return &TranslateFunction::handleUaddOvl;
+  case SF_UsubOvl:
+    return &TranslateFunction::handleUsubOvl;
   }
-  return SpecialFunctionMap;
+  llvm_unreachable("Unknown special function kind");
 }
 
 void TranslateFunction::specifyZeroDimensions(unsigned PtrArgs) {
-  ArraySpec &AS = TM->GPUArraySizes[F->getName()];
+  ArraySpec AS;
+  auto ASI = TM->GPUArraySizes.find(F->getName());
+  if (ASI != TM->GPUArraySizes.end())
+    AS = ASI->second;
   if (AS.size() != PtrArgs) {
     std::string msg; llvm::raw_string_ostream msgS(msg);
     msgS << "Expected " << PtrArgs << " array sizes for " << F->getName()
@@ -494,28 +381,8 @@ void TranslateFunction::specifyZeroDimensions(unsigned PtrArgs) {
   }
 }
 
-void TranslateFunction::extractStructArrays(llvm::Value *V) {
-  auto STy = cast<StructType>(V->getType());
-  auto Name = (V->getName() + ".coerce").str();
-  for (unsigned i = 0; i < STy->getNumElements(); ++i) {
-    auto Index = ArrayRef<unsigned>(i);
-    auto E = ExtractValueInst::Create(V, Index, Name + Twine(i));
-    TM->StructMap[F]->push_back(E);
-    if (E->getType()->isStructTy())
-      extractStructArrays(E);
-  }
-}
-
 void TranslateFunction::createStructArrays() {
-  std::vector<llvm::Instruction *> *SV = TM->StructMap[F];
-  if (!SV) {
-    SV = new std::vector<llvm::Instruction *>();
-    TM->StructMap[F] = SV;
-    for (auto i = F->arg_begin(), e = F->arg_end(); i != e; ++i) {
-      if (i->getType()->isStructTy())
-        extractStructArrays(&*i);
-    }
-  }
+  std::vector<llvm::Instruction *> *SV = TM->getStructArrays(F);
 
   BasicBlock *BB = new BasicBlock("");
   unsigned PtrSize = TM->TD.getPointerSizeInBits();
@@ -539,8 +406,7 @@ void TranslateFunction::createStructArrays() {
 }
 
 void TranslateFunction::translate() {
-  if (isGPUEntryPoint || isStandardEntryPoint(TM->SL, F->getName()))
-    BF->setEntryPoint(true);
+  TimeTraceScope Scope("Translate function", F->getName());
 
   if (isGPUEntryPoint)
     BF->addAttribute("kernel");
@@ -564,7 +430,7 @@ void TranslateFunction::translate() {
                                               BVConstExpr::createZero(PtrSize));
     } else {
       Var *V = BF->addArgument(
-          TM->getModelledType(&*i), TranslateModule::getSourceName(&*i, F));
+          TM->getModelledType(&*i), TM->DebugInfo.getSourceName(&*i, F));
       ValueExprMap[&*i] = TM->unmodelValue(&*i, VarRefExpr::create(V));
     }
   }
@@ -938,7 +804,7 @@ ref<Expr> TranslateFunction::handleReadsFrom(bugle::BasicBlock *BBB,
     BF->addModifies(access, extractSourceLocs(CI));
   }
   if (arrayIdExpr->getType().range().isKind(Type::Unknown))
-    TM->NextModelAllAsByteArray = true;
+    TM->requestAllByteArrayModels();
 
   return nullptr;
 }
@@ -958,7 +824,7 @@ ref<Expr> TranslateFunction::handleWritesTo(bugle::BasicBlock *BBB,
                   extractSourceLocs(CI));
 
   if (arrayIdExpr->getType().range().isKind(Type::Unknown))
-    TM->NextModelAllAsByteArray = true;
+    TM->requestAllByteArrayModels();
 
   return nullptr;
 }
@@ -997,7 +863,7 @@ ref<Expr> TranslateFunction::handleOtherPtrBase(bugle::BasicBlock *BBB,
                                                 const ExprVec &Args) {
   Type range = Expr::getPointerRange(Args[0], TM->defaultRange());
   if (range.isKind(Type::Unknown))
-    TM->NextModelAllAsByteArray = true;
+    TM->requestAllByteArrayModels();
   return OtherPtrBaseExpr::create(Args[0]);
 }
 
@@ -1033,7 +899,7 @@ ref<Expr> TranslateFunction::handleReadHasOccurred(bugle::BasicBlock *BBB,
       BoolToBVExpr::create(AccessHasOccurredExpr::create(arrayIdExpr, false));
 
   if (arrayIdExpr->getType().range().isKind(Type::Unknown))
-    TM->NextModelAllAsByteArray = true;
+    TM->requestAllByteArrayModels();
 
   return result;
 }
@@ -1046,7 +912,7 @@ ref<Expr> TranslateFunction::handleWriteHasOccurred(bugle::BasicBlock *BBB,
       BoolToBVExpr::create(AccessHasOccurredExpr::create(arrayIdExpr, true));
 
   if (arrayIdExpr->getType().range().isKind(Type::Unknown))
-    TM->NextModelAllAsByteArray = true;
+    TM->requestAllByteArrayModels();
 
   return result;
 }
@@ -1066,16 +932,7 @@ ref<Expr> TranslateFunction::handleReadOffset(bugle::BasicBlock *BBB,
           result);
     }
   } else {
-    TM->NeedAdditionalByteArrayModels = true;
-    std::set<GlobalArray *> Globals;
-    if (arrayIdExpr->computeArrayCandidates(Globals)) {
-      std::transform(
-          Globals.begin(), Globals.end(),
-          std::inserter(TM->ModelAsByteArray, TM->ModelAsByteArray.begin()),
-          [&](GlobalArray *A) { return TM->GlobalValueMap[A]; });
-    } else {
-      TM->NextModelAllAsByteArray = true;
-    }
+    TM->requestByteArrayModels(arrayIdExpr);
   }
 
   return result;
@@ -1096,16 +953,7 @@ ref<Expr> TranslateFunction::handleWriteOffset(bugle::BasicBlock *BBB,
           result);
     }
   } else {
-    TM->NeedAdditionalByteArrayModels = true;
-    std::set<GlobalArray *> Globals;
-    if (arrayIdExpr->computeArrayCandidates(Globals)) {
-      std::transform(
-          Globals.begin(), Globals.end(),
-          std::inserter(TM->ModelAsByteArray, TM->ModelAsByteArray.begin()),
-          [&](GlobalArray *A) { return TM->GlobalValueMap[A]; });
-    } else {
-      TM->NextModelAllAsByteArray = true;
-    }
+    TM->requestByteArrayModels(arrayIdExpr);
   }
 
   return result;
@@ -1118,16 +966,7 @@ ref<Expr> TranslateFunction::handlePtrOffset(bugle::BasicBlock *BBB,
   ref<Expr> result = ArrayOffsetExpr::create(Args[0]);
 
   if (!arrayIdExpr->getType().range().isKind(Type::BV)) {
-    TM->NeedAdditionalByteArrayModels = true;
-    std::set<GlobalArray *> Globals;
-    if (arrayIdExpr->computeArrayCandidates(Globals)) {
-      std::transform(
-          Globals.begin(), Globals.end(),
-          std::inserter(TM->ModelAsByteArray, TM->ModelAsByteArray.begin()),
-          [&](GlobalArray *A) { return TM->GlobalValueMap[A]; });
-    } else {
-      TM->NextModelAllAsByteArray = true;
-    }
+    TM->requestByteArrayModels(arrayIdExpr);
   }
 
   return result;
@@ -1139,7 +978,7 @@ ref<Expr> TranslateFunction::handlePtrBase(bugle::BasicBlock *BBB,
   ref<Expr> arrayIdExpr = ArrayIdExpr::create(Args[0], TM->defaultRange());
 
   if (arrayIdExpr->getType().range().isKind(Type::Unknown))
-    TM->NextModelAllAsByteArray = true;
+    TM->requestAllByteArrayModels();
 
   return arrayIdExpr;
 }
@@ -1154,7 +993,7 @@ ref<Expr> TranslateFunction::handleArraySnapshot(bugle::BasicBlock *BBB,
   if (dstArrayIdExpr->getType().range().isKind(Type::Unknown) ||
       srcArrayIdExpr->getType().range().isKind(Type::Unknown) ||
       dstArrayIdExpr->getType().range() != srcArrayIdExpr->getType().range())
-    TM->NextModelAllAsByteArray = true;
+    TM->requestAllByteArrayModels();
 
   return nullptr;
 }
@@ -1215,7 +1054,8 @@ ref<Expr> TranslateFunction::handleBarrierInvariant(bugle::BasicBlock *BBB,
     std::string S = F->getName().str();
     llvm::raw_string_ostream SS(S);
     SS << (CI->getNumArgOperands() - 1);
-    BF = TM->BM->addFunction(SS.str(), TM->getSourceFunctionName(F));
+    BF = TM->addAuxiliaryFunction(SS.str(),
+                                  TM->DebugInfo.getSourceFunctionName(F));
     BarrierInvariants[CI->getNumArgOperands()] = BF;
 
     int count = 0;
@@ -1252,7 +1092,8 @@ TranslateFunction::handleBarrierInvariantBinary(bugle::BasicBlock *BBB,
     std::string S = F->getName().str();
     llvm::raw_string_ostream SS(S);
     SS << ((CI->getNumArgOperands() - 1) / 2);
-    BF = TM->BM->addFunction(SS.str(), TM->getSourceFunctionName(F));
+    BF = TM->addAuxiliaryFunction(SS.str(),
+                                  TM->DebugInfo.getSourceFunctionName(F));
     BinaryBarrierInvariants[CI->getNumArgOperands()] = BF;
 
     int count = 0;
@@ -1325,20 +1166,11 @@ ref<Expr> TranslateFunction::handleMemset(bugle::BasicBlock *BBB,
       ref<Expr> StoreOfs = BVAddExpr::create(
           DstDiv, BVConstExpr::create(Dst->getType().width, i));
       BBB->addEvalStmt(ValExpr, currentSourceLocs);
-      BBB->addStmt(
-          StoreStmt::create(DstPtrArr, StoreOfs, ValExpr, currentSourceLocs));
+      BBB->addStmt(StoreStmt::create(DstPtrArr, std::move(StoreOfs),
+                                     std::move(ValExpr), currentSourceLocs));
     }
   } else {
-    TM->NeedAdditionalByteArrayModels = true;
-    std::set<GlobalArray *> Globals;
-    if (DstPtrArr->computeArrayCandidates(Globals)) {
-      std::transform(
-          Globals.begin(), Globals.end(),
-          std::inserter(TM->ModelAsByteArray, TM->ModelAsByteArray.begin()),
-          [&](GlobalArray *A) { return TM->GlobalValueMap[A]; });
-    } else {
-      TM->NextModelAllAsByteArray = true;
-    }
+    TM->requestByteArrayModels(DstPtrArr);
   }
 
   return nullptr;
@@ -1390,26 +1222,16 @@ ref<Expr> TranslateFunction::handleMemcpy(bugle::BasicBlock *BBB,
     for (unsigned i = 0; i != NumElements; ++i) {
       ref<Expr> LoadOfs = BVAddExpr::create(
           SrcDiv, BVConstExpr::create(Src->getType().width, i));
-      ref<Expr> Val =
-          LoadExpr::create(SrcPtrArr, LoadOfs, SrcRangeTy, LoadsAreTemporal);
+      ref<Expr> Val = LoadExpr::create(SrcPtrArr, std::move(LoadOfs),
+                                       SrcRangeTy, LoadsAreTemporal);
       ref<Expr> StoreOfs = BVAddExpr::create(
           DstDiv, BVConstExpr::create(Dst->getType().width, i));
       BBB->addEvalStmt(Val, currentSourceLocs);
-      BBB->addStmt(
-          StoreStmt::create(DstPtrArr, StoreOfs, Val, currentSourceLocs));
+      BBB->addStmt(StoreStmt::create(DstPtrArr, std::move(StoreOfs),
+                                     std::move(Val), currentSourceLocs));
     }
   } else {
-    TM->NeedAdditionalByteArrayModels = true;
-    std::set<GlobalArray *> Globals;
-    if (SrcPtrArr->computeArrayCandidates(Globals) &&
-        DstPtrArr->computeArrayCandidates(Globals)) {
-      std::transform(
-          Globals.begin(), Globals.end(),
-          std::inserter(TM->ModelAsByteArray, TM->ModelAsByteArray.begin()),
-          [&](GlobalArray *A) { return TM->GlobalValueMap[A]; });
-    } else {
-      TM->NextModelAllAsByteArray = true;
-    }
+    TM->requestByteArrayModels({SrcPtrArr, DstPtrArr});
   }
 
   return nullptr;
@@ -1592,17 +1414,7 @@ ref<Expr> TranslateFunction::handleAsyncWorkGroupCopy(bugle::BasicBlock *BBB,
     result = AsyncWorkGroupCopyExpr::create(DstArr, DstDiv, SrcArr, SrcDiv,
                                             NumElements, Args[3]);
   } else {
-    TM->NeedAdditionalByteArrayModels = true;
-    std::set<GlobalArray *> Globals;
-    if (SrcArr->computeArrayCandidates(Globals) &&
-        DstArr->computeArrayCandidates(Globals)) {
-      std::transform(
-          Globals.begin(), Globals.end(),
-          std::inserter(TM->ModelAsByteArray, TM->ModelAsByteArray.begin()),
-          [&](GlobalArray *A) { return TM->GlobalValueMap[A]; });
-    } else {
-      TM->NextModelAllAsByteArray = true;
-    }
+    TM->requestByteArrayModels({SrcArr, DstArr});
     // The result is irrelevant, but the caller requires one
     Type HandleTy = TM->translateType(CI->getType());
     result = BVConstExpr::createZero(HandleTy.width);
@@ -2031,57 +1843,50 @@ ref<Expr> TranslateFunction::handleAtomicHasTakenValue(bugle::BasicBlock *BBB,
       AtomicHasTakenValueExpr::create(arrayIdExpr, Args[1], Args[2]));
 
   if (!arrayIdExpr->getType().range().isKind(Type::BV)) {
-    TM->NeedAdditionalByteArrayModels = true;
-    std::set<GlobalArray *> Globals;
-    if (arrayIdExpr->computeArrayCandidates(Globals)) {
-      std::transform(
-          Globals.begin(), Globals.end(),
-          std::inserter(TM->ModelAsByteArray, TM->ModelAsByteArray.begin()),
-          [&](GlobalArray *A) { return TM->GlobalValueMap[A]; });
-    } else {
-      TM->NextModelAllAsByteArray = true;
-    }
+    TM->requestByteArrayModels(arrayIdExpr);
   }
   return result;
 }
 
 ref<Expr> TranslateFunction::maybeTranslateSIMDInst(
     bugle::BasicBlock *BBB, llvm::Type *Ty, llvm::Type *OpTy, ref<Expr> Op,
-    std::function<ref<Expr>(llvm::Type *, ref<Expr>)> F) {
+    const std::function<ref<Expr>(llvm::Type *, ref<Expr>)> &F) {
   if (!isa<VectorType>(Ty))
-    return F(Ty, Op);
+    return F(Ty, std::move(Op));
 
   auto VT = cast<VectorType>(Ty);
   unsigned NumElems = VT->getNumElements();
   assert(cast<VectorType>(OpTy)->getNumElements() == NumElems);
   unsigned ElemWidth = Op->getType().width / NumElems;
   ExprVec Elems;
+  Elems.reserve(NumElems);
   for (unsigned i = 0; i < NumElems; ++i) {
     ref<Expr> Opi = BVExtractExpr::create(Op, i * ElemWidth, ElemWidth);
-    ref<Expr> Elem = F(VT->getElementType(), Opi);
+    ref<Expr> Elem = F(VT->getElementType(), std::move(Opi));
     BBB->addEvalStmt(Elem, currentSourceLocs);
-    Elems.push_back(Elem);
+    Elems.push_back(std::move(Elem));
   }
   return Expr::createBVConcatN(Elems);
 }
 
 ref<Expr> TranslateFunction::maybeTranslateSIMDInst(
     bugle::BasicBlock *BBB, llvm::Type *Ty, llvm::Type *OpTy, ref<Expr> LHS,
-    ref<Expr> RHS, std::function<ref<Expr>(ref<Expr>, ref<Expr>)> F) {
+    ref<Expr> RHS, const std::function<ref<Expr>(ref<Expr>, ref<Expr>)> &F) {
   if (!isa<VectorType>(Ty))
-    return F(LHS, RHS);
+    return F(std::move(LHS), std::move(RHS));
 
   auto VT = cast<VectorType>(Ty);
   unsigned NumElems = VT->getNumElements();
   assert(cast<VectorType>(OpTy)->getNumElements() == NumElems);
   unsigned ElemWidth = LHS->getType().width / NumElems;
   ExprVec Elems;
+  Elems.reserve(NumElems);
   for (unsigned i = 0; i < NumElems; ++i) {
     ref<Expr> LHSi = BVExtractExpr::create(LHS, i * ElemWidth, ElemWidth);
     ref<Expr> RHSi = BVExtractExpr::create(RHS, i * ElemWidth, ElemWidth);
-    ref<Expr> Elem = F(LHSi, RHSi);
+    ref<Expr> Elem = F(std::move(LHSi), std::move(RHSi));
     BBB->addEvalStmt(Elem, currentSourceLocs);
-    Elems.push_back(Elem);
+    Elems.push_back(std::move(Elem));
   }
   return Expr::createBVConcatN(Elems);
 }
@@ -2165,6 +1970,7 @@ void TranslateFunction::translateInstruction(bugle::BasicBlock *BBB,
     }
     assert(LoadTy.width % 8 == 0);
     ref<Expr> Div;
+    uint64_t ByteOfs;
     if ((ArrRangeTy == LoadElTy || ArrRangeTy == Type(Type::Any)) &&
         !(Div = Expr::createExactBVSDiv(PtrOfs, LoadElTy.width / 8)).isNull()) {
       if (VectorLoad) {
@@ -2205,17 +2011,28 @@ void TranslateFunction::translateInstruction(bugle::BasicBlock *BBB,
         E = SafeBVToPtrExpr::create(E->getType().width, E);
       else if (LoadTy.isKind(Type::FunctionPointer))
         E = BVToFuncPtrExpr::create(E->getType().width, E);
-    } else {
-      TM->NeedAdditionalByteArrayModels = true;
-      std::set<GlobalArray *> Globals;
-      if (PtrArr->computeArrayCandidates(Globals)) {
-        std::transform(
-            Globals.begin(), Globals.end(),
-            std::inserter(TM->ModelAsByteArray, TM->ModelAsByteArray.begin()),
-            [&](GlobalArray *A) { return TM->GlobalValueMap[A]; });
-      } else {
-        TM->NextModelAllAsByteArray = true;
+    } else if (TM->useMixedWidthArrays() && ArrRangeTy.kind == Type::BV &&
+               !(Div = splitArrayOffset(PtrOfs, ArrRangeTy.width / 8,
+                                        ByteOfs)).isNull()) {
+      // Load the elements that the value overlaps and extract the value.
+      unsigned Lo = ByteOfs * 8;
+      ExprVec PartsLoaded;
+      for (unsigned i = 0; i * ArrRangeTy.width < Lo + LoadTy.width; ++i) {
+        ref<Expr> PartOfs = BVAddExpr::create(
+            Div, BVConstExpr::create(Div->getType().width, i));
+        ref<Expr> PartVal =
+            LoadExpr::create(PtrArr, PartOfs, ArrRangeTy, LoadsAreTemporal);
+        PartsLoaded.push_back(PartVal);
+        BBB->addEvalStmt(PartVal, currentSourceLocs);
       }
+      E = BVExtractExpr::create(Expr::createBVConcatN(PartsLoaded), Lo,
+                                LoadTy.width); // Assumes little endian
+      if (LoadTy.isKind(Type::Pointer))
+        E = SafeBVToPtrExpr::create(E->getType().width, E);
+      else if (LoadTy.isKind(Type::FunctionPointer))
+        E = BVToFuncPtrExpr::create(E->getType().width, E);
+    } else {
+      TM->requestByteArrayModels(PtrArr);
       E = TM->translateArbitrary(LoadTy);
     }
   } else if (auto SI = dyn_cast<StoreInst>(I)) {
@@ -2235,6 +2052,7 @@ void TranslateFunction::translateInstruction(bugle::BasicBlock *BBB,
     }
     assert(StoreTy.width % 8 == 0);
     ref<Expr> Div;
+    uint64_t ByteOfs;
     // If ArrRangeTy is Any, then we are using a null pointer for storing
     if ((ArrRangeTy == StoreElTy || ArrRangeTy == Type(Type::Any)) &&
         !(Div = Expr::createExactBVSDiv(PtrOfs, StoreElTy.width / 8))
@@ -2277,17 +2095,43 @@ void TranslateFunction::translateInstruction(bugle::BasicBlock *BBB,
         BBB->addStmt(
             StoreStmt::create(PtrArr, PartOfs, PartVal, currentSourceLocs));
       }
-    } else {
-      TM->NeedAdditionalByteArrayModels = true;
-      std::set<GlobalArray *> Globals;
-      if (PtrArr->computeArrayCandidates(Globals)) {
-        std::transform(
-            Globals.begin(), Globals.end(),
-            std::inserter(TM->ModelAsByteArray, TM->ModelAsByteArray.begin()),
-            [&](GlobalArray *A) { return TM->GlobalValueMap[A]; });
-      } else {
-        TM->NextModelAllAsByteArray = true;
+    } else if (TM->useMixedWidthArrays() && ArrRangeTy.kind == Type::BV &&
+               !(Div = splitArrayOffset(PtrOfs, ArrRangeTy.width / 8,
+                                        ByteOfs)).isNull()) {
+      if (StoreTy.isKind(Type::Pointer)) {
+        Val = SafePtrToBVExpr::create(Val->getType().width, Val);
+        BBB->addEvalStmt(Val, currentSourceLocs);
+      } else if (StoreTy.isKind(Type::FunctionPointer)) {
+        Val = FuncPtrToBVExpr::create(Val->getType().width, Val);
+        BBB->addEvalStmt(Val, currentSourceLocs);
       }
+      // Store each element that the value overlaps, keeping the bits of the
+      // elements that are only partly overwritten.
+      unsigned Lo = ByteOfs * 8, Hi = Lo + StoreTy.width;
+      for (unsigned i = 0; i * ArrRangeTy.width < Hi; ++i) {
+        unsigned ElemLo = i * ArrRangeTy.width,
+                 ElemHi = ElemLo + ArrRangeTy.width;
+        unsigned ValLo = std::max(ElemLo, Lo), ValHi = std::min(ElemHi, Hi);
+        ref<Expr> PartOfs = BVAddExpr::create(
+            Div, BVConstExpr::create(Div->getType().width, i));
+        ref<Expr> Old;
+        if (ValLo != ElemLo || ValHi != ElemHi) {
+          Old = LoadExpr::create(PtrArr, PartOfs, ArrRangeTy, LoadsAreTemporal);
+          BBB->addEvalStmt(Old, currentSourceLocs);
+        }
+        ExprVec Parts;
+        if (ValLo != ElemLo)
+          Parts.push_back(BVExtractExpr::create(Old, 0, ValLo - ElemLo));
+        Parts.push_back(BVExtractExpr::create(Val, ValLo - Lo, ValHi - ValLo));
+        if (ValHi != ElemHi)
+          Parts.push_back(
+              BVExtractExpr::create(Old, ValHi - ElemLo, ElemHi - ValHi));
+        BBB->addStmt(StoreStmt::create(PtrArr, PartOfs,
+                                       Expr::createBVConcatN(Parts),
+                                       currentSourceLocs));
+      }
+    } else {
+      TM->requestByteArrayModels(PtrArr);
     }
     return;
   } else if (auto II = dyn_cast<ICmpInst>(I)) {
@@ -2479,9 +2323,9 @@ void TranslateFunction::translateInstruction(bugle::BasicBlock *BBB,
 
     if (auto II = dyn_cast<IntrinsicInst>(CI)) {
       auto ID = II->getIntrinsicID();
-      auto SFII = SpecialFunctionMap.Intrinsics.find(ID);
-      if (SFII != SpecialFunctionMap.Intrinsics.end()) {
-        E = (this->*SFII->second)(BBB, CI, Args);
+      if (auto Handler =
+              getSpecialFunctionHandler(lookupSpecialIntrinsic(ID))) {
+        E = (this->*Handler)(BBB, CI, Args);
         assert(E.isNull() == CI->getType()->isVoidTy());
         if (E.isNull())
           return;
@@ -2492,13 +2336,12 @@ void TranslateFunction::translateInstruction(bugle::BasicBlock *BBB,
       }
     } else {
       auto F = CI->getCalledFunction();
-      auto SFI = SpecialFunctionMap.Functions.end();
-      if (F) {
-        SFI = SpecialFunctionMap.Functions.find(
-            trimForRequiresFreshArrayFunction(F->getName()));
-      }
-      if (SFI != SpecialFunctionMap.Functions.end()) {
-        E = (this->*SFI->second)(BBB, CI, Args);
+      SpecialFnHandler TranslateFunction::*Handler = nullptr;
+      if (F)
+        Handler = getSpecialFunctionHandler(lookupSpecialFunction(
+            TM->SL, trimForRequiresFreshArrayFunction(F->getName())));
+      if (Handler) {
+        E = (this->*Handler)(BBB, CI, Args);
         assert(E.isNull() == CI->getType()->isVoidTy());
         if (E.isNull())
           return;
@@ -2604,6 +2447,9 @@ void TranslateFunction::translateInstruction(bugle::BasicBlock *BBB,
 
 void TranslateFunction::translateBasicBlock(bugle::BasicBlock *BBB,
                                             llvm::BasicBlock *BB) {
+  // Nodes are shared within the block only, such that each node that is
+  // evaluated is evaluated before its uses.
+  Expr::HashConsScope HashCons;
   for (auto i = BB->begin(), e = BB->end(); i != e; ++i)
     translateInstruction(BBB, &*i);
 }
@@ -1,18 +1,32 @@
 #include "bugle/Translator/TranslateModule.h"
+#include "bugle/Translator/DebugInfoIndex.h"
+#include "bugle/Translator/PointerModelFile.h"
+#include "bugle/Translator/PointerModelInference.h"
 #include "bugle/Translator/TranslateFunction.h"
 #include "bugle/Expr.h"
+#include "bugle/ExprRewriter.h"
 #include "bugle/Function.h"
 #include "bugle/Module.h"
 #include "bugle/Stmt.h"
 #include "bugle/util/ErrorReporter.h"
+#include "bugle/util/Statistics.h"
+#include "bugle/util/TimeTrace.h"
+#include "llvm/ADT/ScopeExit.h"
 #include "llvm/BinaryFormat/Dwarf.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/TypeFinder.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <string>
 
 using namespace llvm;
 using namespace bugle;
@@ -22,10 +36,32 @@ static cl::opt<bool> ModelBVAsByteArray(
     cl::desc("Model each array composed of bit vector elements as an array of "
              "bit vectors of size 8"));
 
+static cl::opt<bool> ModelMixedWidthArrays(
+    "model-mixed-width-arrays", cl::init(false),
+    cl::desc("Keep arrays that are accessed at other widths or offsets than "
+             "their element type at their element width, rather than "
+             "modelling them as byte arrays. Such accesses are checked for "
+             "races on the whole elements they overlap"));
+
+static cl::opt<unsigned> FunctionThreads(
+    "function-threads",
+    cl::desc("Number of functions to translate in parallel (default 1, "
+             "0 for one per core)"),
+    cl::value_desc("int"), cl::init(1));
+
 static unsigned gcd(unsigned a, unsigned b) {
   return b == 0 ? a : gcd(b, a % b);
 }
 
+namespace {
+
+// A lock on the shared translation state.
+typedef std::lock_guard<std::recursive_mutex> StateLock;
+}
+
+thread_local TranslateModule::FunctionTranslation
+    *TranslateModule::CurrentTranslation = nullptr;
+
 TranslateModule::AddressSpaceMap::AddressSpaceMap(unsigned Global,
                                                   unsigned GroupShared,
                                                   unsigned Constant)
@@ -37,15 +73,47 @@ TranslateModule::AddressSpaceMap::AddressSpaceMap(unsigned Global,
 }
 
 ref<Expr> TranslateModule::translateConstant(Constant *C) {
+  // Each function keeps the constants it looked up, saving it from taking the
+  // lock for every use of a constant. The constants looked up while
+  // translating another constant take the lock, as their model uses are
+  // recorded for that constant.
+  auto FT = CurrentTranslation;
+  bool UseCache = FT && !FT->TranslatingConstant;
+  if (UseCache) {
+    auto CI = FT->Constants.find(C);
+    if (CI != FT->Constants.end())
+      return CI->second;
+  }
+
+  StateLock Lock(StateMutex);
   ref<Expr> &E = ConstantMap[C];
-  if (E.isNull())
+  std::set<Value *> &Uses = ConstantModelUses[C];
+  auto OuterUses = FT ? FT->ModelUses : nullptr;
+  if (E.isNull()) {
+    if (FT) {
+      FT->ModelUses = &Uses;
+      FT->TranslatingConstant = true;
+    }
+    // Constants are shared by all functions, so they must not share nodes
+    // with the function that happens to translate them first.
+    Expr::HashConsScope NoHashCons(/*Enable=*/false);
     E = doTranslateConstant(C);
-  E->preventEvalStmt = true;
+    if (FT) {
+      FT->ModelUses = OuterUses;
+      FT->TranslatingConstant = !UseCache;
+    }
+    E->preventEvalStmt = true;
+  }
+  if (OuterUses && OuterUses != &Uses)
+    OuterUses->insert(Uses.begin(), Uses.end());
+  if (UseCache)
+    FT->Constants[C] = E;
   return E;
 }
 
 void TranslateModule::translateGlobalInit(GlobalArray *GA, unsigned ByteOffset,
                                           Constant *Init) {
+  StateLock Lock(StateMutex);
   if (auto CS = dyn_cast<ConstantStruct>(Init)) {
     auto SL = TD.getStructLayout(CS->getType());
     for (unsigned i = 0; i < CS->getNumOperands(); ++i)
@@ -78,8 +146,7 @@ void TranslateModule::translateGlobalInit(GlobalArray *GA, unsigned ByteOffset,
                           BVExtractExpr::create(Const, i * GAWidth, GAWidth));
       }
     } else {
-      NeedAdditionalByteArrayModels = true;
-      ModelAsByteArray.insert(GlobalValueMap[GA]);
+      requestByteArrayModel(GlobalValueMap[GA]);
     }
   }
 }
@@ -220,39 +287,41 @@ ref<Expr> TranslateModule::translateICmp(CmpInst::Predicate P, ref<Expr> LHS,
 
 ref<Expr> TranslateModule::maybeTranslateSIMDInst(
     llvm::Type *Ty, llvm::Type *OpTy, ref<Expr> Op,
-    std::function<ref<Expr>(llvm::Type *, ref<Expr>)> F) {
+    const std::function<ref<Expr>(llvm::Type *, ref<Expr>)> &F) {
   if (!isa<VectorType>(Ty))
-    return F(Ty, Op);
+    return F(Ty, std::move(Op));
 
   auto VT = cast<VectorType>(Ty);
   unsigned NumElems = VT->getNumElements();
   assert(cast<VectorType>(OpTy)->getNumElements() == NumElems);
   unsigned ElemWidth = Op->getType().width / NumElems;
   std::vector<ref<Expr>> Elems;
+  Elems.reserve(NumElems);
   for (unsigned i = 0; i < NumElems; ++i) {
     ref<Expr> Opi = BVExtractExpr::create(Op, i * ElemWidth, ElemWidth);
-    ref<Expr> Elem = F(VT->getElementType(), Opi);
-    Elems.push_back(Elem);
+    ref<Expr> Elem = F(VT->getElementType(), std::move(Opi));
+    Elems.push_back(std::move(Elem));
   }
   return Expr::createBVConcatN(Elems);
 }
 
 ref<Expr> TranslateModule::maybeTranslateSIMDInst(
     llvm::Type *Ty, llvm::Type *OpTy, ref<Expr> LHS, ref<Expr> RHS,
-    std::function<ref<Expr>(ref<Expr>, ref<Expr>)> F) {
+    const std::function<ref<Expr>(ref<Expr>, ref<Expr>)> &F) {
   if (!isa<VectorType>(Ty))
-    return F(LHS, RHS);
+    return F(std::move(LHS), std::move(RHS));
 
   auto VT = cast<VectorType>(Ty);
   unsigned NumElems = VT->getNumElements();
   assert(cast<VectorType>(OpTy)->getNumElements() == NumElems);
   unsigned ElemWidth = LHS->getType().width / NumElems;
   std::vector<ref<Expr>> Elems;
+  Elems.reserve(NumElems);
   for (unsigned i = 0; i < NumElems; ++i) {
     ref<Expr> LHSi = BVExtractExpr::create(LHS, i * ElemWidth, ElemWidth);
     ref<Expr> RHSi = BVExtractExpr::create(RHS, i * ElemWidth, ElemWidth);
-    ref<Expr> Elem = F(LHSi, RHSi);
-    Elems.push_back(Elem);
+    ref<Expr> Elem = F(std::move(LHSi), std::move(RHSi));
+    Elems.push_back(std::move(Elem));
   }
   return Expr::createBVConcatN(Elems);
 }
@@ -338,7 +407,7 @@ ref<Expr> TranslateModule::doTranslateConstant(Constant *C) {
   if (auto F = dyn_cast<llvm::Function>(C)) {
     auto FI = FunctionMap.find(F);
     if (FI == FunctionMap.end()) {
-      std::string DN = getSourceFunctionName(F);
+      std::string DN = DebugInfo.getSourceFunctionName(F);
       std::string msg = "Unsupported function pointer '" + DN + "'";
       ErrorReporter::reportImplementationLimitation(msg);
     }
@@ -460,16 +529,9 @@ void TranslateModule::getSourceArrayDimensions(llvm::Type *T,
   }
 }
 
-bugle::GlobalArray *TranslateModule::getGlobalArray(llvm::Value *V,
-                                                    bool IsParameter) {
-  GlobalArray *&GA = ValueGlobalMap[V];
-  if (GA) {
-    if (IsParameter) {
-      GA->invalidateZeroDimension();
-    }
-    return GA;
-  }
+bool TranslateModule::useMixedWidthArrays() { return ModelMixedWidthArrays; }
 
+bugle::Type TranslateModule::getGlobalArrayRangeType(llvm::Value *V) {
   bugle::Type T(Type::BV, 8);
   auto PT = cast<PointerType>(V->getType());
 
@@ -481,6 +543,23 @@ bugle::GlobalArray *TranslateModule::getGlobalArray(llvm::Value *V,
       T = Type(Type::BV, 8);
     }
   }
+  return T;
+}
+
+bugle::GlobalArray *TranslateModule::getGlobalArray(llvm::Value *V,
+                                                    bool IsParameter) {
+  recordModelUse(V);
+  StateLock Lock(StateMutex);
+  GlobalArray *&GA = ValueGlobalMap[V];
+  if (GA) {
+    if (IsParameter) {
+      GA->invalidateZeroDimension();
+    }
+    return GA;
+  }
+
+  bugle::Type T = getGlobalArrayRangeType(V);
+  auto PT = cast<PointerType>(V->getType());
   auto ST = translateSourceArrayRangeType(PT->getElementType());
   std::vector<uint64_t> dim;
   if (IsParameter)
@@ -625,17 +704,20 @@ ref<Expr> TranslateModule::translateBitCast(llvm::Type *SrcTy,
     return Op;
 }
 
-bool TranslateModule::isGPUEntryPoint(llvm::Function *F, llvm::Module *M,
-                                      SourceLanguage SL,
-                                      std::set<std::string> &EPS) {
+TranslateModule::GPUEntryPointSet::GPUEntryPointSet(
+    llvm::Module *M, SourceLanguage SL, const std::set<std::string> &EPS)
+    : Names(EPS) {
   if (SL == SL_OpenCL || SL == SL_CUDA) {
     if (NamedMDNode *NMD = M->getNamedMetadata("nvvm.annotations")) {
       for (unsigned i = 0, e = NMD->getNumOperands(); i != e; ++i) {
         MDNode *MD = NMD->getOperand(i);
-        if (MD->getOperand(0) == ValueAsMetadata::get(F))
-          for (unsigned fi = 1, fe = MD->getNumOperands(); fi != fe; fi += 2)
-            if (cast<MDString>(MD->getOperand(fi))->getString() == "kernel")
-              return true;
+        auto F =
+            mdconst::dyn_extract_or_null<llvm::Function>(MD->getOperand(0));
+        if (!F)
+          continue;
+        for (unsigned fi = 1, fe = MD->getNumOperands(); fi != fe; fi += 2)
+          if (cast<MDString>(MD->getOperand(fi))->getString() == "kernel")
+            Kernels.insert(F);
       }
     }
   }
@@ -644,24 +726,17 @@ bool TranslateModule::isGPUEntryPoint(llvm::Function *F, llvm::Module *M,
     if (NamedMDNode *NMD = M->getNamedMetadata("opencl.kernels")) {
       for (unsigned i = 0, e = NMD->getNumOperands(); i != e; ++i) {
         MDNode *MD = NMD->getOperand(i);
-        if (MD->getOperand(0) == ValueAsMetadata::get(F))
-          return true;
+        if (auto F =
+                mdconst::dyn_extract_or_null<llvm::Function>(MD->getOperand(0)))
+          Kernels.insert(F);
       }
     }
   }
-
-  return EPS.find(F->getName()) != EPS.end();
 }
 
-std::string TranslateModule::getSourceFunctionName(llvm::Function *F) {
-  auto SS = DIF.subprograms();
-  for (auto i = SS.begin(), e = SS.end(); i != e; ++i) {
-    if ((*i)->describes(F)) {
-      return (*i)->getName();
-    }
-  }
-
-  return F->getName();
+bool TranslateModule::GPUEntryPointSet::isExplicit(
+    const llvm::Function *F) const {
+  return Names.find(F->getName()) != Names.end();
 }
 
 std::string TranslateModule::getCompositeName(ArrayRef<unsigned> Idxs,
@@ -720,7 +795,7 @@ std::string TranslateModule::getSourceGlobalArrayName(llvm::Value *V) {
   if (auto *Arg = dyn_cast<Argument>(V)) {
     F = Arg->getParent();
   } else if (auto *I = dyn_cast<Instruction>(V)) {
-    // The instructions created by TranslateFunction::extractStructArrays do
+    // The instructions created by TranslateModule::extractStructArrays do
     // not have a parent, so check for this before getting the parent function.
     F = I->getParent() != nullptr ? I->getFunction() : nullptr;
   }
@@ -754,53 +829,33 @@ std::string TranslateModule::getSourceGlobalArrayName(llvm::Value *V) {
       }
     }
 
-    auto *DILV = getSourceDbgVar(V, F);
+    auto *DILV = DebugInfo.getLocalVariable(V, F);
     DIType *DIT = DILV != nullptr ? DILV->getType().resolve() : nullptr;
 
-    return getSourceName(V, F) + getCompositeName(Idxs, DIT);
+    return DebugInfo.getSourceName(V, F) + getCompositeName(Idxs, DIT);
   } else if (F) {
-    return getSourceName(V, F);
+    return DebugInfo.getSourceName(V, F);
   } else {
     return V->getName();
   }
 }
 
-const llvm::DILocalVariable *
-TranslateModule::getSourceDbgVar(llvm::Value *V, llvm::Function *F) {
-  if (F->isDeclaration())
-    return nullptr;
-
-  for (const auto &BB : *F) {
-    for (const auto &I : BB) {
-      if (const auto *DVI = dyn_cast<DbgValueInst>(&I)) {
-        if (DVI->getValue() == V)
-          return DVI->getVariable();
-      } else if (const auto *DDI = dyn_cast<DbgDeclareInst>(&I)) {
-        if (DDI->getAddress() == V)
-          return DDI->getVariable();
-      }
-    }
-  }
-
-  return nullptr;
-}
-
-std::string TranslateModule::getSourceName(llvm::Value *V, llvm::Function *F) {
-  if (auto *DILV = getSourceDbgVar(V, F))
-    return DILV->getName();
-  else
-    return V->getName();
-}
-
 // Convert the given unmodelled expression E to modelled form.
 ref<Expr> TranslateModule::modelValue(Value *V, ref<Expr> E) {
+  recordModelUse(V);
   if (E->getType().isKind(Type::Pointer)) {
     auto OI = ModelPtrAsGlobalOffset.find(V);
     if (OI != ModelPtrAsGlobalOffset.end()) {
       auto GA = getGlobalArray(*OI->second.begin());
       auto Ofs = ArrayOffsetExpr::create(E);
       Ofs = Expr::createExactBVSDiv(Ofs, GA->getRangeType().width / 8);
-      assert(!Ofs.isNull() && "Couldn't create div this time!");
+      if (Ofs.isNull()) {
+        // The model was inferred up front and does not fit this value, so
+        // model the arrays as byte arrays in the next round.
+        for (auto A : OI->second)
+          requestByteArrayModel(A);
+        Ofs = BVConstExpr::createZero(TD.getPointerSizeInBits());
+      }
 
       if (OI->second.size() == 1 &&
           PtrMayBeNull.find(V) == PtrMayBeNull.end()) {
@@ -817,6 +872,7 @@ ref<Expr> TranslateModule::modelValue(Value *V, ref<Expr> E) {
 // If the given value is modelled, return its modelled type, else return
 // its conventional Boogie type (translateType).
 bugle::Type TranslateModule::getModelledType(Value *V) {
+  recordModelUse(V);
   auto OI = ModelPtrAsGlobalOffset.find(V);
   if (OI != ModelPtrAsGlobalOffset.end() && OI->second.size() == 1 &&
       PtrMayBeNull.find(V) == PtrMayBeNull.end()) {
@@ -832,6 +888,7 @@ bugle::Type TranslateModule::getModelledType(Value *V) {
 
 // Convert the given modelled expression E to unmodelled form.
 ref<Expr> TranslateModule::unmodelValue(Value *V, ref<Expr> E) {
+  recordModelUse(V);
   auto OI = ModelPtrAsGlobalOffset.find(V);
   if (OI != ModelPtrAsGlobalOffset.end()) {
     auto GA = getGlobalArray(*OI->second.begin());
@@ -841,13 +898,12 @@ ref<Expr> TranslateModule::unmodelValue(Value *V, ref<Expr> E) {
       return PointerExpr::create(GlobalArrayRefExpr::create(GA),
                                  BVMulExpr::create(E, WidthCst));
     } else {
-      std::set<GlobalArray *> Globals;
-      std::transform(OI->second.begin(), OI->second.end(),
-                     std::inserter(Globals, Globals.begin()),
-                     [&](Value *V) { return getGlobalArray(V); });
+      ArrayCandidates Globals;
+      for (auto i = OI->second.begin(), e = OI->second.end(); i != e; ++i)
+        Globals.insert(getGlobalArray(*i));
 
       if (PtrMayBeNull.find(V) != PtrMayBeNull.end())
-        Globals.insert((bugle::GlobalArray *)0);
+        Globals.insert(nullptr);
 
       auto AI = ArrayIdExpr::create(E, defaultRange());
       auto AMO = ArrayMemberOfExpr::create(AI, Globals);
@@ -864,6 +920,7 @@ ref<Expr> TranslateModule::unmodelValue(Value *V, ref<Expr> E) {
 /// of modelValue/getModelledType/unmodelValue use that model.
 void TranslateModule::computeValueModel(Value *Val, Var *Var,
                                         llvm::ArrayRef<ref<Expr>> Assigns) {
+  recordModelUse(Val);
   llvm::Type *VTy = Val->getType();
   if (auto F = dyn_cast<llvm::Function>(Val))
     VTy = F->getReturnType();
@@ -875,10 +932,10 @@ void TranslateModule::computeValueModel(Value *Val, Var *Var,
   if (ModelPtrAsGlobalOffset.find(Val) != ModelPtrAsGlobalOffset.end())
     return;
 
-  std::set<GlobalArray *> GlobalSet;
+  ArrayCandidates GlobalSet;
   for (auto ai = Assigns.begin(), ae = Assigns.end(); ai != ae; ++ai) {
-    if ((*ai)->computeArrayCandidates(GlobalSet))
-      continue;
+    if (auto Globals = (*ai)->getArrayCandidates())
+      GlobalSet.insert(*Globals);
     else
       return;
   }
@@ -903,15 +960,14 @@ void TranslateModule::computeValueModel(Value *Val, Var *Var,
     }
   }
 
-  // Remove null pointer candidates
-  auto null = (bugle::GlobalArray *)0;
-  if (GlobalSet.find(null) != GlobalSet.end()) {
+  StateLock Lock(StateMutex);
+
+  // Null pointer candidates are recorded separately
+  if (GlobalSet.hasNull())
     NextPtrMayBeNull.insert(Val);
-    GlobalSet.erase(GlobalSet.find(null));
-  }
 
   // If we only had null pointers, there is nothing to do
-  if (GlobalSet.size() == 0)
+  if (GlobalSet.begin() == GlobalSet.end())
     return;
 
   // Success! Record the global set.
@@ -922,45 +978,42 @@ void TranslateModule::computeValueModel(Value *Val, Var *Var,
   NeedAdditionalGlobalOffsetModels = true;
 
   if (ModelGlobalsAsByteArray) {
-    std::transform(GlobalSet.begin(), GlobalSet.end(),
-                   std::inserter(ModelAsByteArray, ModelAsByteArray.begin()),
-                   [&](GlobalArray *A) { return GlobalValueMap[A]; });
-    NeedAdditionalByteArrayModels = true;
+    for (auto A : GlobalSet)
+      requestByteArrayModel(GlobalValueMap[A]);
   }
 }
 
+// The functions that a call may call: the called function of a direct call,
+// or the candidates of the pointer type of an indirect call.
+std::vector<llvm::Function *>
+TranslateModule::getCallTargets(llvm::Type *T, llvm::Function *F) {
+  if (F)
+    return std::vector<llvm::Function *>(1, F);
+
+  auto TI = IndirectCallTargets.find(T);
+  if (TI == IndirectCallTargets.end())
+    ErrorReporter::reportFatalError("No functions for function pointer found");
+  return TI->second;
+}
+
 Stmt *TranslateModule::modelCallStmt(llvm::Type *T, llvm::Function *F,
                                      ref<Expr> Val,
                                      std::vector<ref<Expr>> &args,
                                      SourceLocsRef &sourcelocs) {
-  std::map<llvm::Function *, Function *> FS;
-
-  if (F) {
-    auto FI = FunctionMap.find(F);
-    assert(FI != FunctionMap.end() && "Couldn't find function in map!");
-    FS[F] = (FI->second);
-  } else {
-    for (auto i = FunctionMap.begin(), e = FunctionMap.end(); i != e; ++i) {
-      if (i->first->getType() == T && !i->second->isEntryPoint())
-        FS[i->first] = i->second;
-    }
-  }
-
   std::vector<Stmt *> CSS;
-  for (auto i = FS.begin(), e = FS.end(); i != e; ++i) {
+  for (auto CF : getCallTargets(T, F)) {
+    auto FI = FunctionMap.find(CF);
+    assert(FI != FunctionMap.end() && "Couldn't find function in map!");
     std::vector<ref<Expr>> fargs;
-    std::transform(args.begin(), args.end(), i->first->arg_begin(),
+    std::transform(args.begin(), args.end(), CF->arg_begin(),
                    std::back_inserter(fargs), [&](ref<Expr> E, Argument &Arg) {
       return modelValue(&Arg, E);
     });
-    auto CS = CallStmt::create(i->second, fargs, sourcelocs);
-    CallSites[i->first].push_back(&CS->getArgs());
+    auto CS = CallStmt::create(FI->second, fargs, sourcelocs);
+    CurrentTranslation->CallSites[CF].push_back(&CS->getArgs());
     CSS.push_back(CS);
   }
 
-  if (CSS.size() == 0)
-    ErrorReporter::reportFatalError("No functions for function pointer found");
-
   if (F)
     return *CSS.begin();
   else
@@ -970,102 +1023,462 @@ Stmt *TranslateModule::modelCallStmt(llvm::Type *T, llvm::Function *F,
 ref<Expr> TranslateModule::modelCallExpr(llvm::Type *T, llvm::Function *F,
                                          ref<Expr> Val,
                                          std::vector<ref<Expr>> &args) {
-  std::map<llvm::Function *, Function *> FS;
-
-  if (F) {
-    auto FI = FunctionMap.find(F);
-    assert(FI != FunctionMap.end() && "Couldn't find function in map!");
-    FS[F] = (FI->second);
-  } else {
-    for (auto i = FunctionMap.begin(), e = FunctionMap.end(); i != e; ++i)
-      if (i->first->getType() == T && !i->second->isEntryPoint())
-        FS[i->first] = i->second;
-  }
-
   std::vector<ref<Expr>> CES;
-  for (auto i = FS.begin(), e = FS.end(); i != e; ++i) {
+  for (auto CF : getCallTargets(T, F)) {
+    auto FI = FunctionMap.find(CF);
+    assert(FI != FunctionMap.end() && "Couldn't find function in map!");
     std::vector<ref<Expr>> fargs;
-    std::transform(args.begin(), args.end(), i->first->arg_begin(),
+    std::transform(args.begin(), args.end(), CF->arg_begin(),
                    std::back_inserter(fargs), [&](ref<Expr> E, Argument &Arg) {
       return modelValue(&Arg, E);
     });
-    ref<Expr> E = CallExpr::create(i->second, fargs);
+    ref<Expr> E = CallExpr::create(FI->second, fargs);
     auto CE = dyn_cast<CallExpr>(E);
-    CallSites[i->first].push_back(&CE->getArgs());
+    CurrentTranslation->CallSites[CF].push_back(&CE->getArgs());
     CES.push_back(CE);
   }
 
-  if (CES.size() == 0)
-    ErrorReporter::reportFatalError("No functions for function pointer found");
-
   if (F)
     return *CES.begin();
   else
     return CallMemberOfExpr::create(Val, CES);
 }
 
-void TranslateModule::translate() {
-  do {
-    NeedAdditionalByteArrayModels = false;
-    NeedAdditionalGlobalOffsetModels = false;
+// Discard the translations of all functions and start afresh.
+void TranslateModule::resetModule() {
+  delete BM;
+  BM = new bugle::Module;
 
-    delete BM;
-    BM = new bugle::Module;
+  for (auto i = AuxiliaryFunctions.begin(), e = AuxiliaryFunctions.end();
+       i != e; ++i) {
+    for (auto AF : i->second)
+      delete AF;
+  }
 
-    FunctionMap.clear();
-    ConstantMap.clear();
-    GlobalValueMap.clear();
-    ValueGlobalMap.clear();
-    CallSites.clear();
+  FunctionMap.clear();
+  IndirectCallTargets.clear();
+  ConstantMap.clear();
+  GlobalValueMap.clear();
+  ValueGlobalMap.clear();
+  CallSites.clear();
+  FunctionModelUses.clear();
+  ConstantModelUses.clear();
+  AuxiliaryFunctions.clear();
+  Axioms.clear();
+  RequestedByteArrayModels.clear();
+  RequestedCaseSplit.clear();
+
+  BM->setPointerWidth(TD.getPointerSizeInBits());
+
+  for (auto i = M->begin(), e = M->end(); i != e; ++i) {
+    if (i->isIntrinsic() ||
+        TranslateFunction::isAxiomFunction(i->getName()) ||
+        TranslateFunction::isSpecialFunction(SL, i->getName()))
+      continue;
 
-    BM->setPointerWidth(TD.getPointerSizeInBits());
+    FunctionMap[&*i] =
+        BM->addFunction(i->getName(), DebugInfo.getSourceFunctionName(&*i));
 
-    for (auto i = M->begin(), e = M->end(); i != e; ++i) {
-      if (TranslateFunction::isUninterpretedFunction(i->getName())) {
-        TranslateFunction::addUninterpretedFunction(SL, i->getName());
-      }
+    // A function can only be called indirectly if its address escapes, that
+    // is, if it is used other than as the callee of a call: stored, passed
+    // as an argument or part of a constant initializer.
+    if (i->hasAddressTaken() && !EntryPoints.contains(&*i) &&
+        !TranslateFunction::isStandardEntryPoint(SL, i->getName()))
+      IndirectCallTargets[i->getType()].push_back(&*i);
+  }
+}
 
-      if (i->isIntrinsic() ||
-          TranslateFunction::isAxiomFunction(i->getName()) ||
-          TranslateFunction::isSpecialFunction(SL, i->getName()))
-        continue;
+// Discard the translations that depend on the models of the values in
+// Changed, and return the functions that need to be retranslated.
+std::set<llvm::Function *>
+TranslateModule::invalidateModels(const std::set<Value *> &Changed) {
+  std::set<Value *> Stale(Changed);
+
+  // Global arrays are updated in place, such that references to them from
+  // the functions we keep remain valid.
+  for (auto i = ValueGlobalMap.begin(), e = ValueGlobalMap.end(); i != e;
+       ++i) {
+    Type T = getGlobalArrayRangeType(i->first);
+    if (T != i->second->getRangeType()) {
+      i->second->setRangeType(T);
+      Stale.insert(i->first);
+    }
+  }
+
+  auto IsStale = [&](const std::set<Value *> &Uses) {
+    return std::any_of(Uses.begin(), Uses.end(),
+                       [&](Value *V) { return Stale.count(V) != 0; });
+  };
+
+  for (auto i = ConstantMap.begin(), e = ConstantMap.end(); i != e;) {
+    if (!IsStale(ConstantModelUses[i->first])) {
+      ++i;
+      continue;
+    }
+
+    // The initializer is added again when the variable is retranslated.
+    if (auto GV = dyn_cast<GlobalVariable>(i->first)) {
+      auto GI = ValueGlobalMap.find(GV);
+      if (GI != ValueGlobalMap.end())
+        BM->removeGlobalInits(GI->second);
+    }
+    ConstantModelUses.erase(i->first);
+    i = ConstantMap.erase(i);
+  }
+
+  std::set<llvm::Function *> Retranslate(RequestedByteArrayModels);
+  // The requests for case splits are forgotten if new global offset models
+  // were found, so the functions making them need to be retranslated.
+  if (!NextModelAllAsByteArray)
+    Retranslate.insert(RequestedCaseSplit.begin(), RequestedCaseSplit.end());
+  for (auto i = FunctionModelUses.begin(), e = FunctionModelUses.end();
+       i != e; ++i) {
+    if (IsStale(i->second))
+      Retranslate.insert(i->first);
+  }
+
+  for (auto F : Retranslate) {
+    FunctionModelUses.erase(F);
+    CallSites.erase(F);
+    Axioms.erase(F);
+    RequestedByteArrayModels.erase(F);
+    RequestedCaseSplit.erase(F);
+
+    auto FI = FunctionMap.find(F);
+    if (FI != FunctionMap.end())
+      FI->second->clear();
+
+    auto &AFS = AuxiliaryFunctions[F];
+    for (auto AF : AFS)
+      delete AF;
+    AuxiliaryFunctions.erase(F);
+  }
+
+  // Arrays created for calls, such as samplers, have their initializers
+  // added by the function making the call.
+  for (auto i = ValueGlobalMap.begin(), e = ValueGlobalMap.end(); i != e;
+       ++i) {
+    if (auto I = dyn_cast<Instruction>(i->first)) {
+      if (I->getParent() && Retranslate.count(I->getParent()->getParent()))
+        BM->removeGlobalInits(i->second);
+    }
+  }
+
+  return Retranslate;
+}
+
+void TranslateModule::requestByteArrayModel(Value *V) {
+  if (auto FT = CurrentTranslation) {
+    // The request only takes effect in the next round, such that the models
+    // used in a round do not depend on the order in which its functions are
+    // translated.
+    FT->NeedAdditionalByteArrayModels = true;
+    FT->ByteArrayModels.insert(V);
+  } else {
+    NeedAdditionalByteArrayModels = true;
+    ModelAsByteArray.insert(V);
+  }
+}
+
+// Request that the arrays to which the pointers or array identifiers PtrArrs
+// may refer are modelled as byte arrays, or that all arrays are if these
+// arrays are not known.
+void TranslateModule::requestByteArrayModels(ArrayRef<ref<Expr>> PtrArrs) {
+  CurrentTranslation->NeedAdditionalByteArrayModels = true;
+  ArrayCandidates Globals;
+  for (auto i = PtrArrs.begin(), e = PtrArrs.end(); i != e; ++i) {
+    auto PtrArrGlobals = (*i)->getArrayCandidates();
+    if (!PtrArrGlobals) {
+      requestAllByteArrayModels();
+      return;
+    }
+    Globals.insert(*PtrArrGlobals);
+  }
+
+  StateLock Lock(StateMutex);
+  for (auto A : Globals)
+    requestByteArrayModel(GlobalValueMap[A]);
+}
+
+void TranslateModule::requestAllByteArrayModels() {
+  CurrentTranslation->NextModelAllAsByteArray = true;
+}
+
+// Create an auxiliary function of the function being translated. It is only
+// added to the module once the fixed point is reached.
+bugle::Function *
+TranslateModule::addAuxiliaryFunction(const std::string &Name,
+                                      const std::string &SourceName) {
+  auto AF = new bugle::Function(Name, SourceName);
+  CurrentTranslation->AuxiliaryFunctions.push_back(AF);
+  return AF;
+}
+
+void TranslateModule::extractStructArrays(
+    llvm::Value *V, std::vector<llvm::Instruction *> *SV) {
+  auto STy = cast<StructType>(V->getType());
+  auto Name = (V->getName() + ".coerce").str();
+  for (unsigned i = 0; i < STy->getNumElements(); ++i) {
+    auto Index = ArrayRef<unsigned>(i);
+    auto E = ExtractValueInst::Create(V, Index, Name + Twine(i));
+    SV->push_back(E);
+    if (E->getType()->isStructTy())
+      extractStructArrays(E, SV);
+  }
+}
+
+// Get the values of the struct members of the arguments of F, creating them
+// on first use.
+std::vector<llvm::Instruction *> *
+TranslateModule::getStructArrays(llvm::Function *F) {
+  StateLock Lock(StateMutex);
+  std::vector<llvm::Instruction *> *&SV = StructMap[F];
+  if (!SV) {
+    SV = new std::vector<llvm::Instruction *>();
+    for (auto i = F->arg_begin(), e = F->arg_end(); i != e; ++i) {
+      if (i->getType()->isStructTy())
+        extractStructArrays(&*i, SV);
+    }
+  }
+  return SV;
+}
+
+// Set up the translation of a function. This creates everything that other
+// functions may refer to, such that it exists whichever function is
+// translated first.
+void TranslateModule::prepareFunction(FunctionTranslation &FT) {
+  llvm::Function *F = FT.F;
+  FT.ModelUses = &FunctionModelUses[F];
+  if (TranslateFunction::isAxiomFunction(F->getName()))
+    return;
+
+  CurrentTranslation = &FT;
+  auto ResetCurrent = make_scope_exit([] { CurrentTranslation = nullptr; });
+  auto BF = FunctionMap[F];
+  FT.IsGPUEntryPoint = EntryPoints.contains(F);
+  BF->setEntryPoint(FT.IsGPUEntryPoint ||
+                    TranslateFunction::isStandardEntryPoint(SL, F->getName()));
+
+  // Calls to the function refer to its return variable.
+  auto RT = F->getFunctionType()->getReturnType();
+  if (!RT->isVoidTy())
+    BF->addReturn(getModelledType(F), "ret");
+
+  // The arrays of the parameters of an entry point are first created as
+  // parameters, even if another function refers to them first.
+  if (FT.IsGPUEntryPoint) {
+    for (auto i = F->arg_begin(), e = F->arg_end(); i != e; ++i) {
+      if (i->getType()->isPointerTy() &&
+          !i->getType()->getPointerElementType()->isFunctionTy())
+        getGlobalArray(&*i, /*IsParameter=*/true);
+    }
+  }
+}
+
+void TranslateModule::translateFunction(FunctionTranslation &FT) {
+  llvm::Function *F = FT.F;
+  CurrentTranslation = &FT;
+  auto ResetCurrent = make_scope_exit([] { CurrentTranslation = nullptr; });
+
+  if (TranslateFunction::isAxiomFunction(F->getName())) {
+    bugle::Function BF("", "");
+    Type RT = translateType(F->getFunctionType()->getReturnType());
+    Var *RV = BF.addReturn(RT, "ret");
+    TranslateFunction TF(this, &BF, F, false);
+    TF.translate();
+    assert(BF.begin() + 1 == BF.end() && "Expected one basic block");
+    bugle::BasicBlock *BB = *BF.begin();
+    VarAssignStmt *S = cast<VarAssignStmt>(*(BB->end() - 2));
+    assert(S->getVars()[0] == RV); (void)RV;
+    FT.Axiom = Expr::createNeZero(S->getValues()[0]);
+  } else {
+    auto BF = FunctionMap.find(F)->second;
+    TranslateFunction TF(this, BF, F, FT.IsGPUEntryPoint);
+    TF.translate();
+  }
+
+  CurrentTranslation = nullptr;
+
+  if (Statistics::isEnabled())
+    Statistics::add("function-translations");
+}
+
+// Merge what the translation of a function recorded into the module.
+void TranslateModule::finishFunction(FunctionTranslation &FT) {
+  llvm::Function *F = FT.F;
 
-      auto BF = FunctionMap[&*i] =
-          BM->addFunction(i->getName(), getSourceFunctionName(&*i));
+  // Record which functions ask for another round, as these requests need to
+  // be made again in later rounds.
+  if (FT.NeedAdditionalByteArrayModels) {
+    RequestedByteArrayModels.insert(F);
+    NeedAdditionalByteArrayModels = true;
+    ModelAsByteArray.insert(FT.ByteArrayModels.begin(),
+                            FT.ByteArrayModels.end());
+  }
+  if (FT.NextModelAllAsByteArray) {
+    RequestedCaseSplit.insert(F);
+    NextModelAllAsByteArray = true;
+  }
+
+  CallSites[F] = FT.CallSites;
+  AuxiliaryFunctions[F] = FT.AuxiliaryFunctions;
+  if (!FT.Axiom.isNull())
+    Axioms[F] = FT.Axiom;
+
+  if (FT.Stats)
+    Statistics::merge(*FT.Stats);
+}
+
+// Translate the functions Fs, on multiple threads if so requested.
+void TranslateModule::translateFunctions(
+    const std::vector<llvm::Function *> &Fs) {
+  std::vector<FunctionTranslation> FTs(Fs.begin(), Fs.end());
+  for (auto &FT : FTs)
+    prepareFunction(FT);
+
+  unsigned NumThreads = FunctionThreads;
+  if (NumThreads == 0)
+    NumThreads = heavyweight_hardware_concurrency();
+
+  if (NumThreads <= 1 || FTs.size() <= 1) {
+    for (auto &FT : FTs)
+      translateFunction(FT);
+  } else {
+    // An error on a worker is reported there, and ends the process at once;
+    // see ErrorReporter::terminate.
+    std::string FileName = ErrorReporter::getFileName();
+    const ExprRewriter *Rewriter = ExprRewriter::getCurrent();
+    RefCount::ThreadedScope Threaded;
+    ThreadPool Pool(std::min<size_t>(NumThreads, FTs.size()));
+    for (unsigned i = 0, e = FTs.size(); i != e; ++i) {
+      Pool.async([&, i]() {
+        ErrorReporter::setFileName(FileName);
+        ExprRewriter::Scope RewriteScope(Rewriter);
+        translateFunction(FTs[i]);
+        if (Statistics::isEnabled())
+          FTs[i].Stats = Statistics::take();
+      });
+    }
+    Pool.wait();
+  }
 
-      auto RT = i->getFunctionType()->getReturnType();
-      if (!RT->isVoidTy())
-        BF->addReturn(getModelledType(&*i), "ret");
+  for (auto &FT : FTs)
+    finishFunction(FT);
+}
+
+// Add the parts of the translation that were held back until the fixed point
+// was reached, and give the global arrays an order and names that do not
+// depend on the order in which the functions were translated.
+void TranslateModule::finishModule() {
+  for (auto i = M->begin(), e = M->end(); i != e; ++i) {
+    auto AI = Axioms.find(&*i);
+    if (AI != Axioms.end())
+      BM->addAxiom(AI->second);
+
+    auto FI = AuxiliaryFunctions.find(&*i);
+    if (FI != AuxiliaryFunctions.end()) {
+      for (auto AF : FI->second)
+        BM->adoptFunction(AF);
+    }
+  }
+  AuxiliaryFunctions.clear();
+
+  std::map<Value *, unsigned> Order;
+  unsigned N = 0;
+  for (auto i = M->global_begin(), e = M->global_end(); i != e; ++i)
+    Order[&*i] = N++;
+  for (auto i = M->begin(), e = M->end(); i != e; ++i) {
+    for (auto ai = i->arg_begin(), ae = i->arg_end(); ai != ae; ++ai)
+      Order[&*ai] = N++;
+    for (auto ii = inst_begin(&*i), ie = inst_end(&*i); ii != ie; ++ii)
+      Order[&*ii] = N++;
+    auto SI = StructMap.find(&*i);
+    if (SI != StructMap.end() && SI->second) {
+      for (auto I : *SI->second)
+        Order[I] = N++;
     }
+  }
+
+  BM->sortGlobals(
+      [&](GlobalArray *L, GlobalArray *R) {
+        return Order[GlobalValueMap[L]] < Order[GlobalValueMap[R]];
+      },
+      [&](GlobalArray *GA) { return GlobalValueMap[GA]->getName(); });
+}
+
+// Write what the pointer models depend on besides the module itself.
+void TranslateModule::writeModelKey(raw_ostream &OS) {
+  OS << ModelsStamp << "\n"
+     << (unsigned)SL << " " << AddressSpaces.global << " "
+     << AddressSpaces.group_shared << " " << AddressSpaces.constant << " "
+     << ModelBVAsByteArray << " " << ModelMixedWidthArrays << "\n";
+  for (auto i = GPUEntryPoints.begin(), e = GPUEntryPoints.end(); i != e; ++i)
+    OS << "k " << *i << "\n";
+}
+
+void TranslateModule::translate() {
+  std::unique_ptr<PointerModelFile> MF;
+  bool LoadedModels = false;
+  if (!ModelsFile.empty()) {
+    TimeTraceScope Scope("Load pointer models");
+    MF.reset(new PointerModelFile(this, ModelsFile));
+    LoadedModels = MF->load();
+  }
 
+  if (!LoadedModels) {
+    TimeTraceScope Scope("Infer pointer models");
+    PointerModelInference(this).infer();
+  }
+
+  // Compute the layouts of all structures up front, as DataLayout caches them
+  // without synchronization and functions may be translated concurrently.
+  TypeFinder StructTypes;
+  StructTypes.run(*M, /*onlyNamed=*/false);
+  for (auto ST : StructTypes) {
+    if (!ST->isOpaque() && ST->isSized())
+      TD.getStructLayout(ST);
+  }
+
+  unsigned Round = 0;
+  bool TranslateAll = true;
+  std::set<llvm::Function *> Retranslate;
+  do {
+    TimeTraceScope Scope("Fixpoint round", std::to_string(++Round));
+    NeedAdditionalByteArrayModels = false;
+    NeedAdditionalGlobalOffsetModels = false;
+
+    if (TranslateAll)
+      resetModule();
+
+    std::vector<llvm::Function *> Fs;
     for (auto i = M->begin(), e = M->end(); i != e; ++i) {
       if (i->isIntrinsic())
         continue;
 
-      if (TranslateFunction::isAxiomFunction(i->getName())) {
-        bugle::Function F("", "");
-        Type RT = translateType(i->getFunctionType()->getReturnType());
-        Var *RV = F.addReturn(RT, "ret");
-        TranslateFunction TF(this, &F, &*i, false);
-        TF.translate();
-        assert(F.begin() + 1 == F.end() && "Expected one basic block");
-        bugle::BasicBlock *BB = *F.begin();
-        VarAssignStmt *S = cast<VarAssignStmt>(*(BB->end() - 2));
-        assert(S->getVars()[0] == RV); (void)RV;
-        BM->addAxiom(Expr::createNeZero(S->getValues()[0]));
-      } else if (!TranslateFunction::isSpecialFunction(SL, i->getName())) {
-        bool EP = isGPUEntryPoint(&*i, M, SL, GPUEntryPoints);
-        TranslateFunction TF(this, FunctionMap[&*i], &*i, EP);
-        TF.translate();
-      }
+      if (!TranslateFunction::isAxiomFunction(i->getName()) &&
+          TranslateFunction::isSpecialFunction(SL, i->getName()))
+        continue;
+
+      if (TranslateAll || Retranslate.count(&*i))
+        Fs.push_back(&*i);
     }
+    translateFunctions(Fs);
 
     // If this round gave us a case split, examine each pointer argument to
     // each call site for each function to see if the argument always refers to
     // the same global array, in which case we can model the parameter as an
     // offset, and potentially avoid the case split.
     if (!ModelAllAsByteArray && NextModelAllAsByteArray) {
+      CallSiteMap Calls;
       for (auto i = CallSites.begin(), e = CallSites.end(); i != e; ++i) {
+        for (auto ci = i->second.begin(), ce = i->second.end(); ci != ce;
+             ++ci) {
+          auto &CS = Calls[ci->first];
+          CS.insert(CS.end(), ci->second.begin(), ci->second.end());
+        }
+      }
+
+      for (auto i = Calls.begin(), e = Calls.end(); i != e; ++i) {
         unsigned pidx = 0;
         for (auto pi = i->first->arg_begin(), pe = i->first->arg_end();
              pi != pe; ++pi, ++pidx) {
@@ -1078,6 +1491,15 @@ void TranslateModule::translate() {
       }
     }
 
+    // The models used by the last round are saved before they are updated,
+    // as the last round may still record models that it did not use.
+    if (MF && !NeedAdditionalByteArrayModels &&
+        !NeedAdditionalGlobalOffsetModels) {
+      TimeTraceScope Scope("Save pointer models");
+      MF->save();
+    }
+
+    bool PrevModelAllAsByteArray = ModelAllAsByteArray;
     if (NeedAdditionalGlobalOffsetModels) {
       // If we can model new pointers using global offsets, a previously
       // observed case split may become unnecessary.  So when we recompute the
@@ -1088,7 +1510,41 @@ void TranslateModule::translate() {
       ModelAllAsByteArray = NextModelAllAsByteArray;
     }
 
+    std::set<Value *> Changed;
+    for (auto i = NextModelPtrAsGlobalOffset.begin(),
+              e = NextModelPtrAsGlobalOffset.end();
+         i != e; ++i) {
+      auto OI = ModelPtrAsGlobalOffset.find(i->first);
+      if (OI == ModelPtrAsGlobalOffset.end() || OI->second != i->second)
+        Changed.insert(i->first);
+    }
+    std::set_difference(NextPtrMayBeNull.begin(), NextPtrMayBeNull.end(),
+                        PtrMayBeNull.begin(), PtrMayBeNull.end(),
+                        std::inserter(Changed, Changed.begin()));
+
     ModelPtrAsGlobalOffset = NextModelPtrAsGlobalOffset;
     PtrMayBeNull = NextPtrMayBeNull;
+
+    if (Statistics::isEnabled()) {
+      Statistics::add("fixpoint-rounds");
+      // The inferred models did not suffice, so another round is needed.
+      if (NeedAdditionalByteArrayModels || NeedAdditionalGlobalOffsetModels)
+        Statistics::add("fixpoint-fallback-rounds");
+      if (NeedAdditionalByteArrayModels)
+        Statistics::append("fixpoint-reruns", "NeedAdditionalByteArrayModels");
+      if (NeedAdditionalGlobalOffsetModels)
+        Statistics::append("fixpoint-reruns",
+                           "NeedAdditionalGlobalOffsetModels");
+    }
+
+    // Changing whether everything is modelled as a byte array affects every
+    // function. Otherwise, only retranslate the functions whose models
+    // changed.
+    TranslateAll = ModelAllAsByteArray != PrevModelAllAsByteArray;
+    if (!TranslateAll &&
+        (NeedAdditionalByteArrayModels || NeedAdditionalGlobalOffsetModels))
+      Retranslate = invalidateModels(Changed);
   } while (NeedAdditionalByteArrayModels || NeedAdditionalGlobalOffsetModels);
+
+  finishModule();
 }
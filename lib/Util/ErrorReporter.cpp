@@ -1,14 +1,23 @@
 #include "bugle/util/ErrorReporter.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstdlib>
+#include <mutex>
 #include <string>
+#include <thread>
 
 using namespace bugle;
 using namespace llvm;
 
-std::string ErrorReporter::FileName;
+// The file name is per thread, as multiple inputs may be translated
+// concurrently; the lock keeps their messages from interleaving.
+thread_local std::string ErrorReporter::FileName;
+static std::mutex OutputMutex;
+
+// The thread that runs the static initialisers, that is, the main thread.
+static const std::thread::id MainThread = std::this_thread::get_id();
 
 void ErrorReporter::printErrorMsg(const std::string &msg) {
+  std::lock_guard<std::mutex> Lock(OutputMutex);
   errs() << FileName << ": ";
   if (errs().has_colors())
     errs().changeColor(raw_ostream::Colors::RED);
@@ -18,6 +27,12 @@ void ErrorReporter::printErrorMsg(const std::string &msg) {
   errs() << " " << msg << "\n";
 }
 
+void ErrorReporter::terminate() {
+  if (std::this_thread::get_id() != MainThread)
+    std::_Exit(1);
+  std::exit(1);
+}
+
 void ErrorReporter::setFileName(const std::string &FN) {
   std::string::size_type pos = FN.find_last_of("\\/");
 
@@ -28,6 +43,7 @@ void ErrorReporter::setFileName(const std::string &FN) {
 }
 
 void ErrorReporter::emitWarning(const std::string &msg) {
+  std::lock_guard<std::mutex> Lock(OutputMutex);
   errs() << FileName << ": ";
   if (errs().has_colors())
     errs().changeColor(raw_ostream::Colors::MAGENTA);
@@ -38,23 +54,29 @@ void ErrorReporter::emitWarning(const std::string &msg) {
 }
 
 void ErrorReporter::reportParameterError(const std::string &msg) {
-  if (errs().has_colors())
-    errs().changeColor(raw_ostream::Colors::RED);
-  errs() << "error:";
-  if (errs().has_colors())
-    errs().resetColor();
-  errs() << " " << msg << "\n";
-  std::exit(1);
+  {
+    std::lock_guard<std::mutex> Lock(OutputMutex);
+    if (errs().has_colors())
+      errs().changeColor(raw_ostream::Colors::RED);
+    errs() << "error:";
+    if (errs().has_colors())
+      errs().resetColor();
+    errs() << " " << msg << "\n";
+  }
+  terminate();
 }
 
 void ErrorReporter::reportFatalError(const std::string &msg) {
   printErrorMsg(msg);
-  std::exit(1);
+  terminate();
 }
 
 void ErrorReporter::reportImplementationLimitation(const std::string &msg) {
   printErrorMsg(msg);
-  errs() << "Please contact the developers;"
-         << " this is an implementation limitation\n";
-  std::exit(1);
+  {
+    std::lock_guard<std::mutex> Lock(OutputMutex);
+    errs() << "Please contact the developers;"
+           << " this is an implementation limitation\n";
+  }
+  terminate();
 }
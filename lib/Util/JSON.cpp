@@ -0,0 +1,19 @@
+#include "bugle/util/JSON.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+void bugle::writeJSONString(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (auto i = S.begin(), e = S.end(); i != e; ++i) {
+    unsigned char c = *i;
+    if (c == '"' || c == '\\')
+      OS << '\\' << c;
+    else if (c < 0x20)
+      OS << format("\\u%04x", c);
+    else
+      OS << c;
+  }
+  OS << '"';
+}
@@ -0,0 +1,135 @@
+#include "bugle/util/Statistics.h"
+#include "bugle/util/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+#include <map>
+#include <vector>
+
+using namespace bugle;
+using namespace llvm;
+
+namespace bugle {
+
+// Ordered maps keep the output stable between runs.
+struct StatisticsData {
+  struct Gauge {
+    int64_t Value, Peak;
+  };
+
+  std::map<std::string, uint64_t> Counters;
+  std::map<std::string, std::map<std::string, uint64_t>> Groups;
+  std::map<std::string, Gauge> Gauges;
+  std::map<std::string, std::vector<std::string>> Lists;
+};
+}
+
+namespace {
+
+thread_local StatisticsData Data;
+}
+
+bool Statistics::Enabled = false;
+
+void Statistics::reset() {
+  Data.Counters.clear();
+  Data.Groups.clear();
+  Data.Lists.clear();
+  // Gauges track quantities that outlive a translation, so only their peaks
+  // are reset.
+  for (auto i = Data.Gauges.begin(), e = Data.Gauges.end(); i != e; ++i)
+    i->second.Peak = i->second.Value;
+}
+
+void Statistics::add(StringRef Name, uint64_t Amount) {
+  Data.Counters[Name.str()] += Amount;
+}
+
+void Statistics::add(StringRef Name, StringRef Key, uint64_t Amount) {
+  Data.Groups[Name.str()][Key.str()] += Amount;
+}
+
+void Statistics::adjust(StringRef Name, int64_t Delta) {
+  auto &G = Data.Gauges[Name.str()];
+  G.Value += Delta;
+  if (G.Value > G.Peak)
+    G.Peak = G.Value;
+}
+
+void Statistics::append(StringRef Name, StringRef Value) {
+  Data.Lists[Name.str()].push_back(Value.str());
+}
+
+std::shared_ptr<StatisticsData> Statistics::take() {
+  auto Taken = std::make_shared<StatisticsData>();
+  std::swap(*Taken, Data);
+  return Taken;
+}
+
+void Statistics::merge(const StatisticsData &Other) {
+  for (auto i = Other.Counters.begin(), e = Other.Counters.end(); i != e; ++i)
+    Data.Counters[i->first] += i->second;
+
+  for (auto i = Other.Groups.begin(), e = Other.Groups.end(); i != e; ++i) {
+    auto &G = Data.Groups[i->first];
+    for (auto gi = i->second.begin(), ge = i->second.end(); gi != ge; ++gi)
+      G[gi->first] += gi->second;
+  }
+
+  // The other thread is taken to have run after the work of this thread, so
+  // its peaks are relative to the current values.
+  for (auto i = Other.Gauges.begin(), e = Other.Gauges.end(); i != e; ++i) {
+    auto &G = Data.Gauges[i->first];
+    if (G.Value + i->second.Peak > G.Peak)
+      G.Peak = G.Value + i->second.Peak;
+    G.Value += i->second.Value;
+  }
+
+  for (auto i = Other.Lists.begin(), e = Other.Lists.end(); i != e; ++i) {
+    auto &L = Data.Lists[i->first];
+    L.insert(L.end(), i->second.begin(), i->second.end());
+  }
+}
+
+void Statistics::write(raw_ostream &OS) {
+  bool First = true;
+  auto writeKey = [&](StringRef Key) {
+    OS << (First ? "{\n" : ",\n") << "  ";
+    writeJSONString(OS, Key);
+    OS << ": ";
+    First = false;
+  };
+
+  for (auto i = Data.Counters.begin(), e = Data.Counters.end(); i != e; ++i) {
+    writeKey(i->first);
+    OS << i->second;
+  }
+
+  for (auto i = Data.Gauges.begin(), e = Data.Gauges.end(); i != e; ++i) {
+    writeKey(i->first + "-peak");
+    OS << i->second.Peak;
+  }
+
+  for (auto i = Data.Groups.begin(), e = Data.Groups.end(); i != e; ++i) {
+    writeKey(i->first);
+    OS << "{";
+    for (auto b = i->second.begin(), gi = b, ge = i->second.end(); gi != ge;
+         ++gi) {
+      OS << (gi == b ? "" : ", ");
+      writeJSONString(OS, gi->first);
+      OS << ": " << gi->second;
+    }
+    OS << "}";
+  }
+
+  for (auto i = Data.Lists.begin(), e = Data.Lists.end(); i != e; ++i) {
+    writeKey(i->first);
+    OS << "[";
+    for (auto b = i->second.begin(), li = b, le = i->second.end(); li != le;
+         ++li) {
+      OS << (li == b ? "" : ", ");
+      writeJSONString(OS, *li);
+    }
+    OS << "]";
+  }
+
+  OS << (First ? "{}" : "\n}");
+}
@@ -0,0 +1,148 @@
+#include "bugle/util/TimeTrace.h"
+#include "bugle/util/JSON.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#ifdef LLVM_ON_UNIX
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+using namespace bugle;
+using namespace llvm;
+
+namespace {
+
+struct Span {
+  std::string Name, Detail;
+  TimeTrace::Clock::time_point Start, End;
+  unsigned ThreadId;
+  uint64_t RSSGrowth;
+};
+
+std::mutex SpansMutex;
+std::vector<Span> Spans;
+std::vector<std::string> ChildEvents;
+TimeTrace::Clock::time_point TraceStart;
+
+// Small, stable thread identifiers make the trace easier to read than the
+// system's thread identifiers.
+std::atomic<unsigned> NextThreadId(0);
+thread_local unsigned ThreadId = NextThreadId++;
+
+uint64_t toMicroseconds(TimeTrace::Clock::duration D) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(D).count();
+}
+
+#ifdef LLVM_ON_UNIX
+// Returns the peak resident set size in kilobytes of this process if Who is
+// RUSAGE_SELF, or of the largest of its children that have ended if Who is
+// RUSAGE_CHILDREN, or 0 if it is not known.
+uint64_t getPeakRSSOf(int Who) {
+  struct rusage Usage;
+  if (getrusage(Who, &Usage) != 0)
+    return 0;
+#ifdef __APPLE__
+  return Usage.ru_maxrss / 1024;
+#else
+  return Usage.ru_maxrss;
+#endif
+}
+#endif
+
+// Processes translating in parallel are shown separately.
+unsigned getProcessId() {
+#ifdef LLVM_ON_UNIX
+  return getpid();
+#else
+  return 1;
+#endif
+}
+}
+
+bool TimeTrace::Enabled = false;
+
+void TimeTrace::enable() {
+  TraceStart = Clock::now();
+  Enabled = true;
+}
+
+uint64_t TimeTrace::getPeakRSS() {
+#ifdef LLVM_ON_UNIX
+  return getPeakRSSOf(RUSAGE_SELF);
+#else
+  return 0;
+#endif
+}
+
+void TimeTrace::addSpan(StringRef Name, StringRef Detail,
+                        Clock::time_point Start, Clock::time_point End,
+                        uint64_t StartPeakRSS) {
+  // The peak is that of the whole process, so the growth during a span also
+  // covers the work of other threads at the time.
+  uint64_t EndPeakRSS = getPeakRSS();
+  uint64_t RSSGrowth =
+      EndPeakRSS > StartPeakRSS ? EndPeakRSS - StartPeakRSS : 0;
+  Span S = {Name.str(), Detail.str(), Start, End, ThreadId, RSSGrowth};
+  std::lock_guard<std::mutex> Lock(SpansMutex);
+  Spans.push_back(S);
+}
+
+void TimeTrace::reset() {
+  std::lock_guard<std::mutex> Lock(SpansMutex);
+  Spans.clear();
+  ChildEvents.clear();
+}
+
+void TimeTrace::writeEvents(raw_ostream &OS) {
+  std::lock_guard<std::mutex> Lock(SpansMutex);
+  unsigned Pid = getProcessId();
+  for (auto b = Spans.begin(), i = b, e = Spans.end(); i != e; ++i) {
+    if (i != b)
+      OS << ",";
+    OS << "\n{\"ph\":\"X\",\"pid\":" << Pid << ",\"tid\":" << i->ThreadId
+       << ",\"ts\":" << toMicroseconds(i->Start - TraceStart)
+       << ",\"dur\":" << toMicroseconds(i->End - i->Start) << ",\"name\":";
+    writeJSONString(OS, i->Name);
+    if (!i->Detail.empty() || i->RSSGrowth != 0) {
+      OS << ",\"args\":{";
+      if (!i->Detail.empty()) {
+        OS << "\"detail\":";
+        writeJSONString(OS, i->Detail);
+      }
+      if (i->RSSGrowth != 0)
+        OS << (i->Detail.empty() ? "" : ",") << "\"rss-growth-kb\":"
+           << i->RSSGrowth;
+      OS << "}";
+    }
+    OS << "}";
+  }
+  for (auto i = ChildEvents.begin(), e = ChildEvents.end(); i != e; ++i)
+    OS << (Spans.empty() && i == ChildEvents.begin() ? "" : ",") << *i;
+}
+
+void TimeTrace::addEvents(StringRef Events) {
+  if (Events.empty())
+    return;
+  std::lock_guard<std::mutex> Lock(SpansMutex);
+  ChildEvents.push_back(Events.str());
+}
+
+void TimeTrace::write(raw_ostream &OS) {
+  OS << "{\"traceEvents\":[";
+  writeEvents(OS);
+  OS << "\n],\"displayTimeUnit\":\"ms\"";
+#ifdef LLVM_ON_UNIX
+  // Inputs and requests are translated in child processes, which have all
+  // ended by the time the trace is written.
+  uint64_t PeakRSS =
+      std::max(getPeakRSSOf(RUSAGE_SELF), getPeakRSSOf(RUSAGE_CHILDREN));
+  if (PeakRSS != 0)
+    OS << ",\"otherData\":{\"peak-rss-kb\":" << PeakRSS << "}";
+#endif
+  OS << "}\n";
+}
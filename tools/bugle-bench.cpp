@@ -0,0 +1,555 @@
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/YAMLParser.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "bugle/util/ErrorReporter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <vector>
+
+using namespace llvm;
+
+static cl::opt<std::string> BuglePath(
+    "bugle",
+    cl::desc("bugle executable to benchmark (default: the bugle executable "
+             "next to bugle-bench)"),
+    cl::init(""), cl::value_desc("filename"));
+
+static cl::opt<std::string> WorkDirectory(
+    "work-dir",
+    cl::desc("Directory for the generated kernels and the translations "
+             "(default bugle-bench.out)"),
+    cl::init("bugle-bench.out"), cl::value_desc("directory"));
+
+static cl::list<std::string> SelectedAxes(
+    "axis", cl::ZeroOrMore, cl::CommaSeparated,
+    cl::desc("Axes along which the kernels grow (default: all of arrays, "
+             "blocks, phis, indirect-calls, vector-ops, memcpy, inline-depth)"),
+    cl::value_desc("name"));
+
+static cl::opt<unsigned> Steps(
+    "steps", cl::desc("Number of kernel sizes per axis; each step doubles the "
+                      "size (default 4)"),
+    cl::init(4));
+
+static cl::opt<bool> GenerateOnly(
+    "generate-only", cl::ValueDisallowed,
+    cl::desc("Only generate the kernels, without running bugle"));
+
+static cl::opt<std::string> SaveFilename(
+    "save", cl::desc("Save the results, for later use with -baseline"),
+    cl::init(""), cl::value_desc("filename"));
+
+static cl::opt<std::string> BaselineFilename(
+    "baseline",
+    cl::desc("Compare the results against previously saved results, failing "
+             "on regressions"),
+    cl::init(""), cl::value_desc("filename"));
+
+static cl::opt<unsigned> Tolerance(
+    "tolerance",
+    cl::desc("Allowed growth over the baseline in percent (default 10)"),
+    cl::init(10));
+
+static cl::opt<unsigned> MinTime(
+    "min-time-us",
+    cl::desc("Times below this many microseconds in the baseline are too "
+             "noisy to compare (default 10000)"),
+    cl::init(10000));
+
+static cl::opt<unsigned> MinRSSGrowth(
+    "min-rss-growth-kb",
+    cl::desc("Growths of the peak RSS below this many kilobytes in the "
+             "baseline are too noisy to compare (default 1024)"),
+    cl::init(1024));
+
+// The address space bugle models as global memory by default.
+static const unsigned GlobalAddrSpace = 1;
+
+// The number of arrays or helpers to choose between in kernels that do not
+// grow in that dimension.
+static const unsigned NumChoices = 4;
+
+static PointerType *GetArrayPtrTy(LLVMContext &C) {
+  return Type::getInt32PtrTy(C, GlobalAddrSpace);
+}
+
+static FunctionType *GetFunctionTy(LLVMContext &C, unsigned NumArrays) {
+  std::vector<Type *> Params(NumArrays, GetArrayPtrTy(C));
+  Params.push_back(Type::getInt32Ty(C));
+  return FunctionType::get(Type::getVoidTy(C), Params, false);
+}
+
+// Creates a function with NumArrays array parameters followed by an integer
+// parameter, and positions B at its entry.
+static Function *CreateFunction(Module &M, StringRef Name, unsigned NumArrays,
+                                IRBuilder<> &B) {
+  LLVMContext &C = M.getContext();
+  Function *F = Function::Create(GetFunctionTy(C, NumArrays),
+                                 GlobalValue::ExternalLinkage, Name, &M);
+  B.SetInsertPoint(BasicBlock::Create(C, "entry", F));
+  return F;
+}
+
+static Value *GetArg(Function *F, unsigned i) { return F->arg_begin() + i; }
+
+// Branches on the integer parameter of F around a block, returning the block
+// so that the caller can fill it. B is positioned at the join block.
+static BasicBlock *CreateDiamond(Function *F, unsigned NumArrays, unsigned i,
+                                 IRBuilder<> &B) {
+  LLVMContext &C = F->getContext();
+  BasicBlock *Then = BasicBlock::Create(C, "then", F);
+  BasicBlock *Join = BasicBlock::Create(C, "join", F);
+  B.CreateCondBr(B.CreateICmpSGT(GetArg(F, NumArrays), B.getInt32(i)), Then,
+                 Join);
+  B.SetInsertPoint(Then);
+  B.CreateBr(Join);
+  B.SetInsertPoint(Join);
+  return Then;
+}
+
+// A kernel with Size arrays, each of which is read and written.
+static void GenerateArrays(Module &M, unsigned Size) {
+  IRBuilder<> B(M.getContext());
+  Function *F = CreateFunction(M, "kernel", Size, B);
+  Value *X = GetArg(F, Size);
+  for (unsigned i = 0; i != Size; ++i) {
+    Value *P = B.CreateGEP(GetArg(F, i), X);
+    B.CreateStore(B.CreateAdd(B.CreateLoad(P), B.getInt32(i)), P);
+  }
+  B.CreateRetVoid();
+}
+
+// A kernel with Size conditional stores, giving 2 * Size + 1 basic blocks.
+static void GenerateBlocks(Module &M, unsigned Size) {
+  IRBuilder<> B(M.getContext());
+  Function *F = CreateFunction(M, "kernel", 1, B);
+  for (unsigned i = 0; i != Size; ++i) {
+    BasicBlock *Then = CreateDiamond(F, 1, i, B);
+    IRBuilder<> TB(Then->getTerminator());
+    TB.CreateStore(TB.getInt32(i), TB.CreateGEP(GetArg(F, 0), TB.getInt32(i)));
+  }
+  B.CreateRetVoid();
+}
+
+// A kernel with Size pointer phis, each choosing between two arrays.
+static void GeneratePhis(Module &M, unsigned Size) {
+  IRBuilder<> B(M.getContext());
+  Function *F = CreateFunction(M, "kernel", NumChoices, B);
+  Value *X = GetArg(F, NumChoices);
+  for (unsigned i = 0; i != Size; ++i) {
+    BasicBlock *Entry = B.GetInsertBlock();
+    BasicBlock *Then = CreateDiamond(F, NumChoices, i, B);
+    PHINode *P = B.CreatePHI(GetArrayPtrTy(M.getContext()), 2);
+    P->addIncoming(GetArg(F, i % NumChoices), Entry);
+    P->addIncoming(GetArg(F, (i + 1) % NumChoices), Then);
+    B.CreateStore(B.getInt32(i), B.CreateGEP(P, X));
+  }
+  B.CreateRetVoid();
+}
+
+// A kernel with Size indirect calls, each choosing between two helpers.
+static void GenerateIndirectCalls(Module &M, unsigned Size) {
+  IRBuilder<> B(M.getContext());
+  std::vector<Function *> Helpers;
+  for (unsigned i = 0; i != NumChoices; ++i) {
+    Function *H = CreateFunction(M, "helper" + std::to_string(i), 1, B);
+    B.CreateStore(B.getInt32(i), B.CreateGEP(GetArg(H, 0), GetArg(H, 1)));
+    B.CreateRetVoid();
+    Helpers.push_back(H);
+  }
+
+  Function *F = CreateFunction(M, "kernel", 1, B);
+  Value *X = GetArg(F, 1);
+  for (unsigned i = 0; i != Size; ++i) {
+    Value *Callee = B.CreateSelect(B.CreateICmpSGT(X, B.getInt32(i)),
+                                   Helpers[i % NumChoices],
+                                   Helpers[(i + 1) % NumChoices]);
+    B.CreateCall(Callee, {GetArg(F, 0), X});
+  }
+  B.CreateRetVoid();
+}
+
+// A kernel with Size rounds of arithmetic and shuffles on 4-element vectors.
+static void GenerateVectorOps(Module &M, unsigned Size) {
+  IRBuilder<> B(M.getContext());
+  Function *F = CreateFunction(M, "kernel", 1, B);
+  Type *VecTy = VectorType::get(B.getInt32Ty(), 4);
+  Value *VP =
+      B.CreateBitCast(GetArg(F, 0), VecTy->getPointerTo(GlobalAddrSpace));
+  uint32_t Reverse[] = {3, 2, 1, 0};
+  for (unsigned i = 0; i != Size; ++i) {
+    Value *P = B.CreateGEP(VP, B.getInt32(i));
+    Value *V = B.CreateLoad(P);
+    V = B.CreateAdd(V, B.CreateVectorSplat(4, B.getInt32(i)));
+    V = B.CreateMul(V, V);
+    V = B.CreateShuffleVector(V, UndefValue::get(VecTy), Reverse);
+    B.CreateStore(V, P);
+  }
+  B.CreateRetVoid();
+}
+
+// A kernel copying Size bytes between two arrays.
+static void GenerateMemcpy(Module &M, unsigned Size) {
+  IRBuilder<> B(M.getContext());
+  Function *F = CreateFunction(M, "kernel", 2, B);
+  B.CreateMemCpy(GetArg(F, 0), GetArg(F, 1), Size, 4);
+  B.CreateRetVoid();
+}
+
+// A kernel calling a chain of Size nested helpers, to be inlined.
+static void GenerateInlineDepth(Module &M, unsigned Size) {
+  IRBuilder<> B(M.getContext());
+  Function *Callee = nullptr;
+  for (unsigned i = Size; i != 0; --i) {
+    Function *H = CreateFunction(M, "helper" + std::to_string(i - 1), 1, B);
+    Value *X = GetArg(H, 1);
+    B.CreateStore(X, B.CreateGEP(GetArg(H, 0), B.getInt32(i - 1)));
+    if (Callee)
+      B.CreateCall(Callee, {GetArg(H, 0), B.CreateAdd(X, B.getInt32(1))});
+    B.CreateRetVoid();
+    Callee = H;
+  }
+
+  Function *F = CreateFunction(M, "kernel", 1, B);
+  B.CreateCall(Callee, {GetArg(F, 0), GetArg(F, 1)});
+  B.CreateRetVoid();
+}
+
+namespace {
+
+// An axis along which generated kernels grow. The kernel for a size is a
+// module whose entry point is named "kernel".
+struct Axis {
+  const char *Name;
+  unsigned BaseSize;
+  bool NeedsInlining;
+  void (*Generate)(Module &M, unsigned Size);
+};
+}
+
+static const Axis AllAxes[] = {
+    {"arrays", 4, false, GenerateArrays},
+    {"blocks", 16, false, GenerateBlocks},
+    {"phis", 4, false, GeneratePhis},
+    {"indirect-calls", 4, false, GenerateIndirectCalls},
+    {"vector-ops", 8, false, GenerateVectorOps},
+    {"memcpy", 64, false, GenerateMemcpy},
+    {"inline-depth", 4, true, GenerateInlineDepth},
+};
+
+// The results of a run: the value of each metric, per kernel.
+typedef std::map<std::string, std::map<std::string, uint64_t>> Results;
+
+static std::string GetWorkPath(const std::string &Name) {
+  SmallString<128> Path(WorkDirectory);
+  sys::path::append(Path, Name);
+  return Path.str().str();
+}
+
+static void GenerateKernel(const Axis &A, unsigned Size,
+                           const std::string &Filename) {
+  LLVMContext Context;
+  Module M(A.Name, Context);
+  A.Generate(M, Size);
+  if (verifyModule(M, &errs()))
+    bugle::ErrorReporter::reportImplementationLimitation(
+        std::string("Generated an invalid kernel for axis ") + A.Name);
+
+  std::error_code EC;
+  raw_fd_ostream OS(Filename, EC, sys::fs::F_None);
+  if (EC)
+    bugle::ErrorReporter::reportFatalError(EC.message());
+  WriteBitcodeToFile(&M, OS);
+}
+
+static std::string FindBugle(const char *Argv0) {
+  if (!BuglePath.empty())
+    return BuglePath;
+
+  std::string Executable =
+      sys::fs::getMainExecutable(Argv0, (void *)&FindBugle);
+  SmallString<128> Path(sys::path::parent_path(Executable));
+  sys::path::append(Path, "bugle");
+  if (sys::fs::can_execute(Path))
+    return Path.str().str();
+
+  ErrorOr<std::string> PathOrErr = sys::findProgramByName("bugle");
+  if (!PathOrErr)
+    bugle::ErrorReporter::reportParameterError(
+        "Cannot find bugle; specify it with -bugle");
+  return PathOrErr.get();
+}
+
+// Returns the text of the scalar N, or the empty string if N is not a scalar.
+static std::string GetScalar(yaml::Node *N) {
+  auto SN = dyn_cast_or_null<yaml::ScalarNode>(N);
+  if (!SN)
+    return "";
+  SmallString<32> Storage;
+  return SN->getValue(Storage).str();
+}
+
+// Returns the value of the scalar N as an integer, or 0 if it is not one.
+static uint64_t GetInteger(yaml::Node *N) {
+  uint64_t Value;
+  if (StringRef(GetScalar(N)).getAsInteger(10, Value))
+    return 0;
+  return Value;
+}
+
+// Adds the duration of a span of a phase, and the growth of the peak RSS of
+// bugle during the span, to the metrics of the phase.
+static void ReadTraceEvent(yaml::MappingNode *Event,
+                           std::map<std::string, uint64_t> &Metrics) {
+  std::string Phase, Name;
+  uint64_t Duration = 0, RSSGrowth = 0;
+  for (auto &Field : *Event) {
+    std::string Key = GetScalar(Field.getKey());
+    if (Key == "ph") {
+      Phase = GetScalar(Field.getValue());
+    } else if (Key == "name") {
+      Name = GetScalar(Field.getValue());
+    } else if (Key == "dur") {
+      Duration = GetInteger(Field.getValue());
+    } else if (Key == "args") {
+      if (auto Args = dyn_cast_or_null<yaml::MappingNode>(Field.getValue())) {
+        for (auto &Arg : *Args) {
+          if (GetScalar(Arg.getKey()) == "rss-growth-kb")
+            RSSGrowth = GetInteger(Arg.getValue());
+        }
+      }
+    }
+  }
+
+  if (Phase != "X" || Name.empty())
+    return;
+  Metrics[Name + " time-us"] += Duration;
+  Metrics[Name + " rss-growth-kb"] += RSSGrowth;
+}
+
+// Reads the time trace written by bugle. The trace is JSON, which is read with
+// the YAML parser as llvm/Support/JSON.h is not available in every supported
+// version of LLVM. The time of each phase is the sum of the durations of its
+// spans, and its RSS growth the sum of the growth of the peak RSS during its
+// spans. The peak RSS of the translation is given once for the whole trace.
+static void ReadTimeTrace(const std::string &Filename,
+                          std::map<std::string, uint64_t> &Metrics) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+      MemoryBuffer::getFile(Filename);
+  if (std::error_code EC = BufferOrErr.getError())
+    bugle::ErrorReporter::reportFatalError(Filename + ": " + EC.message());
+
+  SourceMgr SM;
+  yaml::Stream Stream(BufferOrErr.get()->getBuffer(), SM);
+  yaml::document_iterator Document = Stream.begin();
+  auto Root = Document != Stream.end()
+                  ? dyn_cast_or_null<yaml::MappingNode>(Document->getRoot())
+                  : nullptr;
+  if (!Root)
+    bugle::ErrorReporter::reportFatalError(Filename + ": Malformed time trace");
+
+  for (auto &Field : *Root) {
+    std::string Key = GetScalar(Field.getKey());
+    if (Key == "traceEvents") {
+      auto Events = dyn_cast_or_null<yaml::SequenceNode>(Field.getValue());
+      if (!Events)
+        continue;
+      for (auto &Event : *Events) {
+        if (auto EventMap = dyn_cast<yaml::MappingNode>(&Event))
+          ReadTraceEvent(EventMap, Metrics);
+      }
+    } else if (Key == "otherData") {
+      auto Data = dyn_cast_or_null<yaml::MappingNode>(Field.getValue());
+      if (!Data)
+        continue;
+      for (auto &Datum : *Data) {
+        if (GetScalar(Datum.getKey()) == "peak-rss-kb")
+          Metrics["peak-rss-kb"] = GetInteger(Datum.getValue());
+      }
+    }
+  }
+
+  if (Stream.failed())
+    bugle::ErrorReporter::reportFatalError(Filename + ": Malformed time trace");
+}
+
+static bool RunKernel(const std::string &Bugle, const Axis &A,
+                      const std::string &Kernel,
+                      std::map<std::string, uint64_t> &Metrics) {
+  std::string Input = GetWorkPath(Kernel + ".bc");
+  std::string Output = GetWorkPath(Kernel + ".bpl");
+  std::string Trace = GetWorkPath(Kernel + ".trace.json");
+
+  std::vector<std::string> ArgStrings = {Bugle, "-k", "kernel", "-o", Output,
+                                         "-time-trace=" + Trace};
+  if (A.NeedsInlining)
+    ArgStrings.push_back("-inline");
+  ArgStrings.push_back(Input);
+
+  std::vector<const char *> Args;
+  for (auto i = ArgStrings.begin(), e = ArgStrings.end(); i != e; ++i)
+    Args.push_back(i->c_str());
+  Args.push_back(nullptr);
+
+  std::string ErrMsg;
+  auto Start = std::chrono::steady_clock::now();
+  int Result = sys::ExecuteAndWait(Bugle, Args.data(), nullptr, {}, 0, 0,
+                                   &ErrMsg);
+  auto End = std::chrono::steady_clock::now();
+  if (Result != 0) {
+    errs() << Kernel << ": bugle failed"
+           << (ErrMsg.empty() ? "" : ": " + ErrMsg) << "\n";
+    return false;
+  }
+
+  Metrics["total time-us"] =
+      std::chrono::duration_cast<std::chrono::microseconds>(End - Start)
+          .count();
+  ReadTimeTrace(Trace, Metrics);
+
+  uint64_t Size;
+  if (!sys::fs::file_size(Output, Size))
+    Metrics["bpl-bytes"] = Size;
+  return true;
+}
+
+static void PrintResults(const Results &R) {
+  for (auto i = R.begin(), e = R.end(); i != e; ++i) {
+    outs() << i->first << "\n";
+    for (auto mi = i->second.begin(), me = i->second.end(); mi != me; ++mi)
+      outs() << format("  %-48s %12llu\n", mi->first.c_str(),
+                       (unsigned long long)mi->second);
+  }
+}
+
+// Results are saved as lines of tab separated kernel, metric and value.
+static void SaveResults(const Results &R, const std::string &Filename) {
+  std::error_code EC;
+  raw_fd_ostream OS(Filename, EC, sys::fs::F_Text);
+  if (EC)
+    bugle::ErrorReporter::reportFatalError(EC.message());
+  for (auto i = R.begin(), e = R.end(); i != e; ++i)
+    for (auto mi = i->second.begin(), me = i->second.end(); mi != me; ++mi)
+      OS << i->first << "\t" << mi->first << "\t" << mi->second << "\n";
+}
+
+static void LoadResults(Results &R, const std::string &Filename) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+      MemoryBuffer::getFile(Filename);
+  if (std::error_code EC = BufferOrErr.getError())
+    bugle::ErrorReporter::reportFatalError(Filename + ": " + EC.message());
+
+  SmallVector<StringRef, 64> Lines;
+  BufferOrErr.get()->getBuffer().split(Lines, '\n', -1, false);
+  for (auto i = Lines.begin(), e = Lines.end(); i != e; ++i) {
+    SmallVector<StringRef, 3> Fields;
+    i->split(Fields, '\t');
+    uint64_t Value;
+    if (Fields.size() != 3 || Fields[2].getAsInteger(10, Value))
+      bugle::ErrorReporter::reportFatalError("Malformed results in " +
+                                             Filename + ": " + i->str());
+    R[Fields[0].str()][Fields[1].str()] = Value;
+  }
+}
+
+// Reports the metrics that grew by more than the tolerance over the baseline,
+// and returns their number.
+static unsigned CompareResults(const Results &Baseline, const Results &R) {
+  unsigned Regressions = 0;
+  for (auto i = Baseline.begin(), e = Baseline.end(); i != e; ++i) {
+    auto Current = R.find(i->first);
+    if (Current == R.end())
+      continue;
+    for (auto mi = i->second.begin(), me = i->second.end(); mi != me; ++mi) {
+      auto Metric = Current->second.find(mi->first);
+      if (Metric == Current->second.end())
+        continue;
+      if (StringRef(mi->first).endswith("time-us") && mi->second < MinTime)
+        continue;
+      if (StringRef(mi->first).endswith("rss-growth-kb") &&
+          mi->second < MinRSSGrowth)
+        continue;
+      if (Metric->second * 100 <= mi->second * (100 + Tolerance))
+        continue;
+      outs() << "regression: " << i->first << ": " << mi->first << " "
+             << mi->second << " -> " << Metric->second << "\n";
+      ++Regressions;
+    }
+  }
+  return Regressions;
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal(argv[0]);
+  llvm::PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y; // Call llvm_shutdown() on exit.
+
+  cl::ParseCommandLineOptions(
+      argc, argv, "bugle benchmark generator and harness\n");
+
+  std::vector<const Axis *> Axes;
+  for (auto i = std::begin(AllAxes), e = std::end(AllAxes); i != e; ++i) {
+    if (SelectedAxes.empty() ||
+        std::find(SelectedAxes.begin(), SelectedAxes.end(), i->Name) !=
+            SelectedAxes.end())
+      Axes.push_back(i);
+  }
+  if (Axes.empty() ||
+      (!SelectedAxes.empty() && Axes.size() != SelectedAxes.size()))
+    bugle::ErrorReporter::reportParameterError("Unknown axis given to -axis");
+
+  if (std::error_code EC = sys::fs::create_directories(WorkDirectory))
+    bugle::ErrorReporter::reportFatalError(EC.message());
+
+  std::string Bugle;
+  if (!GenerateOnly)
+    Bugle = FindBugle(argv[0]);
+
+  Results R;
+  bool Failed = false;
+  for (auto i = Axes.begin(), e = Axes.end(); i != e; ++i) {
+    for (unsigned Step = 0; Step != Steps; ++Step) {
+      unsigned Size = (*i)->BaseSize << Step;
+      std::string Kernel = std::string((*i)->Name) + "-" + std::to_string(Size);
+      GenerateKernel(**i, Size, GetWorkPath(Kernel + ".bc"));
+      if (!GenerateOnly && !RunKernel(Bugle, **i, Kernel, R[Kernel]))
+        Failed = true;
+    }
+  }
+
+  if (GenerateOnly)
+    return 0;
+
+  PrintResults(R);
+
+  if (!SaveFilename.empty())
+    SaveResults(R, SaveFilename);
+
+  if (!BaselineFilename.empty()) {
+    Results Baseline;
+    LoadResults(Baseline, BaselineFilename);
+    if (CompareResults(Baseline, R) != 0)
+      Failed = true;
+  }
+
+  return Failed ? 1 : 0;
+}
@@ -0,0 +1,302 @@
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "bugle/BPLExprWriter.h"
+#include "bugle/BPLModuleWriter.h"
+#include "bugle/Expr.h"
+#include "bugle/ExprRewriter.h"
+#include "bugle/Ident.h"
+#include "bugle/IntegerRepresentation.h"
+#include "bugle/Module.h"
+#include "bugle/Var.h"
+#include "bugle/util/ErrorReporter.h"
+#include "bugle/util/UniqueNameSet.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+using namespace llvm;
+using namespace bugle;
+
+static cl::list<std::string> SelectedBenchmarks(
+    cl::Positional, cl::ZeroOrMore,
+    cl::desc("<benchmarks to run (default: all)>"));
+
+static cl::opt<bool> ListBenchmarks(
+    "list", cl::ValueDisallowed, cl::desc("List the available benchmarks"));
+
+static cl::opt<unsigned> MinTime(
+    "min-time-ms",
+    cl::desc("Minimum duration of each repetition in milliseconds "
+             "(default 200)"),
+    cl::init(200));
+
+static cl::opt<unsigned> Repetitions(
+    "repetitions", cl::desc("Number of timed repetitions (default 5)"),
+    cl::init(5));
+
+// Accumulates results, so that the benchmarked work cannot be discarded.
+static volatile uint64_t Sink;
+
+// The expressions built by the benchmarks, sized so that each iteration does
+// a meaningful amount of work.
+static const unsigned TreeDepth = 64;
+
+static ref<Expr> CreateVarRef(const std::string &Name, unsigned Width) {
+  // Vars are owned by functions; benchmarks simply leak their few Vars.
+  return VarRefExpr::create(new Var(Type(Type::BV, Width), Name));
+}
+
+static void BenchConstantFolding(unsigned Iterations) {
+  ref<Expr> Three = BVConstExpr::create(32, 3);
+  ref<Expr> One = BVConstExpr::create(32, 1);
+  for (unsigned i = 0; i != Iterations; ++i) {
+    ref<Expr> E = BVConstExpr::create(32, i);
+    for (unsigned j = 0; j != TreeDepth; ++j) {
+      E = BVAddExpr::create(E, BVConstExpr::create(32, j));
+      E = BVMulExpr::create(E, Three);
+      E = BVLShrExpr::create(E, One);
+      E = BVSDivExpr::create(E, Three);
+    }
+    Sink += cast<BVConstExpr>(E)->getValue().getZExtValue();
+  }
+}
+
+static void BenchCreate(unsigned Iterations) {
+  ref<Expr> V = CreateVarRef("v", 32);
+  for (unsigned i = 0; i != Iterations; ++i) {
+    ref<Expr> E = V;
+    for (unsigned j = 0; j != TreeDepth; ++j) {
+      E = BVAddExpr::create(E, BVConstExpr::create(32, j));
+      E = BVMulExpr::create(BVConstExpr::create(32, 4), E);
+      E = BVZExtExpr::create(32, BVExtractExpr::create(E, 0, 16));
+    }
+    Sink += E->getType().width;
+  }
+}
+
+static void BenchExactBVSDiv(unsigned Iterations) {
+  // An offset of the shape produced by GEPs into arrays of 16 byte elements.
+  ref<Expr> V = CreateVarRef("v", 32);
+  ref<Expr> Offset = BVConstExpr::create(32, 0);
+  for (unsigned j = 0; j != TreeDepth; ++j)
+    Offset = BVAddExpr::create(
+        BVMulExpr::create(V, BVConstExpr::create(32, 16 * (j + 1))), Offset);
+
+  for (unsigned i = 0; i != Iterations; ++i) {
+    ref<Expr> E = Expr::createExactBVSDiv(Offset, 4);
+    ref<Expr> F = Expr::createExactBVSDiv(Offset, 3);
+    Sink += !E.isNull() + !F.isNull();
+  }
+}
+
+static void BenchRewrite(unsigned Iterations) {
+  // Expressions that are only simplified by the rewrite rules, of the kinds
+  // produced for narrow arithmetic and boolean conversions. All rules are
+  // applied unless a rewriter is given by the options.
+  ExprRewriter AllRules((llvm::ArrayRef<std::string>()));
+  const ExprRewriter *Rewriter = ExprRewriter::getCurrent();
+  ExprRewriter::Scope RewriteScope(Rewriter ? Rewriter : &AllRules);
+  ref<Expr> V = CreateVarRef("v", 16);
+  ref<Expr> C = EqExpr::create(CreateVarRef("c", 32),
+                               BVConstExpr::createZero(32));
+  for (unsigned i = 0; i != Iterations; ++i) {
+    ref<Expr> E = V;
+    for (unsigned j = 0; j != TreeDepth; ++j) {
+      ref<Expr> Sum = BVSubExpr::create(BVZExtExpr::create(32, E),
+                                        BVConstExpr::create(32, j));
+      E = BVExtractExpr::create(Sum, 0, 16);
+      ref<Expr> Flag = BoolToBVExpr::create(C);
+      ref<Expr> Sel = IfThenElseExpr::create(
+          EqExpr::create(BVConstExpr::create(1, 1), Flag),
+          BVConstExpr::create(16, 1), BVConstExpr::create(16, 0));
+      E = BVAddExpr::create(E, BVAddExpr::create(Sel, Sel));
+    }
+    Sink += E->getKind();
+  }
+}
+
+// Builds a concatenation of extracts of TreeDepth distinct variables, as
+// produced by byte-array models.
+static ref<Expr> CreateConcatTree() {
+  std::vector<ref<Expr>> Bytes;
+  for (unsigned j = 0; j != TreeDepth; ++j)
+    Bytes.push_back(BVExtractExpr::create(
+        CreateVarRef("b" + std::to_string(j), 32), 8, 8));
+  return Expr::createBVConcatN(Bytes);
+}
+
+// Builds alternating extracts and concatenations that straddle their
+// operands, so that none of them fold.
+static ref<Expr> CreateExtractTree() {
+  ref<Expr> E = CreateVarRef("w", 32);
+  for (unsigned j = 0; j != TreeDepth; ++j)
+    E = BVExtractExpr::create(
+        BVConcatExpr::create(E, CreateVarRef("w" + std::to_string(j), 32)), 4,
+        32);
+  return E;
+}
+
+static void BenchWriteExpr(unsigned Iterations, ref<Expr> E,
+                           IntegerRepresentation &IntRep) {
+  bugle::Module M;
+  raw_null_ostream NullOS;
+  BPLModuleWriter MW(NullOS, &M, &IntRep, RaceInstrumenter::WatchdogSingle,
+                     nullptr);
+  BPLExprWriter W(&MW);
+  for (unsigned i = 0; i != Iterations; ++i) {
+    std::string S;
+    raw_string_ostream SS(S);
+    W.writeExpr(SS, E.get());
+    Sink += SS.str().size();
+  }
+}
+
+static void BenchWriteConcat(unsigned Iterations) {
+  BVIntegerRepresentation IntRep;
+  BenchWriteExpr(Iterations, CreateConcatTree(), IntRep);
+}
+
+static void BenchWriteExtract(unsigned Iterations) {
+  BVIntegerRepresentation IntRep;
+  BenchWriteExpr(Iterations, CreateExtractTree(), IntRep);
+}
+
+static void BenchWriteConcatMath(unsigned Iterations) {
+  MathIntegerRepresentation IntRep;
+  BenchWriteExpr(Iterations, CreateConcatTree(), IntRep);
+}
+
+static void BenchIntRep(unsigned Iterations, IntegerRepresentation &IntRep) {
+  static const unsigned Widths[] = {1, 8, 16, 32, 64, 128};
+  for (unsigned i = 0; i != Iterations; ++i) {
+    for (auto W : Widths) {
+      Sink += IntRep.getType(W).size();
+      Sink += IntRep.getLiteral(i, W).size();
+      Sink += IntRep.getZeroExtend(W, 2 * W).size();
+      Sink += IntRep.getSignExtend(W, 2 * W).size();
+      Sink += IntRep.getExtractExpr("x", W - 1, 0).size();
+      Sink += IntRep.getConcatExpr("x", "y").size();
+      Sink += IntRep.getArithmeticBinary("ADD", Expr::BVAdd, W).size();
+      Sink += IntRep.getBooleanBinary("ULT", Expr::BVUlt, W).size();
+    }
+  }
+}
+
+static void BenchIntRepBV(unsigned Iterations) {
+  BVIntegerRepresentation IntRep;
+  BenchIntRep(Iterations, IntRep);
+}
+
+static void BenchIntRepMath(unsigned Iterations) {
+  MathIntegerRepresentation IntRep;
+  BenchIntRep(Iterations, IntRep);
+}
+
+static void BenchUniqueNames(unsigned Iterations) {
+  // Every name collides, as for the temporaries of a large function.
+  for (unsigned i = 0; i != Iterations; ++i) {
+    UniqueNameSet Names;
+    for (unsigned j = 0; j != TreeDepth; ++j)
+      Sink += Names.makeName("v").size();
+  }
+}
+
+static void BenchBoogieIdent(unsigned Iterations) {
+  static const char *const Names[] = {
+      "_Z6kernelPU3AS1fS0_i", "llvm.memcpy.p1i8.p1i8.i64",
+      "struct.anon*@foo<bar>", "__spirv_BuiltInGlobalInvocationId"};
+  for (unsigned i = 0; i != Iterations; ++i)
+    for (auto N : Names)
+      Sink += makeBoogieIdent(N).size();
+}
+
+namespace {
+
+struct Benchmark {
+  const char *Name;
+  void (*Run)(unsigned Iterations);
+};
+}
+
+static const Benchmark AllBenchmarks[] = {
+    {"expr-constant-folding", BenchConstantFolding},
+    {"expr-create", BenchCreate},
+    {"expr-exact-bvsdiv", BenchExactBVSDiv},
+    {"expr-rewrite", BenchRewrite},
+    {"write-concat", BenchWriteConcat},
+    {"write-concat-math", BenchWriteConcatMath},
+    {"write-extract", BenchWriteExtract},
+    {"intrep-bv", BenchIntRepBV},
+    {"intrep-math", BenchIntRepMath},
+    {"unique-name-set", BenchUniqueNames},
+    {"boogie-ident", BenchBoogieIdent},
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static double RunFor(const Benchmark &B, unsigned Iterations) {
+  auto Start = Clock::now();
+  B.Run(Iterations);
+  return std::chrono::duration<double, std::nano>(Clock::now() - Start)
+      .count();
+}
+
+// Times B, reporting the median and the minimum time per iteration over the
+// repetitions. The number of iterations is chosen such that a repetition
+// takes at least MinTime.
+static void RunBenchmark(const Benchmark &B) {
+  double MinTimeNs = MinTime * 1e6;
+  unsigned Iterations = 1;
+  while (RunFor(B, Iterations) < MinTimeNs / 2 && Iterations < (1u << 30))
+    Iterations *= 2;
+  Iterations *= 2;
+
+  std::vector<double> Times;
+  for (unsigned i = 0; i != std::max(Repetitions.getValue(), 1u); ++i)
+    Times.push_back(RunFor(B, Iterations) / Iterations);
+  std::sort(Times.begin(), Times.end());
+
+  outs() << format("%-24s %12.1f ns %12.1f ns %12u\n", B.Name,
+                   Times[Times.size() / 2], Times.front(), Iterations);
+  outs().flush();
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal(argv[0]);
+  llvm::PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y; // Call llvm_shutdown() on exit.
+
+  cl::ParseCommandLineOptions(argc, argv, "bugle micro-benchmarks\n");
+  auto Rewriter = ExprRewriter::createFromOptions();
+  ExprRewriter::Scope RewriteScope(Rewriter.get());
+
+  if (ListBenchmarks) {
+    for (auto &B : AllBenchmarks)
+      outs() << B.Name << "\n";
+    return 0;
+  }
+
+  std::vector<const Benchmark *> Benchmarks;
+  for (auto &B : AllBenchmarks) {
+    if (SelectedBenchmarks.empty() ||
+        std::find(SelectedBenchmarks.begin(), SelectedBenchmarks.end(),
+                  B.Name) != SelectedBenchmarks.end())
+      Benchmarks.push_back(&B);
+  }
+  if (Benchmarks.size() != SelectedBenchmarks.size() &&
+      !SelectedBenchmarks.empty())
+    ErrorReporter::reportParameterError("Unknown benchmark; see -list");
+
+  outs() << left_justify("benchmark", 24) << right_justify("median", 16)
+         << right_justify("min", 16) << right_justify("iterations", 13) << "\n";
+  for (auto B : Benchmarks)
+    RunBenchmark(*B);
+
+  return 0;
+}
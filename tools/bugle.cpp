@@ -1,23 +1,32 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/CachePruning.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Program.h"
 #include "llvm/Support/Regex.h"
+#include "llvm/Support/SHA1.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/Scalar.h"
 
 #include "bugle/BPLModuleWriter.h"
+#include "bugle/ExprRewriter.h"
+#include "bugle/Frontend/CompileSource.h"
 #include "bugle/IntegerRepresentation.h"
 #include "bugle/Module.h"
 #include "bugle/SourceLocWriter.h"
@@ -26,23 +35,39 @@
 #include "bugle/Preprocessing/CycleDetectPass.h"
 #include "bugle/Preprocessing/FreshArrayPass.h"
 #include "bugle/Preprocessing/InlinePass.h"
+#include "bugle/Preprocessing/MaterializeReachable.h"
 #include "bugle/Preprocessing/RestrictDetectPass.h"
 #include "bugle/Preprocessing/SimpleInternalizePass.h"
 #include "bugle/Preprocessing/StructSimplificationPass.h"
 #include "bugle/Preprocessing/Vector3SimplificationPass.h"
 #include "bugle/RaceInstrumenter.h"
 #include "bugle/Transform/SimplifyStmt.h"
+#include "bugle/Translator/DebugInfoIndex.h"
 #include "bugle/Translator/TranslateModule.h"
 #include "bugle/util/ErrorReporter.h"
+#include "bugle/util/JSON.h"
+#include "bugle/util/Statistics.h"
+#include "bugle/util/TimeTrace.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <map>
 #include <set>
 #include <vector>
 
+#ifdef LLVM_ON_UNIX
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 using namespace llvm;
 
-static cl::opt<std::string> InputFilename(
-    cl::Positional, cl::desc("<input bitcode file>"), cl::init("-"),
+static cl::list<std::string> InputFilenames(
+    cl::Positional, cl::ZeroOrMore,
+    cl::desc("<input bitcode or source files>"),
     cl::value_desc("filename"));
 
 static cl::opt<std::string> OutputFilename(
@@ -115,6 +140,75 @@ static cl::opt<unsigned> ConstantAddrSpace(
     "constant-space", cl::desc("Constant address space (default 4)"),
     cl::value_desc("int"), cl::init(4));
 
+static cl::opt<unsigned> Threads(
+    "j", cl::desc("Number of inputs to translate in parallel (default 1, "
+                  "0 for one per core)"),
+    cl::value_desc("int"), cl::init(1));
+
+static cl::opt<std::string> OutputDirectory(
+    "output-dir",
+    cl::desc("Directory for output files when translating multiple inputs"),
+    cl::init(""), cl::value_desc("directory"));
+
+static cl::opt<std::string> CacheDirectory(
+    "cache-dir", cl::desc("Directory in which to cache translations"),
+    cl::init(""), cl::value_desc("directory"));
+
+static cl::opt<std::string> CachePolicy(
+    "cache-policy",
+    cl::desc("Pruning policy for the translation cache, in the format of "
+             "LLVM's cache pruning policies (default "
+             "prune_after=168h:cache_size_bytes=1g)"),
+    cl::init("prune_after=168h:cache_size_bytes=1g"), cl::value_desc("policy"));
+
+static cl::opt<std::string> TimeTraceFilename(
+    "time-trace",
+    cl::desc("Write a trace of the translation phases in Chrome trace format"),
+    cl::init(""), cl::value_desc("filename"));
+
+static cl::opt<std::string> StatsFilename(
+    "stats-json",
+    cl::desc("Write statistics of the translation of each input as JSON"),
+    cl::init(""), cl::value_desc("filename"));
+
+static cl::list<std::string> LinkFilenames(
+    "link", cl::ZeroOrMore,
+    cl::desc("Bitcode file to link into each input; only the definitions the "
+             "input needs are linked"),
+    cl::value_desc("filename"));
+
+static cl::opt<std::string> PassPipeline(
+    "pipeline",
+    cl::desc("LLVM pass pipeline, in the syntax of opt -passes, to run on "
+             "each linked input before preprocessing"),
+    cl::init(""), cl::value_desc("pipeline"));
+
+static cl::opt<bool> PersistModels(
+    "persist-models",
+    cl::desc("Save the pointer models of each input to <input>.models, and "
+             "start later translations of the same input from them"));
+
+#ifdef BUGLE_ENABLE_FRONTEND
+static cl::opt<std::string> BlangIncludeDir(
+    "blang-include-dir",
+    cl::desc("Directory holding the Bugle headers used to compile sources"),
+    cl::init(BUGLE_BLANG_INCLUDE_DIR), cl::value_desc("directory"));
+
+static cl::opt<std::string> FrontendTriple(
+    "frontend-triple",
+    cl::desc("Target triple used to compile sources (default nvptx--)"),
+    cl::init("nvptx--"), cl::value_desc("triple"));
+
+static cl::list<std::string> FrontendArgs(
+    "frontend-arg", cl::ZeroOrMore,
+    cl::desc("Additional Clang frontend argument used to compile sources"),
+    cl::value_desc("argument"));
+#endif
+
+static cl::opt<bool> Serve(
+    "serve", cl::ValueDisallowed,
+    cl::desc("Run as a server, reading translation requests from stdin"));
+
 
 static void CheckAddressSpaces() {
   if (GlobalAddrSpace == 0 || GlobalAddrSpace == GroupSharedAddrSpace ||
@@ -169,53 +263,184 @@ static void GetArraySizes(std::map<std::string, bugle::ArraySpec> &KAS) {
   }
 }
 
-int main(int argc, char **argv) {
-  sys::PrintStackTraceOnErrorSignal(argv[0]);
-  llvm::PrettyStackTraceProgram X(argc, argv);
+// Reads the module given with -link in Filename lazily. Buffer is set to the
+// contents of the file, which must outlive the module.
+static std::unique_ptr<Module>
+ReadLinkModule(const std::string &Filename, LLVMContext &Context,
+               std::unique_ptr<MemoryBuffer> &Buffer) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+      MemoryBuffer::getFile(Filename);
+  if (std::error_code EC = BufferOrErr.getError())
+    bugle::ErrorReporter::reportFatalError(Filename + ": " + EC.message());
+  Buffer = std::move(BufferOrErr.get());
 
-  // Enable debug stream buffering.
-  EnableDebugBuffering = true;
+  ErrorOr<std::unique_ptr<Module>> ModuleOrErr = expectedToErrorOrAndEmitErrors(
+      Context, getLazyBitcodeModule(Buffer->getMemBufferRef(), Context));
+  if (std::error_code EC = ModuleOrErr.getError())
+    bugle::ErrorReporter::reportFatalError(Filename + ": " + EC.message());
+  return std::move(ModuleOrErr.get());
+}
 
-  llvm_shutdown_obj Y; // Call llvm_shutdown() on exit.
+// Returns the names of the functions that the modules given with -link refer
+// to but do not define. Code linked from these modules may call such functions
+// of the input, even if nothing in the input does.
+static std::set<std::string> GetLinkedReferences() {
+  std::set<std::string> Names;
   LLVMContext Context;
+  for (auto i = LinkFilenames.begin(), e = LinkFilenames.end(); i != e; ++i) {
+    std::unique_ptr<MemoryBuffer> Buffer;
+    std::unique_ptr<Module> M = ReadLinkModule(*i, Context, Buffer);
+    for (auto fi = M->begin(), fe = M->end(); fi != fe; ++fi)
+      if (fi->isDeclaration() && !fi->isIntrinsic())
+        Names.insert(fi->getName().str());
+  }
+  return Names;
+}
 
-  cl::ParseCommandLineOptions(argc, argv, "LLVM to Boogie translator\n");
+// Reads the module in Buffer, which must outlive the module. The module is
+// loaded lazily, so that only the bodies of the functions that survive
+// preprocessing, or that the modules given with -link may call, are read; the
+// other functions are dropped.
+static std::unique_ptr<Module> ReadBitcode(MemoryBufferRef Buffer,
+                                           LLVMContext &Context) {
+  bugle::TimeTraceScope Scope("Read bitcode");
+  ErrorOr<std::unique_ptr<Module>> ModuleOrErr = expectedToErrorOrAndEmitErrors(
+      Context, getLazyBitcodeModule(Buffer, Context));
+  if (std::error_code EC = ModuleOrErr.getError())
+    bugle::ErrorReporter::reportFatalError(EC.message());
 
-  std::string DisplayFilename;
-  if (InputFilename == "-")
-    DisplayFilename = "<stdin>";
-  else
-    DisplayFilename = InputFilename;
-  bugle::ErrorReporter::setFileName(DisplayFilename);
+  std::set<std::string> EP(GPUEntryPoints.begin(), GPUEntryPoints.end());
+  bugle::materializeReachable(ModuleOrErr.get().get(), SourceLanguage, EP,
+                              GetLinkedReferences(),
+                              Inlining || OnlyExplicitGPUEntryPoints,
+                              OnlyExplicitGPUEntryPoints);
 
-  std::string ErrorMessage;
-  std::unique_ptr<Module> M;
+  return std::move(ModuleOrErr.get());
+}
 
-  // Read module
-  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
-      MemoryBuffer::getFile(InputFilename);
+// Runs the given passes over M. When tracing, each pass is run by its own
+// pass manager so that it can be timed individually.
+static void RunPasses(Module *M, const std::vector<Pass *> &Passes) {
+  if (!bugle::TimeTrace::isEnabled()) {
+    legacy::PassManager PM;
+    for (auto i = Passes.begin(), e = Passes.end(); i != e; ++i)
+      PM.add(*i);
+    PM.run(*M);
+    return;
+  }
 
-  if (std::error_code EC = BufferOrErr.getError()) {
-    ErrorMessage = EC.message();
-  } else {
-    std::unique_ptr<MemoryBuffer> &BufferPtr = BufferOrErr.get();
-    ErrorOr<std::unique_ptr<Module>> ModuleOrErr =
-        expectedToErrorOrAndEmitErrors(
-            Context,
-            parseBitcodeFile(BufferPtr.get()->getMemBufferRef(), Context));
-    if (std::error_code EC = ModuleOrErr.getError())
-      ErrorMessage = EC.message();
-    else
-      M = std::move(ModuleOrErr.get());
+  for (auto i = Passes.begin(), e = Passes.end(); i != e; ++i) {
+    bugle::TimeTraceScope Scope((*i)->getPassName());
+    legacy::PassManager PM;
+    PM.add(*i);
+    PM.run(*M);
   }
+}
+
+// Returns true if Filename names a source file rather than bitcode, in which
+// case SL is set to its source language.
+static bool IsSourceFile(StringRef Filename,
+                         bugle::TranslateModule::SourceLanguage &SL) {
+  StringRef Extension = sys::path::extension(Filename);
+  if (Extension == ".c")
+    SL = bugle::TranslateModule::SL_C;
+  else if (Extension == ".cl")
+    SL = bugle::TranslateModule::SL_OpenCL;
+  else if (Extension == ".cu")
+    SL = bugle::TranslateModule::SL_CUDA;
+  else
+    return false;
+  return true;
+}
+
+// Reads the module in Buffer, compiling it first if it is a source file.
+static std::unique_ptr<Module> ReadModule(MemoryBufferRef Buffer,
+                                          LLVMContext &Context) {
+  bugle::TranslateModule::SourceLanguage SL;
+  if (!IsSourceFile(Buffer.getBufferIdentifier(), SL))
+    return ReadBitcode(Buffer, Context);
 
-  if (!M) {
-    if (ErrorMessage.size())
-      bugle::ErrorReporter::reportFatalError(ErrorMessage);
-    else
-      bugle::ErrorReporter::reportFatalError("Bitcode did not read correctly");
+  std::string Filename = Buffer.getBufferIdentifier().str();
+  if (SL != SourceLanguage)
+    bugle::ErrorReporter::reportParameterError(
+        "Source language of " + Filename + " does not match option -l");
+
+#ifdef BUGLE_ENABLE_FRONTEND
+  bugle::TimeTraceScope Scope("Compile source");
+  bugle::FrontendOptions Opts;
+  Opts.IncludeDir = BlangIncludeDir;
+  Opts.Triple = FrontendTriple;
+  Opts.ExtraArgs.assign(FrontendArgs.begin(), FrontendArgs.end());
+  return bugle::compileSource(Buffer, SL, Opts, Context);
+#else
+  bugle::ErrorReporter::reportParameterError(
+      "Cannot compile " + Filename +
+      ": bugle was built without BUGLE_ENABLE_FRONTEND");
+#endif
+}
+
+// Links the modules given with -link into M. The modules are loaded lazily,
+// so only the definitions that are linked are read.
+static void LinkModules(Module *M) {
+  if (LinkFilenames.empty())
+    return;
+
+  bugle::TimeTraceScope Scope("Link modules");
+  for (auto i = LinkFilenames.begin(), e = LinkFilenames.end(); i != e; ++i) {
+    std::unique_ptr<MemoryBuffer> Buffer;
+    std::unique_ptr<Module> Library =
+        ReadLinkModule(*i, M->getContext(), Buffer);
+    if (Linker::linkModules(*M, std::move(Library),
+                            Linker::Flags::LinkOnlyNeeded))
+      bugle::ErrorReporter::reportFatalError("Cannot link " + *i);
   }
+}
+
+// Runs the pipeline given with -pipeline on M.
+static void RunPassPipeline(Module *M) {
+  if (PassPipeline.empty())
+    return;
 
+  bugle::TimeTraceScope Scope("Pass pipeline");
+  PassBuilder PB;
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  ModulePassManager MPM;
+  if (!PB.parsePassPipeline(MPM, PassPipeline))
+    bugle::ErrorReporter::reportParameterError("Invalid pass pipeline: " +
+                                               PassPipeline);
+  MPM.run(*M, MAM);
+}
+
+// Identifies the bugle executable for cache keys and saved pointer models, so
+// that these are not reused after bugle is rebuilt.
+static std::string ToolStamp;
+
+static void InitToolStamp(const char *Argv0) {
+  std::string Executable =
+      sys::fs::getMainExecutable(Argv0, (void *)&InitToolStamp);
+  sys::fs::file_status Status;
+  raw_string_ostream SS(ToolStamp);
+  SS << Executable;
+  if (!sys::fs::status(Executable, Status))
+    SS << ":" << Status.getSize() << ":"
+       << Status.getLastModificationTime().time_since_epoch().count();
+  SS.flush();
+}
+
+// Preprocesses and translates M using the current option values, writing the
+// Boogie program to OS and the source locations to LOS (if non-null).
+// If ModelsFile is given, the pointer models are saved to and loaded from it.
+static void TranslateToBoogie(Module *M, raw_ostream &OS, raw_ostream *LOS,
+                              const std::string &ModelsFile) {
   std::unique_ptr<bugle::IntegerRepresentation> IntRep;
   switch (IntegerRepresentation) {
   case BVIntRep:
@@ -237,72 +462,722 @@ int main(int argc, char **argv) {
   std::map<std::string, bugle::ArraySpec> KAS;
   GetArraySizes(KAS);
 
-  legacy::PassManager PM;
-  PM.add(new bugle::FreshArrayPass());
-  PM.add(new bugle::Vector3SimplificationPass());
-  PM.add(new bugle::ArgumentPromotionPass(SourceLanguage, EP));
-  PM.add(new bugle::StructSimplificationPass(M.get()));
+  std::vector<Pass *> Passes;
+  Passes.push_back(new bugle::FreshArrayPass());
+  Passes.push_back(new bugle::Vector3SimplificationPass());
+  Passes.push_back(new bugle::ArgumentPromotionPass(SourceLanguage, EP));
+  Passes.push_back(new bugle::StructSimplificationPass(M));
   if (Inlining) {
-    PM.add(new bugle::CycleDetectPass());
-    PM.add(new bugle::InlinePass(SourceLanguage, EP));
-    PM.add(new bugle::StructSimplificationPass(M.get()));
+    Passes.push_back(new bugle::CycleDetectPass());
+    Passes.push_back(new bugle::InlinePass(SourceLanguage, EP));
+    Passes.push_back(new bugle::StructSimplificationPass(M));
   }
   if (Inlining || OnlyExplicitGPUEntryPoints) {
-    PM.add(new bugle::SimpleInternalizePass(SourceLanguage, EP,
-                                            OnlyExplicitGPUEntryPoints));
+    Passes.push_back(new bugle::SimpleInternalizePass(
+        SourceLanguage, EP, OnlyExplicitGPUEntryPoints));
   }
-  PM.add(createPromoteMemoryToRegisterPass());
-  PM.add(createGlobalDCEPass());
-  PM.add(new bugle::RestrictDetectPass(SourceLanguage, EP, AddressSpaces));
-  PM.add(new bugle::ArgumentRenamePass());
+  Passes.push_back(createPromoteMemoryToRegisterPass());
+  Passes.push_back(createGlobalDCEPass());
+  RunPasses(M, Passes);
+
+  // The remaining passes and the translation do not change the values that
+  // the debug information refers to, so they share an index of it.
+  std::unique_ptr<bugle::DebugInfoIndex> DebugInfo;
+  {
+    bugle::TimeTraceScope Scope("Index debug info");
+    DebugInfo.reset(new bugle::DebugInfoIndex(M));
+  }
+
+  Passes.clear();
+  Passes.push_back(new bugle::RestrictDetectPass(SourceLanguage, EP,
+                                                 AddressSpaces, *DebugInfo));
+  Passes.push_back(new bugle::ArgumentRenamePass());
 #ifndef NDEBUG
-  PM.add(createVerifierPass());
+  Passes.push_back(createVerifierPass());
 #endif
-  PM.run(*M);
+  RunPasses(M, Passes);
 
 #ifndef NDEBUG
   if (DumpIR)
     M->dump();
 #endif
 
-  bugle::TranslateModule TM(M.get(), SourceLanguage, EP, RaceInstrumentation,
-                            AddressSpaces, KAS);
-  TM.translate();
+  bugle::TranslateModule TM(M, SourceLanguage, EP, RaceInstrumentation,
+                            AddressSpaces, KAS, *DebugInfo);
+  if (!ModelsFile.empty())
+    TM.setModelsFile(ModelsFile, ToolStamp);
+  {
+    bugle::TimeTraceScope Scope("Translate module");
+    TM.translate();
+  }
   std::unique_ptr<bugle::Module> BM(TM.takeModule());
 
   bugle::simplifyStmt(BM.get());
 
-  std::string OutFile = OutputFilename;
-  if (OutFile.empty()) {
-    SmallString<128> Path(InputFilename);
-    sys::path::replace_extension(Path, "bpl");
-    OutFile = sys::path::filename(Path);
+  std::unique_ptr<bugle::SourceLocWriter> SLW(new bugle::SourceLocWriter(LOS));
+
+  bugle::TimeTraceScope Scope("Write module");
+  bugle::BPLModuleWriter MW(OS, BM.get(), IntRep.get(), RaceInstrumentation,
+                            SLW.get());
+  MW.write();
+}
+
+// Server mode protocol. All sizes are in bytes and are written as decimal
+// numbers. A request consists of a header line followed by the options (one
+// per line, in the same form as on the command line) and the bitcode:
+//
+//   <number of options> <bitcode size>\n
+//   <option>\n ...
+//   <bitcode>
+//
+// The response consists of a header line followed by the Boogie program and
+// the source locations:
+//
+//   <status> <bpl size> <loc size>\n
+//   <bpl><loc>
+//
+// A status of 0 indicates success; otherwise the payloads are empty and the
+// error has been reported on stderr. The server exits on end of input.
+static bool ReadLine(std::string &Line) {
+  Line.clear();
+  int c;
+  while ((c = std::getchar()) != EOF && c != '\n')
+    Line.push_back((char)c);
+  return c != EOF;
+}
+
+static bool ReadRequest(std::vector<std::string> &Options,
+                        std::vector<char> &Bitcode) {
+  std::string Header;
+  if (!ReadLine(Header))
+    return false;
+
+  unsigned NumOptions;
+  size_t BitcodeSize;
+  SmallVector<StringRef, 2> Fields;
+  StringRef(Header).split(Fields, ' ');
+  if (Fields.size() != 2 || Fields[0].getAsInteger(10, NumOptions) ||
+      Fields[1].getAsInteger(10, BitcodeSize))
+    bugle::ErrorReporter::reportFatalError("Malformed request header: " +
+                                           Header);
+
+  Options.resize(NumOptions);
+  for (auto i = Options.begin(), e = Options.end(); i != e; ++i)
+    if (!ReadLine(*i))
+      bugle::ErrorReporter::reportFatalError("Truncated request");
+
+  Bitcode.resize(BitcodeSize);
+  if (std::fread(Bitcode.data(), 1, BitcodeSize, stdin) != BitcodeSize)
+    bugle::ErrorReporter::reportFatalError("Truncated request");
+
+  return true;
+}
+
+static std::string GetInputFilename() {
+  return InputFilenames.empty() ? "-" : InputFilenames.front();
+}
+
+// Options that affect the output but are not part of the cache key. If any of
+// these is given, the cache is bypassed.
+static const char *const UncachedOptions[] = {
+    "dump-ir", "dump-ref-counts", "model-bv-as-byte-array",
+    "model-mixed-width-arrays", "hash-cons-exprs"};
+
+static bool IsCacheable() {
+  if (CacheDirectory.empty())
+    return false;
+  auto &Options = cl::getRegisteredOptions();
+  for (auto Name : UncachedOptions) {
+    auto Option = Options.find(Name);
+    if (Option != Options.end() && Option->second->getNumOccurrences() > 0)
+      return false;
+  }
+  return true;
+}
+
+static std::string ComputeCacheKey(StringRef Bitcode,
+                                   const bugle::ExprRewriter *Rewriter) {
+  std::string Key;
+  raw_string_ostream SS(Key);
+  SS << ToolStamp << "\n" << (unsigned)SourceLanguage << " "
+     << (unsigned)IntegerRepresentation << " " << (unsigned)RaceInstrumentation
+     << " " << Inlining << " " << OnlyExplicitGPUEntryPoints << " "
+     << GlobalAddrSpace << " " << GroupSharedAddrSpace << " "
+     << ConstantAddrSpace << "\n";
+
+  std::set<std::string> EP(GPUEntryPoints.begin(), GPUEntryPoints.end());
+  for (auto i = EP.begin(), e = EP.end(); i != e; ++i)
+    SS << "k " << *i << "\n";
+
+  std::set<std::string> KAS(GPUArraySizes.begin(), GPUArraySizes.end());
+  for (auto i = KAS.begin(), e = KAS.end(); i != e; ++i)
+    SS << "kernel-array-sizes " << *i << "\n";
+
+  // Linked modules are identified by their path, size and modification time,
+  // rather than by their (potentially large) contents.
+  for (auto i = LinkFilenames.begin(), e = LinkFilenames.end(); i != e; ++i) {
+    sys::fs::file_status Status;
+    SS << "link " << *i;
+    if (!sys::fs::status(*i, Status))
+      SS << ":" << Status.getSize() << ":"
+         << Status.getLastModificationTime().time_since_epoch().count();
+    SS << "\n";
+  }
+  SS << "pipeline " << PassPipeline << "\n";
+
+  if (Rewriter) {
+    SS << "rewrite-exprs\n";
+    auto Disabled = Rewriter->getDisabledRules();
+    for (auto i = Disabled.begin(), e = Disabled.end(); i != e; ++i)
+      SS << "disable-expr-rewrite " << *i << "\n";
   }
 
+  SHA1 Hasher;
+  Hasher.update(SS.str());
+  Hasher.update(Bitcode);
+  return toHex(Hasher.final());
+}
+
+// Cache entries are named so that they are subject to LLVM's cache pruning.
+static std::string GetCacheEntryPath(StringRef Key, StringRef Extension) {
+  SmallString<128> Path(CacheDirectory);
+  sys::path::append(Path, "llvmcache-" + Key + "." + Extension);
+  return Path.str().str();
+}
+
+static bool LookupCache(StringRef Key, std::string &BPL, std::string &Loc) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BPLOrErr =
+      MemoryBuffer::getFile(GetCacheEntryPath(Key, "bpl"));
+  if (!BPLOrErr)
+    return false;
+  ErrorOr<std::unique_ptr<MemoryBuffer>> LocOrErr =
+      MemoryBuffer::getFile(GetCacheEntryPath(Key, "loc"));
+  if (!LocOrErr)
+    return false;
+
+  BPL = BPLOrErr.get()->getBuffer().str();
+  Loc = LocOrErr.get()->getBuffer().str();
+  return true;
+}
+
+// Writes a cache entry file under a temporary name and renames it into place,
+// so that concurrent bugle processes never observe a partial entry.
+static bool WriteCacheEntry(const std::string &Path, StringRef Contents) {
+  int FD;
+  SmallString<128> TempPath;
+  SmallString<128> Model(CacheDirectory);
+  sys::path::append(Model, "tmp-%%%%%%%%%%%%");
+  if (sys::fs::createUniqueFile(Model, FD, TempPath))
+    return false;
+
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Contents;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath);
+      return false;
+    }
+  }
+
+  if (sys::fs::rename(TempPath, Path)) {
+    sys::fs::remove(TempPath);
+    return false;
+  }
+  return true;
+}
+
+// The source locations are stored first: a reader that finds the Boogie file
+// of an entry therefore also finds its source locations, unless the entry is
+// pruned in between, which the reader sees as a miss.
+static void StoreCache(StringRef Key, StringRef BPL, StringRef Loc) {
+  if (WriteCacheEntry(GetCacheEntryPath(Key, "loc"), Loc))
+    WriteCacheEntry(GetCacheEntryPath(Key, "bpl"), BPL);
+}
+
+static void PruneCache() {
+  Expected<CachePruningPolicy> Policy = parseCachePruningPolicy(CachePolicy);
+  if (!Policy) {
+    std::string Msg = "Invalid cache policy: " + toString(Policy.takeError());
+    bugle::ErrorReporter::reportParameterError(Msg);
+  }
+  pruneCache(CacheDirectory, *Policy);
+}
+
+// The statistics of each translated input, as JSON objects keyed by the
+// buffer identifier of the input, or by the request in server mode.
+static std::map<std::string, std::string> InputStatistics;
+
+static void TranslateBufferUncounted(MemoryBufferRef Buffer,
+                                     const bugle::ExprRewriter *Rewriter,
+                                     std::string &BPL, std::string &Loc) {
+  // Sources are not cached, as their translation also depends on the headers
+  // they include.
+  bugle::TranslateModule::SourceLanguage SL;
+  std::string Key;
+  if (IsCacheable() && !IsSourceFile(Buffer.getBufferIdentifier(), SL)) {
+    Key = ComputeCacheKey(Buffer.getBuffer(), Rewriter);
+    if (LookupCache(Key, BPL, Loc)) {
+      if (bugle::Statistics::isEnabled())
+        bugle::Statistics::add("cache-hits");
+      return;
+    }
+  }
+
+  LLVMContext Context;
+  std::unique_ptr<Module> M = ReadModule(Buffer, Context);
+  LinkModules(M.get());
+  RunPassPipeline(M.get());
+  raw_string_ostream BPLOS(BPL), LocOS(Loc);
+  std::string ModelsFile;
+  if (PersistModels && Buffer.getBufferIdentifier() != "-")
+    ModelsFile = Buffer.getBufferIdentifier().str() + ".models";
+  bugle::ExprRewriter::Scope RewriteScope(Rewriter);
+  TranslateToBoogie(M.get(), BPLOS, &LocOS, ModelsFile);
+  BPLOS.flush();
+  LocOS.flush();
+
+  if (!Key.empty())
+    StoreCache(Key, BPL, Loc);
+}
+
+// Translates the bitcode in Buffer, simplifying expressions with Rewriter if
+// it is not null, and captures the Boogie program and the source locations in
+// BPL and Loc, and the statistics of the translation as a JSON object in Stats
+// if they are collected. If a cache directory is given, the translation is
+// taken from the cache where possible.
+static void TranslateBuffer(MemoryBufferRef Buffer,
+                            const bugle::ExprRewriter *Rewriter,
+                            std::string &BPL, std::string &Loc,
+                            std::string &Stats) {
+  if (!bugle::Statistics::isEnabled()) {
+    TranslateBufferUncounted(Buffer, Rewriter, BPL, Loc);
+    return;
+  }
+
+  bugle::Statistics::reset();
+  TranslateBufferUncounted(Buffer, Rewriter, BPL, Loc);
+  bugle::Statistics::add("output-bytes", BPL.size());
+  raw_string_ostream SS(Stats);
+  bugle::Statistics::write(SS);
+  SS.flush();
+}
+
+// Translations are run in child processes where possible, such that an error,
+// which is reported by exiting, ends only the translation of one input or
+// request. A child returns its results to its parent in a file, as a sequence
+// of fields that are each preceded by their size.
+struct ChildProcess {
+  int Pid;
+  std::string ResultsFile, Results;
+};
+
+static void WriteField(raw_ostream &OS, StringRef Field) {
+  OS << Field.size() << "\n" << Field;
+}
+
+static bool ReadField(StringRef &Results, std::string &Field) {
+  StringRef Line;
+  size_t Size;
+  std::tie(Line, Results) = Results.split('\n');
+  if (Line.getAsInteger(10, Size) || Size > Results.size())
+    return false;
+  Field = Results.substr(0, Size).str();
+  Results = Results.substr(Size);
+  return true;
+}
+
+// Starts running Fn, which writes its results to the given stream, in a child
+// process. Where processes cannot be forked, Fn runs to completion in this
+// process instead, and an error in it ends this process.
+static void StartChild(function_ref<void(raw_ostream &)> Fn,
+                       ChildProcess &Child) {
+#ifdef LLVM_ON_UNIX
+  SmallString<128> Path;
+  if (std::error_code EC =
+          sys::fs::createTemporaryFile("bugle", "results", Path))
+    bugle::ErrorReporter::reportFatalError(EC.message());
+  Child.ResultsFile = Path.str().str();
+
+  outs().flush();
+  Child.Pid = fork();
+  if (Child.Pid < 0)
+    bugle::ErrorReporter::reportFatalError(std::string("Cannot fork: ") +
+                                           std::strerror(errno));
+  if (Child.Pid > 0)
+    return;
+
+  // The child leaves the state it shares with the parent, such as the output
+  // streams, for the parent to tear down.
+  bugle::TimeTrace::reset();
+  std::error_code EC;
+  raw_fd_ostream OS(Child.ResultsFile, EC, sys::fs::F_None);
+  if (EC)
+    bugle::ErrorReporter::reportFatalError(EC.message());
+  Fn(OS);
+  OS.close();
+  std::_Exit(OS.has_error() ? 1 : 0);
+#else
+  raw_string_ostream OS(Child.Results);
+  Fn(OS);
+  OS.flush();
+#endif
+}
+
+// Waits for one of Children to end, setting Index to its position and its
+// Results to what it wrote. Returns false if the child failed, in which case
+// it has reported why.
+static bool WaitForChild(std::vector<ChildProcess> &Children,
+                         unsigned &Index) {
+#ifdef LLVM_ON_UNIX
+  while (true) {
+    int Status;
+    pid_t Pid = waitpid(-1, &Status, 0);
+    if (Pid < 0) {
+      if (errno == EINTR)
+        continue;
+      bugle::ErrorReporter::reportFatalError(
+          std::string("Cannot wait for translation: ") + std::strerror(errno));
+    }
+
+    auto Child = std::find_if(Children.begin(), Children.end(),
+                              [&](ChildProcess &C) { return C.Pid == Pid; });
+    if (Child == Children.end())
+      continue;
+    Index = Child - Children.begin();
+
+    bool Success = WIFEXITED(Status) && WEXITSTATUS(Status) == 0;
+    if (Success) {
+      ErrorOr<std::unique_ptr<MemoryBuffer>> ResultsOrErr =
+          MemoryBuffer::getFile(Child->ResultsFile);
+      if (ResultsOrErr)
+        Child->Results = ResultsOrErr.get()->getBuffer().str();
+      else
+        Success = false;
+    }
+    sys::fs::remove(Child->ResultsFile);
+    return Success;
+  }
+#else
+  Index = 0;
+  return true;
+#endif
+}
+
+// Writes the statistics and the trace of a translation in a child process.
+static void WriteChildRecords(raw_ostream &OS, StringRef Stats) {
+  WriteField(OS, Stats);
+  std::string Events;
+  if (bugle::TimeTrace::isEnabled()) {
+    raw_string_ostream ES(Events);
+    bugle::TimeTrace::writeEvents(ES);
+    ES.flush();
+  }
+  WriteField(OS, Events);
+}
+
+// Reads the records written by WriteChildRecords, recording the statistics
+// under Key.
+static bool ReadChildRecords(StringRef &Results, const std::string &Key) {
+  std::string Stats, Events;
+  if (!ReadField(Results, Stats) || !ReadField(Results, Events))
+    return false;
+  if (!Stats.empty())
+    InputStatistics[Key] = Stats;
+  bugle::TimeTrace::addEvents(Events);
+  return true;
+}
+
+// Options that apply to the server process as a whole: the cache is set up,
+// and the trace and statistics are collected and written, once per process.
+// They keep the values given to the server, and requests may not give them.
+static cl::opt<std::string> *const ServerOptions[] = {
+    &CacheDirectory, &CachePolicy, &TimeTraceFilename, &StatsFilename};
+
+// Serves the request numbered Index, counting from 1.
+static bool ServeRequest(const char *ProgName, unsigned Index,
+                         const std::vector<std::string> &Options,
+                         const std::vector<char> &Bitcode, std::string &BPL,
+                         std::string &Loc) {
+  std::vector<const char *> Args;
+  Args.push_back(ProgName);
+  for (auto i = Options.begin(), e = Options.end(); i != e; ++i)
+    Args.push_back(i->c_str());
+
+  std::vector<std::string> ServerValues;
+  for (auto O : ServerOptions)
+    ServerValues.push_back(*O);
+
+  cl::ResetAllOptionOccurrences();
+  bool Parsed = cl::ParseCommandLineOptions(
+      Args.size(), Args.data(), "LLVM to Boogie translator\n", &errs());
+
+  for (unsigned i = 0, e = ServerValues.size(); i != e; ++i) {
+    if (ServerOptions[i]->getNumOccurrences() > 0) {
+      errs() << "error: Option -" << ServerOptions[i]->ArgStr
+             << " cannot be given in a request\n";
+      Parsed = false;
+    }
+    *ServerOptions[i] = ServerValues[i];
+  }
+  if (!Parsed)
+    return false;
+
+  if (Serve) {
+    bugle::ErrorReporter::emitWarning("Ignoring nested -serve option");
+    Serve = false;
+  }
+
+  std::string InputFilename = GetInputFilename();
+  std::string DisplayFilename;
+  if (InputFilename == "-")
+    DisplayFilename = "<request>";
+  else
+    DisplayFilename = InputFilename;
+  bugle::ErrorReporter::setFileName(DisplayFilename);
+
+  StringRef Buffer(Bitcode.data(), Bitcode.size());
+  std::vector<ChildProcess> Children(1);
+  StartChild(
+      [&](raw_ostream &OS) {
+        // The rules are checked here, as an unknown rule is reported by
+        // exiting.
+        auto Rewriter = bugle::ExprRewriter::createFromOptions();
+        std::string Stats;
+        TranslateBuffer(MemoryBufferRef(Buffer, InputFilename), Rewriter.get(),
+                        BPL, Loc, Stats);
+        WriteField(OS, BPL);
+        WriteField(OS, Loc);
+        WriteChildRecords(OS, Stats);
+      },
+      Children[0]);
+
+  // Requests are told apart by their number, as those whose bitcode is
+  // given inline share the buffer identifier "-".
+  std::string Key = "request " + std::to_string(Index);
+  if (InputFilename != "-")
+    Key += ": " + InputFilename;
+
+  unsigned ChildIndex;
+  if (!WaitForChild(Children, ChildIndex))
+    return false;
+  StringRef Results = Children[0].Results;
+  if (!ReadField(Results, BPL) || !ReadField(Results, Loc) ||
+      !ReadChildRecords(Results, Key)) {
+    errs() << DisplayFilename << ": error: Malformed translation results\n";
+    return false;
+  }
+  return true;
+}
+
+static int RunServer(const char *ProgName) {
+  sys::ChangeStdinToBinary();
+  sys::ChangeStdoutToBinary();
+
+  std::vector<std::string> Options;
+  std::vector<char> Bitcode;
+  for (unsigned Index = 1; ReadRequest(Options, Bitcode); ++Index) {
+    std::string BPL, Loc;
+    bool Success = ServeRequest(ProgName, Index, Options, Bitcode, BPL, Loc);
+    if (!Success) {
+      BPL.clear();
+      Loc.clear();
+    }
+
+    outs() << (Success ? 0 : 1) << " " << BPL.size() << " " << Loc.size()
+           << "\n";
+    outs() << BPL << Loc;
+    outs().flush();
+  }
+
+  return 0;
+}
+
+static void WriteOutputFile(const std::string &Filename,
+                            const std::string &Contents) {
   std::error_code ErrorCode;
-  ToolOutputFile F(OutFile, ErrorCode, sys::fs::F_Text);
+  ToolOutputFile F(Filename, ErrorCode, sys::fs::F_Text);
   if (ErrorCode)
     bugle::ErrorReporter::reportFatalError(ErrorCode.message());
+  F.os() << Contents;
+  F.os().flush();
+  F.keep();
+}
+
+// Translates each input in a child process of its own, running up to -j of
+// them at once, and writes <name>.bpl and <name>.loc to the output directory.
+// Returns the process exit code.
+static int TranslateFiles(const std::vector<std::string> &Inputs,
+                          const bugle::ExprRewriter *Rewriter) {
+  if (!OutputFilename.empty() || !SourceLocationFilename.empty())
+    bugle::ErrorReporter::reportParameterError(
+        "Options -o and -s cannot be used with multiple inputs; "
+        "use -output-dir instead");
 
-  ToolOutputFile *L = nullptr;
-  if (!SourceLocationFilename.empty()) {
-    L = new ToolOutputFile(SourceLocationFilename, ErrorCode, sys::fs::F_Text);
-    if (ErrorCode)
-      bugle::ErrorReporter::reportFatalError(ErrorCode.message());
+  if (!OutputDirectory.empty()) {
+    if (std::error_code EC = sys::fs::create_directories(OutputDirectory))
+      bugle::ErrorReporter::reportFatalError(EC.message());
   }
-  std::unique_ptr<bugle::SourceLocWriter> SLW(new bugle::SourceLocWriter(L));
 
-  bugle::BPLModuleWriter MW(F.os(), BM.get(), IntRep.get(), RaceInstrumentation,
-                            SLW.get());
-  MW.write();
+  std::vector<std::string> Stems;
+  std::set<std::string> SeenStems;
+  for (auto i = Inputs.begin(), e = Inputs.end(); i != e; ++i) {
+    if (*i == "-")
+      bugle::ErrorReporter::reportParameterError(
+          "Cannot read from stdin when translating multiple inputs");
+    SmallString<128> Stem(OutputDirectory);
+    sys::path::append(Stem, sys::path::stem(*i));
+    if (!SeenStems.insert(Stem.str().str()).second)
+      bugle::ErrorReporter::reportParameterError(
+          "Multiple inputs would be written to " + Stem.str().str() + ".bpl");
+    Stems.push_back(Stem.str().str());
+  }
 
-  F.os().flush();
-  F.keep();
+  unsigned NumThreads = Threads;
+  if (NumThreads == 0)
+    NumThreads = heavyweight_hardware_concurrency();
+
+  bool Failed = false;
+  std::vector<ChildProcess> Children;
+  std::vector<unsigned> ChildInputs;
+  for (unsigned i = 0, e = Inputs.size(); i != e || !Children.empty();) {
+    if (i != e && Children.size() < NumThreads) {
+      bugle::ErrorReporter::setFileName(Inputs[i]);
+      Children.emplace_back();
+      ChildInputs.push_back(i);
+      StartChild(
+          [&](raw_ostream &OS) {
+            ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+                MemoryBuffer::getFile(Inputs[i]);
+            if (std::error_code EC = BufferOrErr.getError())
+              bugle::ErrorReporter::reportFatalError(EC.message());
+
+            std::string BPL, Loc, Stats;
+            TranslateBuffer(BufferOrErr.get()->getMemBufferRef(), Rewriter,
+                            BPL, Loc, Stats);
+            WriteOutputFile(Stems[i] + ".bpl", BPL);
+            WriteOutputFile(Stems[i] + ".loc", Loc);
+            WriteChildRecords(OS, Stats);
+          },
+          Children.back());
+      ++i;
+      continue;
+    }
+
+    unsigned Index;
+    bool Success = WaitForChild(Children, Index);
+    StringRef Results = Children[Index].Results;
+    const std::string &Input = Inputs[ChildInputs[Index]];
+    if (Success && !ReadChildRecords(Results, Input)) {
+      errs() << Input << ": error: Malformed translation results\n";
+      Success = false;
+    }
+    if (!Success)
+      Failed = true;
+    Children.erase(Children.begin() + Index);
+    ChildInputs.erase(ChildInputs.begin() + Index);
+  }
+
+  return Failed ? 1 : 0;
+}
+
+static void WriteTimeTrace() {
+  if (!bugle::TimeTrace::isEnabled() || TimeTraceFilename.empty())
+    return;
+
+  std::string Trace;
+  raw_string_ostream SS(Trace);
+  bugle::TimeTrace::write(SS);
+  WriteOutputFile(TimeTraceFilename, SS.str());
+}
+
+static void WriteStatistics() {
+  if (!bugle::Statistics::isEnabled() || StatsFilename.empty())
+    return;
+
+  std::string Stats;
+  raw_string_ostream SS(Stats);
+  SS << "{";
+  for (auto i = InputStatistics.begin(), e = InputStatistics.end(); i != e;
+       ++i) {
+    if (i != InputStatistics.begin())
+      SS << ",";
+    SS << "\n  ";
+    bugle::writeJSONString(SS, i->first);
+    SS << ": " << i->second;
+  }
+  SS << "\n}\n";
+  WriteOutputFile(StatsFilename, SS.str());
+}
+
+static int Run(const char *Argv0) {
+  if (Serve)
+    return RunServer(Argv0);
+
+  auto Rewriter = bugle::ExprRewriter::createFromOptions();
+  if (InputFilenames.size() > 1 || !OutputDirectory.empty())
+    return TranslateFiles(InputFilenames, Rewriter.get());
+
+  std::string InputFilename = GetInputFilename();
+  std::string DisplayFilename;
+  if (InputFilename == "-")
+    DisplayFilename = "<stdin>";
+  else
+    DisplayFilename = InputFilename;
+  bugle::ErrorReporter::setFileName(DisplayFilename);
+
+  // Read module
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+      MemoryBuffer::getFile(InputFilename);
+  if (std::error_code EC = BufferOrErr.getError())
+    bugle::ErrorReporter::reportFatalError(EC.message());
 
-  if (L) {
-    L->os().flush();
-    L->keep();
+  std::string BPL, Loc, Stats;
+  TranslateBuffer(BufferOrErr.get()->getMemBufferRef(), Rewriter.get(), BPL,
+                  Loc, Stats);
+  if (!Stats.empty())
+    InputStatistics[InputFilename] = Stats;
+
+  std::string OutFile = OutputFilename;
+  if (OutFile.empty()) {
+    SmallString<128> Path(InputFilename);
+    sys::path::replace_extension(Path, "bpl");
+    OutFile = sys::path::filename(Path);
   }
 
+  WriteOutputFile(OutFile, BPL);
+  if (!SourceLocationFilename.empty())
+    WriteOutputFile(SourceLocationFilename, Loc);
+
   return 0;
 }
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal(argv[0]);
+  llvm::PrettyStackTraceProgram X(argc, argv);
+
+  // Enable debug stream buffering.
+  EnableDebugBuffering = true;
+
+  llvm_shutdown_obj Y; // Call llvm_shutdown() on exit.
+
+  cl::ParseCommandLineOptions(argc, argv, "LLVM to Boogie translator\n");
+
+  InitToolStamp(argv[0]);
+  if (!CacheDirectory.empty()) {
+    if (std::error_code EC = sys::fs::create_directories(CacheDirectory))
+      bugle::ErrorReporter::reportFatalError(EC.message());
+    PruneCache();
+  }
+
+  if (!TimeTraceFilename.empty())
+    bugle::TimeTrace::enable();
+  if (!StatsFilename.empty())
+    bugle::Statistics::enable();
+
+  int Result = Run(argv[0]);
+  WriteTimeTrace();
+  WriteStatistics();
+  return Result;
+}